@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "kyut/BitStreamWriter.hpp"
+#include "kyut/CircularBitStreamReader.hpp"
+
+namespace {
+    constexpr std::size_t stream_size_bits = 1 << 20;
+
+    void BM_BitStreamWriter_write(benchmark::State& state) {
+        const auto width = static_cast<std::size_t>(state.range(0));
+
+        for ([[maybe_unused]] auto _ : state) {
+            kyut::BitStreamWriter w{};
+            w.reserve(stream_size_bits);
+
+            for (std::size_t i = 0; i + width <= stream_size_bits; i += width) {
+                w.write(i, width);
+            }
+
+            benchmark::DoNotOptimize(w.data().data());
+        }
+
+        state.SetBytesProcessed(state.iterations() * stream_size_bits / 8);
+    }
+
+    void BM_CircularBitStreamReader_read(benchmark::State& state) {
+        const auto width = static_cast<std::size_t>(state.range(0));
+
+        // Shorter than the stream, so that it wraps around
+        kyut::CircularBitStreamReader r{"The quick brown fox jumps over the lazy dog"};
+
+        for ([[maybe_unused]] auto _ : state) {
+            std::uint64_t x = 0;
+
+            for (std::size_t i = 0; i + width <= stream_size_bits; i += width) {
+                x ^= r.read(width);
+            }
+
+            benchmark::DoNotOptimize(x);
+        }
+
+        state.SetBytesProcessed(state.iterations() * stream_size_bits / 8);
+    }
+} // namespace
+
+BENCHMARK(BM_BitStreamWriter_write)->Arg(1)->Arg(4)->Arg(8)->Arg(13)->Arg(32)->Arg(61)->Arg(64);
+BENCHMARK(BM_CircularBitStreamReader_read)->Arg(1)->Arg(4)->Arg(8)->Arg(13)->Arg(32)->Arg(61)->Arg(64);
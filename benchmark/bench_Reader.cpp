@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include "kyut/binary/Module.hpp"
+#include "kyut/wasm-ext/ParallelReader.hpp"
+#include "wasm.h"
+
+namespace {
+    struct BenchModule {
+        const char* name;
+        const char* filename;
+    };
+
+    // Largest modules of the benchmark projects, relative to the root of the repository after `npm install`
+    constexpr BenchModule bench_modules[] = {
+        {"ammo.js", "./node_modules/ammo.js/builds/ammo.wasm.wasm"},
+        {"jq-web", "./node_modules/jq-web/jq.wasm.wasm"},
+        {"vim-wasm", "./node_modules/vim-wasm/vim.wasm"},
+    };
+
+    // With one thread, the module is read by `wasm::WasmBinaryBuilder` as `wasm::ModuleReader` does
+    void BM_parallel_reader(benchmark::State& state) {
+        const auto& m = bench_modules[state.range(0)];
+        const auto num_threads = static_cast<std::size_t>(state.range(1));
+
+        state.SetLabel(m.name);
+
+        std::optional<kyut::binary::Module> binary{};
+        try {
+            binary.emplace(kyut::binary::read_module(m.filename));
+        } catch (const std::runtime_error& e) {
+            state.SkipWithError(e.what());
+            return;
+        }
+
+        for ([[maybe_unused]] auto _ : state) {
+            kyut::ParallelReader reader{};
+
+            wasm::Module module{};
+            reader.read(*binary, module, num_threads);
+
+            benchmark::DoNotOptimize(module.functions.data());
+        }
+
+        state.SetBytesProcessed(state.iterations() * binary->bytes().size());
+    }
+} // namespace
+
+BENCHMARK(BM_parallel_reader)
+    ->Apply([](benchmark::internal::Benchmark* b) {
+        for (std::size_t i = 0; i < std::size(bench_modules); i++) {
+            for (const auto num_threads : {1, 2, 4, 8}) {
+                b->Args({static_cast<std::int64_t>(i), num_threads});
+            }
+        }
+    })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include "kyut/Reordering.hpp"
+
+namespace {
+    constexpr std::size_t num_watermarks = 4096;
+
+    // Runtime loops over the digits, as before the kernels were specialised
+    void decode_generic(std::uint64_t watermark, std::size_t count, kyut::detail::ChunkIndices& digits) {
+        for (std::size_t i = 0; i < count; i++) {
+            digits[i] = static_cast<std::uint32_t>(watermark % (count - i));
+            watermark /= (count - i);
+        }
+    }
+
+    std::uint64_t encode_generic(std::size_t count, const kyut::detail::ChunkIndices& digits) {
+        std::uint64_t watermark = 0;
+        for (std::size_t i = count; i-- > 0;) {
+            watermark = watermark * (count - i) + digits[i];
+        }
+
+        return watermark;
+    }
+
+    template <typename Decode, typename Encode>
+    void run(benchmark::State& state, Decode decode, Encode encode) {
+        const auto count = static_cast<std::size_t>(state.range(0));
+        const auto mask = (std::uint64_t{1} << kyut::detail::factorial_bit_width(count)) - 1;
+
+        kyut::detail::ChunkIndices digits(kyut::detail::max_small_chunk_size);
+
+        for ([[maybe_unused]] auto _ : state) {
+            std::uint64_t x = 0x9E3779B97F4A7C15;
+
+            for (std::size_t i = 0; i < num_watermarks; i++) {
+                decode(x & mask, count, digits);
+                x += encode(count, digits);
+            }
+
+            benchmark::DoNotOptimize(x);
+        }
+
+        state.SetItemsProcessed(state.iterations() * num_watermarks);
+    }
+
+    void BM_permutation_kernel(benchmark::State& state) {
+        run(
+            state,
+            [](std::uint64_t watermark, std::size_t count, kyut::detail::ChunkIndices& digits) {
+                kyut::detail::small_permutation_kernels[count].decode(watermark, digits);
+            },
+            [](std::size_t count, const kyut::detail::ChunkIndices& digits) {
+                return kyut::detail::small_permutation_kernels[count].encode(digits);
+            });
+    }
+
+    void BM_permutation_generic(benchmark::State& state) {
+        run(state, decode_generic, encode_generic);
+    }
+} // namespace
+
+BENCHMARK(BM_permutation_kernel)->DenseRange(2, 20, 2);
+BENCHMARK(BM_permutation_generic)->DenseRange(2, 20, 2);
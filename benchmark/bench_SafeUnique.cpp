@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+#include "kyut/SafeUnique.hpp"
+
+namespace {
+    // The previous implementation, which moves the elements through two temporary vectors
+    template <typename Iterator, typename Pred>
+    Iterator safe_unique_buffered(Iterator begin, Iterator end, Pred pred) {
+        if (begin == end) {
+            return begin;
+        }
+
+        std::vector<typename std::iterator_traits<Iterator>::value_type> a, b;
+
+        auto it = begin;
+        a.emplace_back(std::move(*it));
+
+        while (++it != end) {
+            if (pred(a.back(), *it)) {
+                b.emplace_back(std::move(*it));
+            } else {
+                a.emplace_back(std::move(*it));
+            }
+        }
+
+        it = begin;
+        for (std::size_t i = 0; i < a.size(); i++) {
+            *it++ = std::move(a[i]);
+        }
+
+        const auto result = it;
+
+        for (std::size_t i = 0; i < b.size(); i++) {
+            *it++ = std::move(b[i]);
+        }
+
+        return result;
+    }
+
+    // Ascending values where every `duplicate_every`-th element repeats the previous one
+    std::vector<std::unique_ptr<int>> make_chunks(std::size_t size, std::size_t duplicate_every) {
+        std::vector<std::unique_ptr<int>> x{};
+        x.reserve(size);
+
+        int value = 0;
+        for (std::size_t i = 0; i < size; i++) {
+            if (duplicate_every == 0 || i % duplicate_every != 0) {
+                value++;
+            }
+
+            x.emplace_back(std::make_unique<int>(value));
+        }
+
+        return x;
+    }
+
+    template <typename SafeUnique>
+    void run(benchmark::State& state, SafeUnique safe_unique) {
+        constexpr std::size_t chunk_size = 20;
+
+        const auto duplicate_every = static_cast<std::size_t>(state.range(0));
+        auto x = make_chunks(chunk_size * 1024, duplicate_every);
+
+        const auto equal = [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) {
+            return *a == *b;
+        };
+
+        for ([[maybe_unused]] auto _ : state) {
+            for (std::size_t i = 0; i < x.size(); i += chunk_size) {
+                benchmark::DoNotOptimize(safe_unique(std::begin(x) + i, std::begin(x) + i + chunk_size, equal));
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * x.size());
+    }
+
+    void BM_safe_unique(benchmark::State& state) {
+        run(state, [](auto begin, auto end, auto pred) { return kyut::safe_unique(begin, end, pred); });
+    }
+
+    void BM_safe_unique_buffered(benchmark::State& state) {
+        run(state, [](auto begin, auto end, auto pred) { return safe_unique_buffered(begin, end, pred); });
+    }
+} // namespace
+
+// Arg: every n-th element is a duplicate, or none if 0
+BENCHMARK(BM_safe_unique)->Arg(0)->Arg(7)->Arg(2);
+BENCHMARK(BM_safe_unique_buffered)->Arg(0)->Arg(7)->Arg(2);
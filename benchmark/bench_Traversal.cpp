@@ -0,0 +1,248 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <random>
+#include <vector>
+#include <pthread.h>
+#include "kyut/BitStreamWriter.hpp"
+#include "kyut/CircularBitStreamReader.hpp"
+#include "kyut/Parallel.hpp"
+#include "kyut/methods/FunctionReordering.hpp"
+#include "kyut/methods/OperandSwapping.hpp"
+#include "kyut/wasm-ext/Compare.hpp"
+#include "kyut/wasm-ext/FlatFunction.hpp"
+#include "kyut/wasm-ext/Traversal.hpp"
+#include "wasm.h"
+
+namespace {
+    // Far smaller than the call stack a recursive walk of the deepest trees would need
+    constexpr std::size_t stack_size = 256 * 1024;
+
+    // (i32.add (i32.const 0) (i32.add (... (local.get 0) ...) (i32.const 1)))
+    wasm::Expression* make_deep_tree(MixedArena& allocator, std::size_t depth) {
+        const auto get = allocator.alloc<wasm::LocalGet>();
+        get->index = 0;
+        get->type = wasm::Type::i32;
+
+        wasm::Expression* expr = get;
+
+        for (std::size_t i = 0; i < depth; i++) {
+            const auto value = allocator.alloc<wasm::Const>();
+            value->set(wasm::Literal{static_cast<std::int32_t>(i % 7)});
+
+            const auto add = allocator.alloc<wasm::Binary>();
+            add->type = wasm::Type::i32;
+            add->op = wasm::AddInt32;
+            add->left = i % 2 == 0 ? expr : value;
+            add->right = i % 2 == 0 ? value : expr;
+
+            expr = add;
+        }
+
+        return expr;
+    }
+
+    std::unique_ptr<wasm::Module> make_deep_module(std::size_t depth) {
+        auto module = std::make_unique<wasm::Module>();
+
+        auto f = std::make_unique<wasm::Function>();
+        f->name = "f";
+        f->sig = wasm::Signature{wasm::Type::i32, wasm::Type::i32};
+        f->body = make_deep_tree(module->allocator, depth);
+
+        module->addFunction(std::move(f));
+
+        return module;
+    }
+
+    std::unique_ptr<wasm::Module> make_wide_module(std::size_t num_functions, std::size_t depth) {
+        auto module = std::make_unique<wasm::Module>();
+
+        for (std::size_t i = 0; i < num_functions; i++) {
+            auto f = std::make_unique<wasm::Function>();
+            f->name = "f" + std::to_string(i);
+            f->sig = wasm::Signature{wasm::Type::i32, wasm::Type::i32};
+            f->body = make_deep_tree(module->allocator, depth + i % 7);
+
+            module->addFunction(std::move(f));
+        }
+
+        return module;
+    }
+
+    // Runs `f` on a thread with a stack of `stack_size` bytes
+    template <typename F>
+    void run_with_small_stack(F f) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, stack_size);
+
+        pthread_t thread;
+        pthread_create(
+            &thread,
+            &attr,
+            [](void* p) -> void* {
+                (*static_cast<F*>(p))();
+                return nullptr;
+            },
+            &f);
+
+        pthread_join(thread, nullptr);
+        pthread_attr_destroy(&attr);
+    }
+
+    void BM_compare3_deep(benchmark::State& state) {
+        const auto depth = static_cast<std::size_t>(state.range(0));
+
+        wasm::Module module{};
+        const auto a = make_deep_tree(module.allocator, depth);
+        const auto b = make_deep_tree(module.allocator, depth);
+
+        run_with_small_stack([&] {
+            for ([[maybe_unused]] auto _ : state) {
+                benchmark::DoNotOptimize(wasm::compare3(*a, *b));
+            }
+        });
+
+        state.SetItemsProcessed(state.iterations() * depth);
+    }
+
+    void BM_flat_function_deep(benchmark::State& state) {
+        const auto depth = static_cast<std::size_t>(state.range(0));
+        const auto module = make_deep_module(depth);
+
+        run_with_small_stack([&] {
+            for ([[maybe_unused]] auto _ : state) {
+                const kyut::FlatFunction f{*module->functions[0]};
+                benchmark::DoNotOptimize(f.nodes().data());
+            }
+        });
+
+        state.SetItemsProcessed(state.iterations() * depth);
+    }
+
+    void BM_compare3_flat_deep(benchmark::State& state) {
+        const auto depth = static_cast<std::size_t>(state.range(0));
+        const auto a = make_deep_module(depth);
+        const auto b = make_deep_module(depth);
+
+        run_with_small_stack([&] {
+            const kyut::FlatFunction x{*a->functions[0]};
+            const kyut::FlatFunction y{*b->functions[0]};
+
+            for ([[maybe_unused]] auto _ : state) {
+                benchmark::DoNotOptimize(kyut::compare3(x, y));
+            }
+        });
+
+        state.SetItemsProcessed(state.iterations() * depth);
+    }
+
+    void BM_walk_post_order_deep(benchmark::State& state) {
+        const auto depth = static_cast<std::size_t>(state.range(0));
+
+        wasm::Module module{};
+        const auto expr = make_deep_tree(module.allocator, depth);
+
+        run_with_small_stack([&] {
+            for ([[maybe_unused]] auto _ : state) {
+                std::size_t calls = 0;
+
+                kyut::walk_post_order(
+                    expr,
+                    []([[maybe_unused]] const wasm::Expression& e) { return true; },
+                    [&](const wasm::Expression& e) { calls += e.is<wasm::Call>() ? 1 : 0; });
+
+                benchmark::DoNotOptimize(calls);
+            }
+        });
+
+        state.SetItemsProcessed(state.iterations() * depth);
+    }
+
+    void BM_operand_swapping_deep(benchmark::State& state) {
+        const auto depth = static_cast<std::size_t>(state.range(0));
+        const auto module = make_deep_module(depth);
+
+        run_with_small_stack([&] {
+            for ([[maybe_unused]] auto _ : state) {
+                kyut::CircularBitStreamReader r{"watermark"};
+                benchmark::DoNotOptimize(kyut::methods::operand_swapping::embed(r, *module, std::numeric_limits<std::size_t>::max()));
+
+                kyut::BitStreamWriter w{};
+                benchmark::DoNotOptimize(kyut::methods::operand_swapping::extract(w, *module));
+            }
+        });
+
+        state.SetItemsProcessed(state.iterations() * depth);
+    }
+
+    void BM_operand_swapping_jobs(benchmark::State& state) {
+        const auto num_threads = static_cast<std::size_t>(state.range(0));
+        const auto module = make_wide_module(1024, 256);
+
+        for ([[maybe_unused]] auto _ : state) {
+            kyut::CircularBitStreamReader r{"watermark"};
+            benchmark::DoNotOptimize(kyut::methods::operand_swapping::embed(r, *module, std::numeric_limits<std::size_t>::max(), num_threads));
+
+            kyut::BitStreamWriter w{};
+            benchmark::DoNotOptimize(kyut::methods::operand_swapping::extract(w, *module, num_threads));
+        }
+    }
+
+    void BM_function_reordering_jobs(benchmark::State& state) {
+        const auto num_threads = static_cast<std::size_t>(state.range(0));
+        const auto module = make_wide_module(16384, 64);
+
+        for ([[maybe_unused]] auto _ : state) {
+            kyut::CircularBitStreamReader r{"watermark"};
+            benchmark::DoNotOptimize(kyut::methods::function_reordering::embed(r, *module, std::numeric_limits<std::size_t>::max(), 20, num_threads));
+
+            kyut::BitStreamWriter w{};
+            benchmark::DoNotOptimize(kyut::methods::function_reordering::extract(w, *module, 20, num_threads));
+        }
+    }
+
+    void BM_parallel_sort_flat(benchmark::State& state) {
+        const auto num_threads = static_cast<std::size_t>(state.range(0));
+        const auto module = make_wide_module(16384, 64);
+
+        std::vector<kyut::FlatFunction> flats{};
+        for (const auto& f : module->functions) {
+            flats.emplace_back(*f);
+        }
+
+        std::vector<const kyut::FlatFunction*> order{};
+        for (const auto& f : flats) {
+            order.emplace_back(&f);
+        }
+
+        std::shuffle(std::begin(order), std::end(order), std::mt19937{42});
+
+        for ([[maybe_unused]] auto _ : state) {
+            state.PauseTiming();
+            auto v = order;
+            state.ResumeTiming();
+
+            kyut::parallel_sort(std::begin(v), std::end(v), num_threads, [](const auto& a, const auto& b) {
+                return kyut::compare3(*a, *b) < 0;
+            });
+
+            benchmark::DoNotOptimize(v.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * order.size());
+    }
+} // namespace
+
+BENCHMARK(BM_compare3_deep)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_flat_function_deep)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_compare3_flat_deep)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_walk_post_order_deep)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_operand_swapping_deep)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->UseRealTime();
+BENCHMARK(BM_operand_swapping_jobs)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_function_reordering_jobs)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_parallel_sort_flat)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
@@ -0,0 +1,37 @@
+ExternalProject_Add(benchmark
+    GIT_REPOSITORY  "https://github.com/google/benchmark.git"
+    GIT_TAG         "v1.5.2"
+    PREFIX          "${CMAKE_CURRENT_BINARY_DIR}/benchmark"
+    SOURCE_DIR      "${CMAKE_CURRENT_BINARY_DIR}/benchmark/src"
+    BINARY_DIR      "${CMAKE_CURRENT_BINARY_DIR}/benchmark/build"
+    STAMP_DIR       "${CMAKE_CURRENT_BINARY_DIR}/benchmark/stamp"
+    UPDATE_COMMAND  ""
+    INSTALL_COMMAND ""
+    TEST_COMMAND    ""
+    CMAKE_ARGS
+        -DCMAKE_CXX_COMPILER=${CMAKE_CXX_COMPILER}
+        -DCMAKE_BUILD_TYPE=Release
+        -DBENCHMARK_ENABLE_TESTING=OFF
+        -DBENCHMARK_ENABLE_GTEST_TESTS=OFF
+)
+
+ExternalProject_Get_Property(benchmark source_dir)
+ExternalProject_Get_Property(benchmark binary_dir)
+
+add_library(benchmark::benchmark STATIC IMPORTED)
+
+make_directory("${source_dir}/include") # To suppress non-exist directory warnings
+
+set_target_properties(benchmark::benchmark PROPERTIES
+    IMPORTED_LOCATION "${binary_dir}/src/libbenchmark.a"
+    INTERFACE_INCLUDE_DIRECTORIES "${source_dir}/include"
+)
+
+add_library(benchmark::benchmark_main STATIC IMPORTED)
+
+set_target_properties(benchmark::benchmark_main PROPERTIES
+    IMPORTED_LOCATION "${binary_dir}/src/libbenchmark_main.a"
+)
+
+add_dependencies(benchmark::benchmark benchmark)
+add_dependencies(benchmark::benchmark_main benchmark)
@@ -1,6 +1,7 @@
 #ifndef INCLUDE_kyut_BitStreamWriter_hpp
 #define INCLUDE_kyut_BitStreamWriter_hpp
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <string_view>
@@ -26,22 +27,40 @@ namespace kyut {
         void write(std::uint64_t x, std::size_t size_bits) {
             assert(size_bits <= 64);
 
-            for (std::size_t i = 0; i < size_bits; i++) {
-                const auto bit = (x >> (size_bits - i - 1)) & 1;
-                write_bit(bit != 0);
+            const auto offset_bits = pos_bits_;
+            pos_bits_ += size_bits;
+
+            if (const auto size_bytes = (pos_bits_ + 7) / 8; size_bytes > data_.size()) {
+                data_.resize(size_bytes);
             }
+
+            store<false>(offset_bits, x, size_bits);
+        }
+
+        // Writes to [offset_bits, offset_bits + size_bits), which must be within the stream and not written yet.
+        // Disjoint ranges can be written from multiple threads at once.
+        void write_at(std::size_t offset_bits, std::uint64_t x, std::size_t size_bits) {
+            assert(size_bits <= 64);
+            assert(offset_bits + size_bits <= pos_bits_);
+
+            store<true>(offset_bits, x, size_bits);
         }
 
         void write_bit(bool x) {
-            const auto n = pos_bits_ >> 3;
-            const auto k = pos_bits_ & 7;
+            write(x ? 1 : 0, 1);
+        }
 
-            if (k == 0) {
-                data_.emplace_back(0);
-            }
+        // Reserves space for a stream of `size_bits` bits in total.
+        void reserve(std::size_t size_bits) {
+            data_.reserve((size_bits + 7) / 8);
+        }
+
+        // Extends the stream to `size_bits` bits with zeros, to be filled by `write_at`.
+        void resize(std::size_t size_bits) {
+            assert(size_bits >= pos_bits_);
 
-            data_[n] |= (x ? 1 : 0) << (7 - k);
-            pos_bits_++;
+            data_.resize((size_bits + 7) / 8);
+            pos_bits_ = size_bits;
         }
 
         std::size_t position_bits() const noexcept {
@@ -57,6 +76,49 @@ namespace kyut {
         }
 
     private:
+        template <bool Shared>
+        void store(std::size_t offset_bits, std::uint64_t x, std::size_t size_bits) {
+            if (size_bits == 0) {
+                return;
+            }
+
+            // Align the bits to write to the most significant bit
+            x <<= 64 - size_bits;
+
+            auto i = offset_bits >> 3;
+            const auto k = offset_bits & 7;
+
+            // Fill the first byte
+            if (k != 0) {
+                const auto n = (std::min)(8 - k, size_bits);
+
+                merge<Shared>(i++, static_cast<std::uint8_t>(x >> (56 + k)));
+                x <<= n;
+                size_bits -= n;
+            }
+
+            // Whole bytes belong to this range only
+            while (size_bits >= 8) {
+                data_[i++] = static_cast<std::uint8_t>(x >> 56);
+                x <<= 8;
+                size_bits -= 8;
+            }
+
+            if (size_bits > 0) {
+                merge<Shared>(i, static_cast<std::uint8_t>(x >> 56));
+            }
+        }
+
+        template <bool Shared>
+        void merge(std::size_t i, std::uint8_t bits) {
+            if constexpr (Shared) {
+                // Partial bytes may be shared with the ranges of other threads
+                __atomic_fetch_or(&data_[i], bits, __ATOMIC_RELAXED);
+            } else {
+                data_[i] |= bits;
+            }
+        }
+
         std::vector<std::uint8_t> data_;
         std::size_t pos_bits_;
     };
@@ -1,6 +1,7 @@
 #ifndef INCLUDE_kyut_CircularBitStreamReader_hpp
 #define INCLUDE_kyut_CircularBitStreamReader_hpp
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <string_view>
@@ -11,13 +12,15 @@ namespace kyut {
     public:
         explicit CircularBitStreamReader(std::vector<std::uint8_t>&& data)
             : data_(std::move(data))
-            , pos_bits_(0) {
+            , pos_bits_(0)
+            , end_bits_(data_.size() * 8) {
             assert(data_.size() > 0);
         }
 
         explicit CircularBitStreamReader(std::string_view data)
             : data_(reinterpret_cast<const std::uint8_t*>(data.data()), reinterpret_cast<const std::uint8_t*>(data.data() + data.size()))
-            , pos_bits_(0) {
+            , pos_bits_(0)
+            , end_bits_(data_.size() * 8) {
             assert(data_.size() > 0);
         }
 
@@ -31,25 +34,46 @@ namespace kyut {
         ~CircularBitStreamReader() noexcept = default;
 
         std::uint64_t read(std::size_t size_bits) {
-            std::uint64_t x = 0;
-            for (std::size_t i = 0; i < size_bits; i++) {
-                x <<= 1;
-                x |= read_bit() ? 1 : 0;
-            }
+            const auto x = read_at(pos_bits_, size_bits);
+
+            seek(pos_bits_ + size_bits);
 
             return x;
         }
 
-        bool read_bit() {
-            const auto n = pos_bits_ >> 3;
-            const auto k = pos_bits_ & 7;
+        // Reads at `offset_bits` without moving the position; safe to call from multiple threads.
+        std::uint64_t read_at(std::size_t offset_bits, std::size_t size_bits) const {
+            assert(size_bits <= 64);
 
-            const auto bit = (data_[n] >> (7 - k)) & 1;
+            auto pos = offset_bits < end_bits_ ? offset_bits : offset_bits % end_bits_;
 
-            pos_bits_++;
-            pos_bits_ %= size_bits();
+            // Read up to a byte at a time; the stream wraps around at byte boundaries only
+            std::uint64_t x = 0;
+            while (size_bits > 0) {
+                const auto k = pos & 7;
+                const auto n = (std::min)(8 - k, size_bits);
+
+                const auto bits = (data_[pos >> 3] >> (8 - k - n)) & ((1u << n) - 1);
 
-            return bit != 0;
+                x = (x << n) | bits;
+                size_bits -= n;
+                pos += n;
+
+                if (pos == end_bits_) {
+                    pos = 0;
+                }
+            }
+
+            return x;
+        }
+
+        // Moves the position to `offset_bits`, wrapping around.
+        void seek(std::size_t offset_bits) noexcept {
+            pos_bits_ = offset_bits < end_bits_ ? offset_bits : offset_bits % end_bits_;
+        }
+
+        bool read_bit() {
+            return read(1) != 0;
         }
 
         std::size_t size_bytes() const noexcept {
@@ -67,6 +91,7 @@ namespace kyut {
     private:
         std::vector<std::uint8_t> data_;
         std::size_t pos_bits_;
+        std::size_t end_bits_; // Wrap point
     };
 } // namespace kyut
 
@@ -0,0 +1,111 @@
+#ifndef INCLUDE_kyut_MultiwordInteger_hpp
+#define INCLUDE_kyut_MultiwordInteger_hpp
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace kyut {
+    // Unsigned integer of up to `Words` 32-bit words, least significant word first.
+    // Only the arithmetic with small numbers needed for mixed radix conversion is supported.
+    template <std::size_t Words>
+    class MultiwordInteger {
+    public:
+        static constexpr std::size_t word_bits = 32;
+        static constexpr std::size_t max_words = Words;
+
+        MultiwordInteger() noexcept
+            : words_()
+            , size_(0) {
+        }
+
+        // Number of significant words
+        std::size_t size() const noexcept {
+            return size_;
+        }
+
+        std::uint32_t word(std::size_t i) const noexcept {
+            return i < size_ ? words_[i] : 0;
+        }
+
+        // Sets the value to zero, keeping the storage as is.
+        void clear() noexcept {
+            size_ = 0;
+        }
+
+        // Sets the lowest `size` words, the others becoming zero.
+        template <typename Iterator>
+        void assign(Iterator begin, std::size_t size) {
+            assert(size <= Words);
+
+            for (std::size_t i = 0; i < size; i++) {
+                words_[i] = *begin++;
+            }
+
+            size_ = size;
+            trim();
+        }
+
+        std::size_t bit_width() const noexcept {
+            if (size_ == 0) {
+                return 0;
+            }
+
+            std::size_t width = (size_ - 1) * word_bits;
+            for (auto top = words_[size_ - 1]; top != 0; top >>= 1) {
+                width++;
+            }
+
+            return width;
+        }
+
+        // *this = *this * m + a
+        void multiply_add(std::uint32_t m, std::uint32_t a) {
+            std::uint64_t carry = a;
+
+            for (std::size_t i = 0; i < size_; i++) {
+                const auto x = std::uint64_t{words_[i]} * m + carry;
+
+                words_[i] = static_cast<std::uint32_t>(x);
+                carry = x >> word_bits;
+            }
+
+            if (carry != 0) {
+                assert(size_ < Words);
+                words_[size_++] = static_cast<std::uint32_t>(carry);
+            }
+
+            trim();
+        }
+
+        // *this /= d, returning the remainder
+        std::uint32_t divide(std::uint32_t d) {
+            assert(d != 0);
+
+            std::uint64_t remainder = 0;
+            for (std::size_t i = size_; i-- > 0;) {
+                const auto x = (remainder << word_bits) | words_[i];
+
+                words_[i] = static_cast<std::uint32_t>(x / d);
+                remainder = x % d;
+            }
+
+            trim();
+
+            return static_cast<std::uint32_t>(remainder);
+        }
+
+    private:
+        void trim() noexcept {
+            while (size_ > 0 && words_[size_ - 1] == 0) {
+                size_--;
+            }
+        }
+
+        std::array<std::uint32_t, Words> words_;
+        std::size_t size_;
+    };
+} // namespace kyut
+
+#endif // INCLUDE_kyut_MultiwordInteger_hpp
@@ -0,0 +1,43 @@
+#ifndef INCLUDE_kyut_NameKey_hpp
+#define INCLUDE_kyut_NameKey_hpp
+
+#include <cstdint>
+#include <string_view>
+
+namespace kyut {
+    // Name with its first 8 bytes packed big-endian, so that most comparisons are integer comparisons
+    struct NameKey {
+        std::uint64_t prefix;
+        std::string_view str;
+    };
+
+    // Names are compared as C strings, so `str` ends at the first null character
+    inline NameKey name_key(std::string_view str) {
+        str = str.substr(0, str.find('\0'));
+
+        std::uint64_t prefix = 0;
+        for (std::size_t i = 0; i < 8 && i < str.size(); i++) {
+            prefix |= std::uint64_t{static_cast<unsigned char>(str[i])} << (56 - 8 * i);
+        }
+
+        return {prefix, str};
+    }
+
+    // Same order as `std::strcmp`
+    inline int compare3(const NameKey& a, const NameKey& b) {
+        if (a.prefix != b.prefix) {
+            return a.prefix < b.prefix ? -1 : 1;
+        }
+
+        // Names shorter than 8 bytes are in the prefix entirely, and interned names share their storage
+        if ((a.prefix & 0xFF) == 0 || (a.str.data() == b.str.data() && a.str.size() == b.str.size())) {
+            return 0;
+        }
+
+        // `std::char_traits<char>` compares characters as unsigned char
+        const auto c = a.str.substr(8).compare(b.str.substr(8));
+        return c < 0 ? -1 : c > 0 ? 1 : 0;
+    }
+} // namespace kyut
+
+#endif // INCLUDE_kyut_NameKey_hpp
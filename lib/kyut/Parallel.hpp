@@ -0,0 +1,107 @@
+#ifndef INCLUDE_kyut_Parallel_hpp
+#define INCLUDE_kyut_Parallel_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kyut {
+    // Calls `f(i)` for each i in [0, n) on up to `num_threads` threads, including the calling thread.
+    // The first exception thrown by `f` is rethrown after all threads finish.
+    template <typename Function>
+    void parallel_for(std::size_t n, std::size_t num_threads, Function&& f) {
+        num_threads = (std::min)(num_threads, n);
+
+        if (num_threads <= 1) {
+            for (std::size_t i = 0; i < n; i++) {
+                f(i);
+            }
+
+            return;
+        }
+
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error{};
+        std::mutex error_mutex{};
+
+        const auto worker = [&] {
+            try {
+                for (auto i = next++; i < n; i = next++) {
+                    f(i);
+                }
+            } catch (...) {
+                // Let the other threads run out of work
+                next = n;
+
+                const std::lock_guard<std::mutex> lock{error_mutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads{};
+        threads.reserve(num_threads - 1);
+
+        for (std::size_t i = 1; i < num_threads; i++) {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Stable sort on up to `num_threads` threads.
+    // Blocks are sorted in parallel and merged pairwise, so the result is the same as `std::stable_sort` for any `num_threads`.
+    template <typename RandomAccessIterator, typename Less>
+    void parallel_sort(RandomAccessIterator begin, RandomAccessIterator end, std::size_t num_threads, Less less) {
+        // Smaller blocks are not worth a thread
+        constexpr std::size_t min_block_size = 64;
+
+        const auto n = static_cast<std::size_t>(std::distance(begin, end));
+        const auto num_blocks = (std::min)(num_threads, n / min_block_size);
+
+        if (num_blocks <= 1) {
+            std::stable_sort(begin, end, less);
+            return;
+        }
+
+        std::vector<RandomAccessIterator> bounds{};
+        bounds.reserve(num_blocks + 1);
+
+        for (std::size_t i = 0; i <= num_blocks; i++) {
+            bounds.emplace_back(begin + n * i / num_blocks);
+        }
+
+        parallel_for(num_blocks, num_threads, [&](std::size_t i) {
+            std::stable_sort(bounds[i], bounds[i + 1], less);
+        });
+
+        // Merge runs [lo, mid) and [mid, hi) of `width` blocks each
+        for (std::size_t width = 1; width < num_blocks; width *= 2) {
+            const auto num_merges = (num_blocks + 2 * width - 1) / (2 * width);
+
+            parallel_for(num_merges, num_threads, [&](std::size_t i) {
+                const auto lo = 2 * width * i;
+                const auto mid = (std::min)(lo + width, num_blocks);
+                const auto hi = (std::min)(lo + 2 * width, num_blocks);
+
+                std::inplace_merge(bounds[lo], bounds[mid], bounds[hi], less);
+            });
+        }
+    }
+} // namespace kyut
+
+#endif // INCLUDE_kyut_Parallel_hpp
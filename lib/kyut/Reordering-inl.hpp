@@ -4,15 +4,400 @@
 #include "Reordering.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "BitStreamWriter.hpp"
 #include "CircularBitStreamReader.hpp"
+#include "MultiwordInteger.hpp"
+#include "Parallel.hpp"
 #include "SafeUnique.hpp"
 
 namespace kyut {
     namespace detail {
-        // {log2(n!) | x in [2, 20]}
-        constexpr std::size_t factorial_bit_width_table[max_chunk_size + 1] = {
-            0, 0, 1, 2, 4, 6, 9, 12, 15, 18, 21, 25, 28, 32, 36, 40, 44, 48, 52, 56, 61};
+        constexpr std::size_t max_small_chunk_size = 20;
+
+        // {floor(log2(n!)) | n in [0, 20]}
+        constexpr auto factorial_bit_width_table = [] {
+            std::array<std::size_t, max_small_chunk_size + 1> table{};
+
+            std::uint64_t factorial = 1;
+            for (std::size_t n = 0; n <= max_small_chunk_size; n++) {
+                factorial *= (std::max)(n, std::size_t{1});
+
+                for (auto x = factorial; x > 1; x >>= 1) {
+                    table[n]++;
+                }
+            }
+
+            return table;
+        }();
+
+        static_assert(factorial_bit_width_table[max_small_chunk_size] == 61);
+
+        static_assert(max_chunk_size <= 4096);
+
+        // log2(n!) < n * log2(n) <= 4096 * 12 bits
+        using PermutationInteger = MultiwordInteger<(max_chunk_size * 12 + 31) / 32>;
+
+        // floor(log2(n!)), the number of watermark bits in a chunk of `n` unique elements
+        inline std::size_t factorial_bit_width(std::size_t n) {
+            assert(n <= max_chunk_size);
+
+            if (n <= max_small_chunk_size) {
+                return factorial_bit_width_table[n];
+            }
+
+            static const auto table = [] {
+                std::vector<std::size_t> table(max_chunk_size + 1);
+
+                PermutationInteger factorial{};
+                factorial.multiply_add(1, 1);
+
+                for (std::size_t i = 1; i <= max_chunk_size; i++) {
+                    factorial.multiply_add(static_cast<std::uint32_t>(i), 0);
+                    table[i] = factorial.bit_width() - 1;
+                }
+
+                return table;
+            }();
+
+            return table[n];
+        }
+
+        template <typename Less, typename T>
+        inline bool equivalent(const Less& less, const T& a, const T& b) {
+            return !less(a, b) && !less(b, a);
+        }
+
+        template <typename Compare3, typename T>
+        inline bool equivalent(const ThreeWayLess<Compare3>& less, const T& a, const T& b) {
+            return less.compare3(a, b) == 0;
+        }
+
+        // Offsets of elements in a chunk, sized to at least the chunk
+        using ChunkIndices = std::vector<std::uint32_t>;
+
+        // Scratch space of a thread for the chunks it sorts.
+        // Chunks of `max_chunk_size` elements would take 16 KiB of stack for each buffer, and 6 KiB for each of
+        // `words` and `watermark`.
+        struct ChunkBuffers {
+            ChunkIndices sorted;
+            ChunkIndices ranks;
+            ChunkIndices chunk;
+            ChunkIndices positions;
+            ChunkIndices out; // Digits or order of a chunk, passed to the functions using the buffers above
+            std::array<std::uint32_t, PermutationInteger::max_words> words; // Watermark words of a chunk being read
+            PermutationInteger watermark;
+        };
+
+        // Buffers of the calling thread, grown to `n` elements
+        inline ChunkBuffers& chunk_buffers(std::size_t n) {
+            thread_local ChunkBuffers buffers{};
+
+            for (auto* b : {&buffers.sorted, &buffers.ranks, &buffers.chunk, &buffers.positions, &buffers.out}) {
+                if (b->size() < n) {
+                    b->resize(n);
+                }
+            }
+
+            return buffers;
+        }
+
+        // Conversion between the watermark of a chunk of `N` unique elements and its digits, fully unrolled
+        template <std::size_t N>
+        struct SmallPermutationKernel {
+            // {N * (N - 1) * ... * (N - i + 1) | i in [0, N)}
+            static constexpr std::array<std::uint64_t, N> bases = [] {
+                std::array<std::uint64_t, N> bases{};
+
+                std::uint64_t base = 1;
+                for (std::size_t i = 0; i < N; i++) {
+                    bases[i] = base;
+                    base *= N - i;
+                }
+
+                return bases;
+            }();
+
+            static void decode(std::uint64_t watermark, ChunkIndices& digits) {
+                decode_digits(watermark, digits, std::make_index_sequence<N>{});
+            }
+
+            static std::uint64_t encode(const ChunkIndices& digits) {
+                return encode_digits(digits, std::make_index_sequence<N>{});
+            }
+
+        private:
+            template <std::size_t... Is>
+            static void decode_digits([[maybe_unused]] std::uint64_t watermark, [[maybe_unused]] ChunkIndices& digits, std::index_sequence<Is...>) {
+                ((digits[Is] = static_cast<std::uint32_t>(watermark % (N - Is)), watermark /= (N - Is)), ...);
+            }
+
+            template <std::size_t... Is>
+            static std::uint64_t encode_digits([[maybe_unused]] const ChunkIndices& digits, std::index_sequence<Is...>) {
+                return (std::uint64_t{0} + ... + (digits[Is] * bases[Is]));
+            }
+        };
+
+        struct SmallPermutationKernelEntry {
+            void (*decode)(std::uint64_t watermark, ChunkIndices& digits);
+            std::uint64_t (*encode)(const ChunkIndices& digits);
+        };
+
+        template <std::size_t... Ns>
+        constexpr std::array<SmallPermutationKernelEntry, sizeof...(Ns)> make_small_permutation_kernels(std::index_sequence<Ns...>) {
+            return {{{&SmallPermutationKernel<Ns>::decode, &SmallPermutationKernel<Ns>::encode}...}};
+        }
+
+        // Kernels indexed by the number of unique elements in a chunk
+        constexpr auto small_permutation_kernels = make_small_permutation_kernels(std::make_index_sequence<max_small_chunk_size + 1>{});
+
+        // Reads the watermark of a chunk of `count` unique elements at `offset_bits` as mixed radix digits;
+        // `digits[i]` in [0, count - i) is the offset from `i` of the element to swap with.
+        inline std::size_t read_permutation(
+            const CircularBitStreamReader& r,
+            std::size_t offset_bits,
+            std::size_t count,
+            ChunkIndices& digits) {
+            const std::size_t bit_width = factorial_bit_width(count);
+
+            if (count <= max_small_chunk_size) {
+                small_permutation_kernels[count].decode(r.read_at(offset_bits, bit_width), digits);
+
+                return bit_width;
+            }
+
+            // Read the most significant word first
+            const auto num_words = (bit_width + PermutationInteger::word_bits - 1) / PermutationInteger::word_bits;
+
+            auto& buffers = chunk_buffers(count);
+            auto& words = buffers.words;
+            for (std::size_t i = num_words; i-- > 0;) {
+                const auto n = (std::min)(PermutationInteger::word_bits, bit_width - i * PermutationInteger::word_bits);
+
+                words[i] = static_cast<std::uint32_t>(r.read_at(offset_bits, n));
+                offset_bits += n;
+            }
+
+            auto& watermark = buffers.watermark;
+            watermark.assign(std::begin(words), num_words);
+
+            // Divide by as many radices at once as fit in a word
+            for (std::size_t i = 0; i < count;) {
+                std::uint64_t divisor = 1;
+                std::size_t j = i;
+                while (j < count && divisor * (count - j) <= std::numeric_limits<std::uint32_t>::max()) {
+                    divisor *= count - j++;
+                }
+
+                auto remainder = watermark.divide(static_cast<std::uint32_t>(divisor));
+                for (; i < j; i++) {
+                    digits[i] = remainder % (count - i);
+                    remainder /= (count - i);
+                }
+            }
+
+            return bit_width;
+        }
+
+        // Writes the digits read by `read_permutation` to `offset_bits`, which `w` must already cover.
+        inline std::size_t write_permutation(
+            BitStreamWriter& w,
+            std::size_t offset_bits,
+            std::size_t count,
+            const ChunkIndices& digits) {
+            const std::size_t bit_width = factorial_bit_width(count);
+
+            if (count <= max_small_chunk_size) {
+                w.write_at(offset_bits, small_permutation_kernels[count].encode(digits), bit_width);
+
+                return bit_width;
+            }
+
+            // Multiply by as many radices at once as fit in a word
+            auto& watermark = chunk_buffers(count).watermark;
+            watermark.clear();
+            for (std::size_t i = count; i > 0;) {
+                std::uint64_t multiplier = 1;
+                std::uint64_t addend = 0;
+                while (i > 0 && multiplier * (count - i + 1) <= std::numeric_limits<std::uint32_t>::max()) {
+                    i--;
+                    multiplier *= count - i;
+                    addend = addend * (count - i) + digits[i];
+                }
+
+                watermark.multiply_add(static_cast<std::uint32_t>(multiplier), static_cast<std::uint32_t>(addend));
+            }
+
+            // Write the most significant word first
+            const auto num_words = (bit_width + PermutationInteger::word_bits - 1) / PermutationInteger::word_bits;
+
+            for (std::size_t i = num_words; i-- > 0;) {
+                const auto n = (std::min)(PermutationInteger::word_bits, bit_width - i * PermutationInteger::word_bits);
+
+                w.write_at(offset_bits, watermark.word(i), n);
+                offset_bits += n;
+            }
+
+            return bit_width;
+        }
+
+        // Stable merge sort of `sorted[0, n)`, using `buffer` as scratch space
+        template <typename Less>
+        inline void sort_chunk(std::size_t n, const Less& less, ChunkIndices& sorted, ChunkIndices& buffer) {
+            constexpr std::size_t run_size = 32;
+
+            // Binary insertion sort takes about log2(n!) comparisons in each run
+            for (std::size_t begin = 0; begin < n; begin += run_size) {
+                const auto end = (std::min)(begin + run_size, n);
+
+                for (auto i = begin; i < end; i++) {
+                    const auto x = sorted[i];
+                    const auto pos = std::upper_bound(std::begin(sorted) + begin, std::begin(sorted) + i, x, less);
+
+                    std::move_backward(pos, std::begin(sorted) + i, std::begin(sorted) + i + 1);
+                    *pos = x;
+                }
+            }
+
+            auto* from = &sorted;
+            auto* to = &buffer;
+
+            for (std::size_t width = run_size; width < n; width *= 2) {
+                for (std::size_t begin = 0; begin < n; begin += 2 * width) {
+                    const auto mid = (std::min)(begin + width, n);
+                    const auto end = (std::min)(begin + 2 * width, n);
+
+                    std::merge(
+                        std::begin(*from) + begin,
+                        std::begin(*from) + mid,
+                        std::begin(*from) + mid,
+                        std::begin(*from) + end,
+                        std::begin(*to) + begin,
+                        less);
+                }
+
+                std::swap(from, to);
+            }
+
+            if (from != &sorted) {
+                std::copy(std::begin(*from), std::begin(*from) + n, std::begin(sorted));
+            }
+        }
+
+        // Stably sorts the offsets [0, n) of a chunk by key and ranks them; equivalent keys get the same rank.
+        // Returns the number of distinct keys.
+        template <typename RandomAccessIterator, typename Less>
+        inline std::size_t rank_chunk(
+            RandomAccessIterator keys,
+            std::size_t n,
+            const Less& less,
+            ChunkIndices& sorted,
+            ChunkIndices& ranks) {
+            assert(n <= max_chunk_size);
+
+            std::iota(std::begin(sorted), std::begin(sorted) + n, std::uint32_t{0});
+
+            // `ranks` is free until the elements are sorted
+            sort_chunk(
+                n,
+                [&](std::uint32_t a, std::uint32_t b) {
+                    return less(keys[a], keys[b]);
+                },
+                sorted,
+                ranks);
+
+            std::uint32_t rank = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                if (i > 0 && less(keys[sorted[i - 1]], keys[sorted[i]])) {
+                    rank++;
+                }
+
+                ranks[sorted[i]] = rank;
+            }
+
+            return n == 0 ? 0 : rank + 1;
+        }
+
+        // Sorts a chunk into `order`, moving duplicates after the unique elements;
+        // `order[i]` is the offset of the element to move to offset `i`.
+        // Returns the number of unique elements.
+        template <typename RandomAccessIterator, typename Less>
+        inline std::size_t sort_ranked_chunk(RandomAccessIterator keys, std::size_t n, const Less& less, ChunkIndices& order) {
+            auto& buffers = chunk_buffers(n);
+            auto& sorted = buffers.sorted;
+            auto& ranks = buffers.ranks;
+            const std::size_t count = rank_chunk(keys, n, less, sorted, ranks);
+
+            std::size_t unique_end = 0;
+            std::size_t duplicate_end = count;
+            for (std::size_t i = 0; i < n; i++) {
+                if (i == 0 || ranks[sorted[i - 1]] != ranks[sorted[i]]) {
+                    order[unique_end++] = sorted[i];
+                } else {
+                    order[duplicate_end++] = sorted[i];
+                }
+            }
+
+            return count;
+        }
+
+        // Computes the digits of the watermark in a chunk, as read by `read_permutation`.
+        // Returns the number of unique elements.
+        template <typename RandomAccessIterator, typename Less>
+        inline std::size_t digits_of_ranked_chunk(RandomAccessIterator keys, std::size_t n, const Less& less, ChunkIndices& digits) {
+            auto& buffers = chunk_buffers(n);
+            auto& sorted = buffers.sorted;
+            auto& ranks = buffers.ranks;
+            const std::size_t count = rank_chunk(keys, n, less, sorted, ranks);
+
+            // Ranks of the unique elements, starting in sorted order, and the position of each rank in `chunk`
+            auto& chunk = buffers.chunk;
+            auto& positions = buffers.positions;
+            std::iota(std::begin(chunk), std::begin(chunk) + count, std::uint32_t{0});
+            std::iota(std::begin(positions), std::begin(positions) + count, std::uint32_t{0});
+
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint32_t pos = positions[ranks[i]];
+
+                // Offset `i` holds a duplicate of an element before it, which embedding never produces
+                if (pos < i) {
+                    digits[i] = 0;
+                    continue;
+                }
+
+                digits[i] = pos - i;
+
+                // Remove the element found in this step.
+                std::swap(chunk[i], chunk[pos]);
+                positions[chunk[i]] = i;
+                positions[chunk[pos]] = pos;
+            }
+
+            return count;
+        }
+
+        template <typename RandomAccessIterator, typename Less>
+        inline std::size_t extract_from_ranked_chunk(
+            BitStreamWriter& w,
+            RandomAccessIterator keys,
+            std::size_t n,
+            const Less& less) {
+            auto& digits = chunk_buffers(n).out;
+            const std::size_t count = digits_of_ranked_chunk(keys, n, less, digits);
+
+            // Extract watermark.
+            const auto offset_bits = w.position_bits();
+            w.resize(offset_bits + factorial_bit_width(count));
+
+            return write_permutation(w, offset_bits, count, digits);
+        }
 
         template <typename RandomAccessIterator, typename Less>
         inline std::size_t embed_in_chunk(
@@ -28,21 +413,20 @@ namespace kyut {
 
             // Assume unique
             end = safe_unique(begin, end, [&](const auto& a, const auto& b) {
-                return !less(a, b) && !less(a, b);
+                return equivalent(less, a, b);
             });
 
             // Embed watermark.
             const std::size_t count = std::distance(begin, end);
-            const std::size_t bit_width = factorial_bit_width_table[count];
 
-            std::uint64_t watermark = r.read(bit_width);
+            auto& digits = chunk_buffers(count).out;
+            const std::size_t bit_width = read_permutation(r, r.position_bits(), count, digits);
 
-            for (std::size_t i = 0; i < count; i++) {
-                const std::uint64_t w = watermark % (count - i);
-                watermark /= (count - i);
+            r.seek(r.position_bits() + bit_width);
 
+            for (std::size_t i = 0; i < count; i++) {
                 const auto it = begin + i;
-                std::iter_swap(it, it + w);
+                std::iter_swap(it, it + digits[i]);
             }
 
             return bit_width;
@@ -78,97 +462,210 @@ namespace kyut {
         }
 
         template <typename RandomAccessIterator, typename Less>
-        inline std::size_t extract_from_chunk(
+        inline std::size_t extract_by_reordering(
             BitStreamWriter& w,
+            std::size_t chunk_size,
             RandomAccessIterator begin,
             RandomAccessIterator end,
             Less less) {
+            assert(2 <= chunk_size && chunk_size <= max_chunk_size);
             assert(std::distance(begin, end) >= 0);
-            assert(std::distance(begin, end) <= std::ptrdiff_t{max_chunk_size});
 
-            // Sort the chunk.
-            std::vector<RandomAccessIterator> chunk{};
-            chunk.reserve(std::distance(begin, end));
+            const std::size_t count = std::distance(begin, end);
+
+            std::size_t size_bits = 0;
+            for (std::size_t i = 0; i < count; i += chunk_size) {
+                const std::size_t n = (std::min)(chunk_size, count - i);
+                const auto chunk_begin = begin + i;
 
-            for (auto it = begin; it != end; it++) {
-                chunk.emplace_back(it);
+                size_bits += extract_from_ranked_chunk(w, chunk_begin, n, less);
             }
 
-            std::sort(std::begin(chunk), std::end(chunk), [&less](const RandomAccessIterator& a, const RandomAccessIterator& b) {
-                return less(*a, *b);
-            });
+            return size_bits;
+        }
 
-            // Assume unique
-            chunk.erase(
-                safe_unique(std::begin(chunk), std::end(chunk), [&](const auto& a, const auto& b) {
-                    return !less(*a, *b) && !less(*a, *b);
-                }),
-                std::end(chunk));
+        template <typename RandomAccessIterator, typename Projection>
+        inline auto project(RandomAccessIterator begin, RandomAccessIterator end, Projection& projection) {
+            using Key = std::decay_t<decltype(projection(*begin))>;
 
-            const auto chunk_begin = std::begin(chunk);
-            const auto chunk_end = std::end(chunk);
+            std::vector<Key> keys{};
+            keys.reserve(std::distance(begin, end));
 
-            const std::size_t count = std::distance(chunk_begin, chunk_end);
-            if (count < 2) {
-                return 0;
+            for (auto it = begin; it != end; ++it) {
+                keys.emplace_back(projection(*it));
             }
 
-            const std::size_t bit_width = factorial_bit_width_table[count];
+            return keys;
+        }
 
-            // Extract watermark.
-            std::uint64_t watermark = 0;
-            std::uint64_t base = 1;
-            for (std::size_t i = 0; i < count; i++) {
-                const auto it = chunk_begin + i;
+        // Moves `*(begin + permutation[i])` to `begin + i` for each i.
+        template <typename RandomAccessIterator>
+        inline void gather(RandomAccessIterator begin, const std::vector<std::size_t>& permutation) {
+            std::vector<typename std::iterator_traits<RandomAccessIterator>::value_type> values{};
+            values.reserve(permutation.size());
+
+            for (const auto i : permutation) {
+                values.emplace_back(std::move(*(begin + i)));
+            }
+
+            std::move(std::begin(values), std::end(values), begin);
+        }
+
+        template <typename RandomAccessIterator, typename Less, typename Projection>
+        inline std::size_t embed_by_reordering(
+            CircularBitStreamReader& r,
+            std::size_t limit,
+            std::size_t chunk_size,
+            RandomAccessIterator begin,
+            RandomAccessIterator end,
+            Less less,
+            Projection projection,
+            std::size_t num_threads) {
+            assert(2 <= chunk_size && chunk_size <= max_chunk_size);
+            assert(std::distance(begin, end) >= 0);
 
-                // Find the position of `begin + i`.
-                const auto found = std::find_if(it, std::end(chunk), [&](const auto& a) {
-                    return !less(*a, *(begin + i)) && !less(*(begin + i), *a);
+            const std::size_t count = std::distance(begin, end);
+            const std::size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+            const auto keys = project(begin, end, projection);
+
+            std::vector<std::size_t> permutation(count);
+            std::iota(std::begin(permutation), std::end(permutation), std::size_t{0});
+
+            // Sort chunks a batch at a time, finding the offset of each chunk in the watermark until the limit
+            const std::size_t batch_size = num_threads <= 1 ? 1 : num_threads * 16;
+
+            std::vector<std::uint32_t> counts(num_chunks);
+            std::vector<std::size_t> offsets{0};
+
+            bool reached_limit = false;
+            for (std::size_t batch = 0; batch < num_chunks && !reached_limit; batch += batch_size) {
+                const auto batch_end = (std::min)(batch + batch_size, num_chunks);
+
+                parallel_for(batch_end - batch, num_threads, [&](std::size_t k) {
+                    const auto i = (batch + k) * chunk_size;
+                    const auto n = (std::min)(chunk_size, count - i);
+
+                    auto& order = chunk_buffers(n).out;
+                    counts[batch + k] = static_cast<std::uint32_t>(sort_ranked_chunk(std::begin(keys) + i, n, less, order));
+
+                    for (std::size_t j = 0; j < n; j++) {
+                        permutation[i + j] = i + order[j];
+                    }
                 });
 
-                // assert(found != std::end(chunk)); // FIXME: sometimes crashing here
-                if (found == std::end(chunk)) {
-                    base *= count - i;
-                    continue;
+                for (auto c = batch; c < batch_end && !reached_limit; c++) {
+                    offsets.push_back(offsets.back() + factorial_bit_width(counts[c]));
+
+                    if (offsets.back() >= limit) {
+                        reached_limit = true;
+
+                        // Leave the rest of the batch as it was
+                        for (auto i = (c + 1) * chunk_size; i < (std::min)(batch_end * chunk_size, count); i++) {
+                            permutation[i] = i;
+                        }
+                    }
                 }
+            }
 
-                const std::size_t pos = std::distance(it, found);
+            const auto num_embedded = offsets.size() - 1;
+            const auto start = r.position_bits();
 
-                watermark += pos * base;
-                base *= count - i;
+            // Embed watermark.
+            parallel_for(num_embedded, num_threads, [&](std::size_t c) {
+                const auto i = c * chunk_size;
 
-                // Remove `it` found in this step.
-                std::iter_swap(it, found);
-            }
+                auto& digits = chunk_buffers(counts[c]).out;
+                read_permutation(r, start + offsets[c], counts[c], digits);
 
-            // assert(watermark < (std::uint64_t{1} << bit_width));
-            w.write(watermark, bit_width);
+                for (std::size_t j = 0; j < counts[c]; j++) {
+                    std::swap(permutation[i + j], permutation[i + j + digits[j]]);
+                }
+            });
 
-            return bit_width;
+            r.seek(start + offsets.back());
+
+            gather(begin, permutation);
+
+            return offsets.back();
         }
 
-        template <typename RandomAccessIterator, typename Less>
+        template <typename RandomAccessIterator, typename Less, typename Projection>
         inline std::size_t extract_by_reordering(
             BitStreamWriter& w,
             std::size_t chunk_size,
             RandomAccessIterator begin,
             RandomAccessIterator end,
-            Less less) {
+            Less less,
+            Projection projection,
+            std::size_t num_threads) {
             assert(2 <= chunk_size && chunk_size <= max_chunk_size);
             assert(std::distance(begin, end) >= 0);
 
             const std::size_t count = std::distance(begin, end);
+            const std::size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+            const auto keys = project(begin, end, projection);
 
-            std::size_t size_bits = 0;
-            for (std::size_t i = 0; i < count; i += chunk_size) {
-                const std::size_t n = (std::min)(chunk_size, count - i);
-                const auto chunk_begin = begin + i;
-                const auto chunk_end = chunk_begin + n;
+            // Digits of all chunks, at the offsets of their elements
+            std::vector<std::uint32_t> counts(num_chunks);
+            std::vector<std::uint32_t> digits(count);
+
+            parallel_for(num_chunks, num_threads, [&](std::size_t c) {
+                const auto i = c * chunk_size;
+                const auto n = (std::min)(chunk_size, count - i);
+
+                auto& chunk_digits = chunk_buffers(n).out;
+                counts[c] = static_cast<std::uint32_t>(digits_of_ranked_chunk(std::begin(keys) + i, n, less, chunk_digits));
 
-                size_bits += extract_from_chunk(w, chunk_begin, chunk_end, less);
+                std::copy(std::begin(chunk_digits), std::begin(chunk_digits) + counts[c], std::begin(digits) + i);
+            });
+
+            std::vector<std::size_t> offsets{0};
+            for (const auto n : counts) {
+                offsets.push_back(offsets.back() + factorial_bit_width(n));
             }
 
-            return size_bits;
+            const auto start = w.position_bits();
+            w.resize(start + offsets.back());
+
+            // Extract watermark.
+            parallel_for(num_chunks, num_threads, [&](std::size_t c) {
+                const auto i = c * chunk_size;
+
+                auto& chunk_digits = chunk_buffers(counts[c]).out;
+                std::copy(std::begin(digits) + i, std::begin(digits) + i + counts[c], std::begin(chunk_digits));
+
+                write_permutation(w, start + offsets[c], counts[c], chunk_digits);
+            });
+
+            return offsets.back();
+        }
+
+        template <typename RandomAccessIterator, typename Less, typename Projection>
+        inline std::size_t capacity_by_reordering(
+            std::size_t chunk_size,
+            RandomAccessIterator begin,
+            RandomAccessIterator end,
+            Less less,
+            Projection projection,
+            std::size_t num_threads) {
+            assert(2 <= chunk_size && chunk_size <= max_chunk_size);
+            assert(std::distance(begin, end) >= 0);
+
+            const std::size_t count = std::distance(begin, end);
+            const std::size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+            const auto keys = project(begin, end, projection);
+
+            // Each chunk embeds a permutation of its distinct elements
+            std::vector<std::size_t> bits(num_chunks);
+            parallel_for(num_chunks, num_threads, [&](std::size_t c) {
+                const auto i = c * chunk_size;
+                const auto n = (std::min)(chunk_size, count - i);
+
+                auto& buffers = chunk_buffers(n);
+                bits[c] = factorial_bit_width(rank_chunk(std::begin(keys) + i, n, less, buffers.sorted, buffers.ranks));
+            });
+
+            return std::accumulate(std::begin(bits), std::end(bits), std::size_t{0});
         }
     } // namespace detail
 
@@ -192,6 +689,42 @@ namespace kyut {
         Less less) {
         return detail::extract_by_reordering(w, chunk_size, begin, end, less);
     }
+
+    template <typename RandomAccessIterator, typename Less, typename Projection>
+    inline std::size_t embed_by_reordering(
+        CircularBitStreamReader& r,
+        std::size_t limit,
+        std::size_t chunk_size,
+        RandomAccessIterator begin,
+        RandomAccessIterator end,
+        Less less,
+        Projection projection,
+        std::size_t num_threads) {
+        return detail::embed_by_reordering(r, limit, chunk_size, begin, end, less, projection, num_threads);
+    }
+
+    template <typename RandomAccessIterator, typename Less, typename Projection>
+    inline std::size_t extract_by_reordering(
+        BitStreamWriter& w,
+        std::size_t chunk_size,
+        RandomAccessIterator begin,
+        RandomAccessIterator end,
+        Less less,
+        Projection projection,
+        std::size_t num_threads) {
+        return detail::extract_by_reordering(w, chunk_size, begin, end, less, projection, num_threads);
+    }
+
+    template <typename RandomAccessIterator, typename Less, typename Projection>
+    inline std::size_t capacity_by_reordering(
+        std::size_t chunk_size,
+        RandomAccessIterator begin,
+        RandomAccessIterator end,
+        Less less,
+        Projection projection,
+        std::size_t num_threads) {
+        return detail::capacity_by_reordering(chunk_size, begin, end, less, projection, num_threads);
+    }
 } // namespace kyut
 
 #endif // INCLUDE_kyut_Ordering_inl_hpp
@@ -2,12 +2,31 @@
 #define INCLUDE_kyut_Reordering_hpp
 
 #include <cstddef>
+#include <utility>
 
 namespace kyut {
     class CircularBitStreamReader;
     class BitStreamWriter;
 
-    constexpr std::size_t max_chunk_size = 20;
+    // Chunks up to 20 elements take at most 64 bits; larger ones go through multiword arithmetic
+    constexpr std::size_t max_chunk_size = 4096;
+
+    // Less-than predicate built from a three-way comparison `(a, b) -> int`.
+    // Reordering tests equivalence with a single call to `compare3` instead of two calls to `operator()`.
+    template <typename Compare3>
+    struct ThreeWayLess {
+        Compare3 compare3;
+
+        template <typename T>
+        bool operator()(const T& a, const T& b) const {
+            return compare3(a, b) < 0;
+        }
+    };
+
+    template <typename Compare3>
+    ThreeWayLess<Compare3> three_way_less(Compare3 compare3) {
+        return ThreeWayLess<Compare3>{std::move(compare3)};
+    }
 
     template <typename RandomAccessIterator, typename Less>
     std::size_t embed_by_reordering(
@@ -25,6 +44,41 @@ namespace kyut {
         RandomAccessIterator begin,
         RandomAccessIterator end,
         Less less);
+
+    // Same as above, but elements are compared by `less(projection(a), projection(b))`.
+    // Each element is projected once, and each chunk is ranked once into integer keys;
+    // the permutation is computed on indices and applied to the range with a single gather.
+    // Chunks are processed on up to `num_threads` threads; the result does not depend on it.
+    template <typename RandomAccessIterator, typename Less, typename Projection>
+    std::size_t embed_by_reordering(
+        CircularBitStreamReader& r,
+        std::size_t limit,
+        std::size_t chunk_size,
+        RandomAccessIterator begin,
+        RandomAccessIterator end,
+        Less less,
+        Projection projection,
+        std::size_t num_threads = 1);
+
+    template <typename RandomAccessIterator, typename Less, typename Projection>
+    std::size_t extract_by_reordering(
+        BitStreamWriter& w,
+        std::size_t chunk_size,
+        RandomAccessIterator begin,
+        RandomAccessIterator end,
+        Less less,
+        Projection projection,
+        std::size_t num_threads = 1);
+
+    // Number of bits `embed_by_reordering` embeds into the range without a limit, found without reordering it
+    template <typename RandomAccessIterator, typename Less, typename Projection>
+    std::size_t capacity_by_reordering(
+        std::size_t chunk_size,
+        RandomAccessIterator begin,
+        RandomAccessIterator end,
+        Less less,
+        Projection projection,
+        std::size_t num_threads = 1);
 } // namespace kyut
 
 #include "Reordering-inl.hpp"
@@ -1,43 +1,52 @@
 #ifndef INCLUDE_kyut_SafeUnique_cpp
 #define INCLUDE_kyut_SafeUnique_cpp
 
-#include <cassert>
-#include <vector>
+#include <algorithm>
+#include <iterator>
 
 namespace kyut {
+    // Moves the first element of each group of consecutive equivalent elements to the front, and the others after them.
+    // Both parts keep their relative order. `pred(a, b)` is called with the last unique element `a`.
+    // Returns the end of the unique elements.
     template <typename Iterator, typename Pred>
     Iterator safe_unique(Iterator begin, Iterator end, Pred pred) {
         if (begin == end) {
             return begin;
         }
 
-        // This implementation is inefficient
-        std::vector<typename std::iterator_traits<Iterator>::value_type> a, b;
+        // [begin, unique_end) holds the unique elements, and [unique_end, it) the duplicates
+        auto unique_end = std::next(begin);
+        auto last = begin;
+        auto it = unique_end;
 
-        auto it = begin;
-        a.emplace_back(std::move(*it));
+        while (it != end) {
+            if (pred(*last, *it)) {
+                ++it;
+                continue;
+            }
+
+            // Find a run of unique elements and move it before the duplicates
+            auto run_end = std::next(it);
+            auto run_last = it;
 
-        while (++it != end) {
-            if (pred(a.back(), *it)) {
-                b.emplace_back(std::move(*it));
-            } else {
-                a.emplace_back(std::move(*it));
+            while (run_end != end && !pred(*run_last, *run_end)) {
+                run_last = run_end++;
             }
-        }
 
-        it = begin;
-        for (std::size_t i = 0; i < a.size(); i++) {
-            *it++ = std::move(a[i]);
-        }
+            const auto run_size = std::distance(it, run_end);
+
+            if (unique_end != it) {
+                std::rotate(unique_end, it, run_end);
+            }
 
-        const auto result = it;
+            last = unique_end;
+            std::advance(last, run_size - 1);
 
-        for (std::size_t i = 0; i < b.size(); i++) {
-            *it++ = std::move(b[i]);
+            unique_end = std::next(last);
+            it = run_end;
         }
 
-        assert(it == end);
-        return result;
+        return unique_end;
     }
 } // namespace kyut
 
@@ -0,0 +1,578 @@
+#include "Code.hpp"
+
+#include <stdexcept>
+#include "Writer.hpp"
+
+namespace kyut::binary {
+    namespace {
+        bool is_value_type(std::uint8_t byte) {
+            switch (byte) {
+                case 0x7F: // i32
+                case 0x7E: // i64
+                case 0x7D: // f32
+                case 0x7C: // f64
+                case 0x7B: // v128
+                case 0x70: // funcref
+                case 0x6F: // externref
+                case 0x68: // exnref
+                    return true;
+
+                default:
+                    return false;
+            }
+        }
+
+        // Walks a function body or a constant expression.
+        // `on_index(space, offset, index)` is called after each index of an `IndexSpace` is read from `offset`;
+        // the walk stops if it returns false.
+        template <typename OnIndex>
+        class InstructionWalker {
+        public:
+            explicit InstructionWalker(Reader& r, OnIndex& on_index)
+                : r_(r)
+                , on_index_(on_index) {
+            }
+
+            // Local declarations of a function body
+            bool locals() {
+                const auto num_groups = r_.read_u32();
+                for (std::uint32_t i = 0; i < num_groups; i++) {
+                    r_.read_u32();
+
+                    if (!is_value_type(r_.read_byte())) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            // Instructions up to the `end` of the body or the expression
+            bool instructions() {
+                for (std::size_t depth = 1; depth > 0;) {
+                    const auto opcode = r_.read_byte();
+
+                    switch (opcode) {
+                        case 0x02: // block
+                        case 0x03: // loop
+                        case 0x04: // if
+                        case 0x06: // try
+                            if (!block_type()) {
+                                return false;
+                            }
+                            depth++;
+                            break;
+
+                        case 0x0B: // end
+                            depth--;
+                            break;
+
+                        case 0x00: // unreachable
+                        case 0x01: // nop
+                        case 0x05: // else
+                        case 0x07: // catch
+                        case 0x09: // rethrow
+                        case 0x0F: // return
+                        case 0x1A: // drop
+                        case 0x1B: // select
+                        case 0xD1: // ref.is_null
+                            break;
+
+                        case 0x08: // throw event
+                        case 0x0C: // br label
+                        case 0x0D: // br_if label
+                        case 0x20: // local.get local
+                        case 0x21: // local.set local
+                        case 0x22: // local.tee local
+                        case 0x25: // table.get table
+                        case 0x26: // table.set table
+                        case 0x3F: // memory.size memory
+                        case 0x40: // memory.grow memory
+                            r_.read_u32();
+                            break;
+
+                        case 0x0A: // br_on_exn label event
+                            r_.read_u32();
+                            r_.read_u32();
+                            break;
+
+                        case 0x0E: // br_table labels label
+                        {
+                            const auto n = r_.read_u32();
+                            for (std::uint32_t i = 0; i <= n; i++) {
+                                r_.read_u32();
+                            }
+                            break;
+                        }
+
+                        case 0x10: // call function
+                        case 0x12: // return_call function
+                        case 0xD2: // ref.func function
+                            if (!index(IndexSpace::function)) {
+                                return false;
+                            }
+                            break;
+
+                        case 0x11: // call_indirect type table
+                        case 0x13: // return_call_indirect type table
+                            if (!index(IndexSpace::type)) {
+                                return false;
+                            }
+                            r_.read_u32();
+                            break;
+
+                        case 0x1C: // select types
+                        {
+                            const auto n = r_.read_u32();
+                            for (std::uint32_t i = 0; i < n; i++) {
+                                if (!is_value_type(r_.read_byte())) {
+                                    return false;
+                                }
+                            }
+                            break;
+                        }
+
+                        case 0x23: // global.get global
+                        case 0x24: // global.set global
+                            if (!index(IndexSpace::global)) {
+                                return false;
+                            }
+                            break;
+
+                        case 0x41: // i32.const
+                        case 0x42: // i64.const
+                            r_.read_s64();
+                            break;
+
+                        case 0x43: // f32.const
+                            r_.skip(4);
+                            break;
+
+                        case 0x44: // f64.const
+                            r_.skip(8);
+                            break;
+
+                        case 0xD0: // ref.null type
+                            if (!is_value_type(r_.read_byte())) {
+                                return false;
+                            }
+                            break;
+
+                        case 0xFC:
+                            if (!misc_instruction(r_.read_u32())) {
+                                return false;
+                            }
+                            break;
+
+                        case 0xFD:
+                            if (!simd_instruction(r_.read_u32())) {
+                                return false;
+                            }
+                            break;
+
+                        case 0xFE:
+                            if (!atomic_instruction(r_.read_u32())) {
+                                return false;
+                            }
+                            break;
+
+                        default:
+                            if (0x28 <= opcode && opcode <= 0x3E) {
+                                // Loads and stores
+                                if (!memarg()) {
+                                    return false;
+                                }
+                            } else if (!(0x45 <= opcode && opcode <= 0xC4)) {
+                                // Numeric instructions have no immediates
+                                return false;
+                            }
+                            break;
+                    }
+                }
+
+                return true;
+            }
+
+        private:
+            bool index(IndexSpace space) {
+                const auto offset = r_.offset();
+                const auto index = r_.read_u32();
+
+                return on_index_(space, offset, index);
+            }
+
+            bool block_type() {
+                const auto byte = r_.peek_byte();
+
+                // Single-byte negative numbers are the empty type and the value types
+                if (0x40 <= byte && byte <= 0x7F) {
+                    r_.read_byte();
+                    return byte == 0x40 || is_value_type(byte);
+                }
+
+                const auto offset = r_.offset();
+                const auto index = r_.read_s64();
+
+                if (index < 0 || index > std::int64_t{no_index}) {
+                    return false;
+                }
+
+                return on_index_(IndexSpace::block_type, offset, static_cast<std::uint32_t>(index));
+            }
+
+            bool memarg() {
+                const auto align = r_.read_u32();
+
+                // Memory indices of the multi-memory proposal
+                if ((align & 0x40) != 0) {
+                    return false;
+                }
+
+                r_.read_s64(); // Offset, 64 bits with memory64
+                return true;
+            }
+
+            bool misc_instruction(std::uint32_t opcode) {
+                switch (opcode) {
+                    case 0x00: // Saturating truncations
+                    case 0x01:
+                    case 0x02:
+                    case 0x03:
+                    case 0x04:
+                    case 0x05:
+                    case 0x06:
+                    case 0x07:
+                        return true;
+
+                    case 0x08: // memory.init segment memory
+                        if (!index(IndexSpace::data)) {
+                            return false;
+                        }
+                        r_.read_byte();
+                        return true;
+
+                    case 0x09: // data.drop segment
+                        return index(IndexSpace::data);
+
+                    case 0x0C: // table.init segment table
+                        if (!index(IndexSpace::element)) {
+                            return false;
+                        }
+                        r_.read_u32();
+                        return true;
+
+                    case 0x0D: // elem.drop segment
+                        return index(IndexSpace::element);
+
+                    case 0x0B: // memory.fill memory
+                    case 0x0F: // table.grow table
+                    case 0x10: // table.size table
+                    case 0x11: // table.fill table
+                        r_.read_u32();
+                        return true;
+
+                    case 0x0A: // memory.copy memory memory
+                    case 0x0E: // table.copy table table
+                        r_.read_u32();
+                        r_.read_u32();
+                        return true;
+
+                    default:
+                        return false;
+                }
+            }
+
+            bool simd_instruction(std::uint32_t opcode) {
+                if (opcode <= 0x0B) {
+                    // Loads and stores
+                    return memarg();
+                }
+
+                if (opcode == 0x0C || opcode == 0x0D) {
+                    // v128.const, i8x16.shuffle
+                    r_.skip(16);
+                    return true;
+                }
+
+                if (0x15 <= opcode && opcode <= 0x22) {
+                    // Lane accesses
+                    r_.read_byte();
+                    return true;
+                }
+
+                if (opcode == 0xC5 || opcode == 0xC6) {
+                    // prefetch.t, prefetch.nt
+                    return memarg();
+                }
+
+                // Splats, swizzle, comparisons, bitwise and numeric instructions have no immediates.
+                // Lane loads and stores, and zero-extending loads, were renumbered while the proposal was in progress,
+                // so 0x54 to 0x5F and 0xFC to 0xFF are not known.
+                if ((0x0E <= opcode && opcode <= 0x14) || (0x23 <= opcode && opcode <= 0x53) || (0x60 <= opcode && opcode <= 0xFB)) {
+                    return true;
+                }
+
+                return false;
+            }
+
+            bool atomic_instruction(std::uint32_t opcode) {
+                if (opcode == 0x03) {
+                    // atomic.fence
+                    r_.read_byte();
+                    return true;
+                }
+
+                if (opcode <= 0x02 || (0x10 <= opcode && opcode <= 0x4E)) {
+                    return memarg();
+                }
+
+                return false;
+            }
+
+            Reader& r_;
+            OnIndex& on_index_;
+        };
+
+        // Copies instructions, replacing the encodings of changed indices
+        class IndexRewriter {
+        public:
+            explicit IndexRewriter(const Module& module, const Reader& r, const IndexMaps& maps, std::vector<std::uint8_t>& out)
+                : bytes_(module.bytes().data())
+                , r_(r)
+                , maps_(maps)
+                , out_(out)
+                , copied_(r.offset()) {
+            }
+
+            bool operator()(IndexSpace space, std::size_t offset, std::uint32_t index) {
+                const auto& map = this->map(space);
+
+                if (index >= map.size() || map[index] == no_index) {
+                    return false;
+                }
+
+                if (map[index] != index) {
+                    write_bytes(out_, bytes_ + copied_, bytes_ + offset);
+
+                    if (space == IndexSpace::block_type) {
+                        write_s33(out_, map[index], r_.offset() - offset);
+                    } else {
+                        write_u32(out_, map[index], r_.offset() - offset);
+                    }
+
+                    copied_ = r_.offset();
+                }
+
+                return true;
+            }
+
+            // Copies the rest of the walked bytes
+            void finish() {
+                write_bytes(out_, bytes_ + copied_, bytes_ + r_.offset());
+                copied_ = r_.offset();
+            }
+
+        private:
+            const std::vector<std::uint32_t>& map(IndexSpace space) const noexcept {
+                switch (space) {
+                    case IndexSpace::function:
+                        return maps_.functions;
+
+                    case IndexSpace::global:
+                        return maps_.globals;
+
+                    case IndexSpace::element:
+                        return maps_.elements;
+
+                    case IndexSpace::data:
+                        return maps_.data;
+
+                    default:
+                        return maps_.types;
+                }
+            }
+
+            const std::uint8_t* bytes_;
+            const Reader& r_;
+            const IndexMaps& maps_;
+            std::vector<std::uint8_t>& out_;
+            std::size_t copied_; // Offset of the bytes not yet copied to `out_`
+        };
+
+        constexpr std::uint32_t bit(IndexSpace space) noexcept {
+            return std::uint32_t{1} << static_cast<int>(space);
+        }
+
+        // FNV-1a of the walked bytes, except the indices of the spaces in the bit set `excluded`
+        class BodyHasher {
+        public:
+            explicit BodyHasher(const Module& module, const Reader& r, std::uint32_t excluded, std::uint64_t hash)
+                : bytes_(module.bytes().data())
+                , r_(r)
+                , excluded_(excluded)
+                , hashed_(r.offset())
+                , hash_(hash) {
+            }
+
+            bool operator()(IndexSpace space, std::size_t offset, std::uint32_t) {
+                if ((excluded_ & bit(space)) != 0) {
+                    mix(hashed_, offset);
+                    hashed_ = r_.offset();
+                }
+
+                return true;
+            }
+
+            std::uint64_t finish() {
+                mix(hashed_, r_.offset());
+                hashed_ = r_.offset();
+
+                return hash_;
+            }
+
+        private:
+            void mix(std::size_t begin, std::size_t end) {
+                hash_ = hash_bytes(bytes_ + begin, bytes_ + end, hash_);
+
+                // Separates the ranges around an index
+                hash_ = (hash_ ^ 0x100) * 0x100000001B3;
+            }
+
+            const std::uint8_t* bytes_;
+            const Reader& r_;
+            std::uint32_t excluded_;
+            std::size_t hashed_; // Offset of the bytes not yet hashed
+            std::uint64_t hash_;
+        };
+    } // namespace
+
+    std::vector<CodeEntry> read_code(const Module& module) {
+        const auto section = module.find_section(SectionId::code);
+        if (section == nullptr) {
+            return {};
+        }
+
+        auto r = module.reader(*section);
+
+        const auto count = r.read_u32();
+
+        std::vector<CodeEntry> entries{};
+        entries.reserve((std::min)(std::size_t{count}, section->end - section->payload_offset));
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            const auto offset = r.offset();
+            const auto size = r.read_u32();
+            const auto body_offset = r.offset();
+
+            r.skip(size);
+
+            entries.emplace_back(CodeEntry{offset, body_offset, r.offset()});
+        }
+
+        if (!r.at_end()) {
+            throw std::runtime_error{"code section size mismatch"};
+        }
+
+        return entries;
+    }
+
+    std::vector<std::string_view> read_types(const Module& module) {
+        const auto section = module.find_section(SectionId::type);
+        if (section == nullptr) {
+            return {};
+        }
+
+        auto r = module.reader(*section);
+
+        const auto count = r.read_u32();
+
+        std::vector<std::string_view> types{};
+        types.reserve((std::min)(std::size_t{count}, section->end - section->payload_offset));
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            const auto offset = r.offset();
+
+            if (r.read_byte() != 0x60) {
+                throw std::runtime_error{"unknown type form"};
+            }
+
+            // Parameters and results
+            for (int k = 0; k < 2; k++) {
+                r.skip(r.read_u32());
+            }
+
+            types.emplace_back(reinterpret_cast<const char*>(module.bytes().data() + offset), r.offset() - offset);
+        }
+
+        if (!r.at_end()) {
+            throw std::runtime_error{"type section size mismatch"};
+        }
+
+        return types;
+    }
+
+    bool rewrite_body(const Module& module, const CodeEntry& entry, const IndexMaps& maps, std::vector<std::uint8_t>& out) {
+        std::vector<std::uint8_t> body{};
+
+        try {
+            Reader r{module.bytes().data(), entry.body_offset, entry.end};
+            IndexRewriter rewriter{module, r, maps, body};
+            InstructionWalker walker{r, rewriter};
+
+            if (!walker.locals() || !walker.instructions() || !r.at_end()) {
+                return false;
+            }
+
+            rewriter.finish();
+        } catch (const std::runtime_error&) {
+            // Malformed body
+            return false;
+        }
+
+        // Keep the encoding of the size as long as it fits
+        write_u32(out, static_cast<std::uint32_t>(body.size()), entry.body_offset - entry.offset);
+        write_bytes(out, body.data(), body.data() + body.size());
+
+        return true;
+    }
+
+    bool rewrite_expr(const Module& module, Reader& r, const IndexMaps& maps, std::vector<std::uint8_t>& out) {
+        IndexRewriter rewriter{module, r, maps, out};
+        InstructionWalker walker{r, rewriter};
+
+        if (!walker.instructions()) {
+            return false;
+        }
+
+        rewriter.finish();
+        return true;
+    }
+
+    std::optional<std::uint64_t> hash_body(const Module& module, const CodeEntry& entry) {
+        try {
+            Reader r{module.bytes().data(), entry.body_offset, entry.end};
+            BodyHasher hasher{module, r, ~std::uint32_t{0}, hash_seed};
+            InstructionWalker walker{r, hasher};
+
+            if (!walker.locals() || !walker.instructions() || !r.at_end()) {
+                return std::nullopt;
+            }
+
+            return hasher.finish();
+        } catch (const std::runtime_error&) {
+            // Malformed body
+            return std::nullopt;
+        }
+    }
+
+    std::optional<std::uint64_t> hash_expr(const Module& module, Reader& r, std::uint64_t hash) {
+        BodyHasher hasher{module, r, ~std::uint32_t{0}, hash};
+        InstructionWalker walker{r, hasher};
+
+        if (!walker.instructions()) {
+            return std::nullopt;
+        }
+
+        return hasher.finish();
+    }
+} // namespace kyut::binary
@@ -0,0 +1,75 @@
+#ifndef INCLUDE_kyut_binary_Code_hpp
+#define INCLUDE_kyut_binary_Code_hpp
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "Module.hpp"
+
+namespace kyut::binary {
+    // Entry of the code section
+    struct CodeEntry {
+        std::size_t offset;      // Offset of the body size
+        std::size_t body_offset; // Offset of the local declarations
+        std::size_t end;
+    };
+
+    // Entries of the code section, in order; empty if there is none
+    std::vector<CodeEntry> read_code(const Module& module);
+
+    // Encoded entries of the type section, in order; empty if there is none
+    std::vector<std::string_view> read_types(const Module& module);
+
+    constexpr std::uint32_t no_index = (std::numeric_limits<std::uint32_t>::max)();
+
+    enum class IndexSpace {
+        function,
+        type,
+        global,
+        block_type, // Type index encoded as a signed integer
+        element,    // Element segment index
+        data,       // Data segment index
+    };
+
+    // Old to new indices of the index spaces referenced from function bodies; `no_index` if an index has no new one
+    struct IndexMaps {
+        std::vector<std::uint32_t> functions;
+        std::vector<std::uint32_t> types;
+        std::vector<std::uint32_t> globals;
+        std::vector<std::uint32_t> elements;
+        std::vector<std::uint32_t> data;
+    };
+
+    // Appends the body of `entry`, with its size, to `out`, rewriting the indices in it.
+    // Indices that do not change keep their encoding, so a body without changed indices is copied as it is.
+    // Returns false, leaving `out` unchanged, if an index has no new one or the body has an instruction not known
+    // to this scanner (SIMD instructions whose immediates changed between proposals, GC instructions).
+    bool rewrite_body(const Module& module, const CodeEntry& entry, const IndexMaps& maps, std::vector<std::uint8_t>& out);
+
+    // Same as above, but for a constant expression at `r`, which is moved past its `end`.
+    // `out` may be partially written if it returns false.
+    bool rewrite_expr(const Module& module, Reader& r, const IndexMaps& maps, std::vector<std::uint8_t>& out);
+
+    constexpr std::uint64_t hash_seed = 0xCBF29CE484222325;
+
+    // FNV-1a of [begin, end), continuing from `hash`
+    inline std::uint64_t hash_bytes(const std::uint8_t* begin, const std::uint8_t* end, std::uint64_t hash = hash_seed) {
+        for (auto p = begin; p != end; ++p) {
+            hash = (hash ^ *p) * 0x100000001B3;
+        }
+
+        return hash;
+    }
+
+    // Hash of the body of `entry` without any index in it, so it does not change when functions or the entries of
+    // other sections are reordered; nullopt if the body has an instruction not known to the scanner.
+    std::optional<std::uint64_t> hash_body(const Module& module, const CodeEntry& entry);
+
+    // Hash of the constant expression at `r`, which is moved past its `end`, without any index in it, continuing
+    // from `hash`; nullopt if the expression has an instruction not known to the scanner.
+    std::optional<std::uint64_t> hash_expr(const Module& module, Reader& r, std::uint64_t hash = hash_seed);
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Code_hpp
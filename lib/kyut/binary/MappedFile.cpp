@@ -0,0 +1,96 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace kyut::binary {
+    MappedFile::MappedFile(const std::string& filename)
+        : data_(nullptr)
+        , size_(0) {
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error{"failed to open " + filename};
+        }
+
+        struct ::stat st {};
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            throw std::runtime_error{"failed to open " + filename};
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+
+        if (size_ != 0) {
+            const auto p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error{"failed to map " + filename};
+            }
+
+            data_ = static_cast<const std::uint8_t*>(p);
+        }
+
+        // The mapping stays valid without the descriptor
+        ::close(fd);
+    }
+
+    MappedFile::~MappedFile() noexcept {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<std::uint8_t*>(data_), size_);
+        }
+    }
+
+    void write_file(const std::string& filename, const std::vector<Span>& spans) {
+        std::vector<::iovec> iov{};
+        iov.reserve(spans.size());
+
+        for (const auto& s : spans) {
+            if (s.size != 0) {
+                iov.emplace_back(::iovec{const_cast<std::uint8_t*>(s.data), s.size});
+            }
+        }
+
+        const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            throw std::runtime_error{"failed to open " + filename};
+        }
+
+        std::size_t i = 0;
+        while (i < iov.size()) {
+            const auto count = (std::min)(iov.size() - i, static_cast<std::size_t>(IOV_MAX));
+
+            const auto written = ::writev(fd, &iov[i], static_cast<int>(count));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                ::close(fd);
+                throw std::runtime_error{"failed to write " + filename};
+            }
+
+            // Skip the buffers written; a partial write leaves the rest of one
+            auto rest = static_cast<std::size_t>(written);
+            while (i < iov.size() && rest >= iov[i].iov_len) {
+                rest -= iov[i].iov_len;
+                i++;
+            }
+
+            if (rest != 0) {
+                iov[i].iov_base = static_cast<std::uint8_t*>(iov[i].iov_base) + rest;
+                iov[i].iov_len -= rest;
+            }
+        }
+
+        if (::close(fd) != 0) {
+            throw std::runtime_error{"failed to write " + filename};
+        }
+    }
+} // namespace kyut::binary
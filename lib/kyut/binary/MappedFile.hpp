@@ -0,0 +1,47 @@
+#ifndef INCLUDE_kyut_binary_MappedFile_hpp
+#define INCLUDE_kyut_binary_MappedFile_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kyut::binary {
+    // Read-only view of a whole file mapped into memory
+    class MappedFile {
+    public:
+        // Throws std::runtime_error if the file cannot be mapped
+        explicit MappedFile(const std::string& filename);
+
+        // Uncopyable, unmovable
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        ~MappedFile() noexcept;
+
+        // nullptr if the file is empty
+        const std::uint8_t* data() const noexcept {
+            return data_;
+        }
+
+        std::size_t size() const noexcept {
+            return size_;
+        }
+
+    private:
+        const std::uint8_t* data_;
+        std::size_t size_;
+    };
+
+    struct Span {
+        const std::uint8_t* data;
+        std::size_t size;
+    };
+
+    // Writes `spans` one after another to `filename` with `writev`, without copying them into one buffer
+    void write_file(const std::string& filename, const std::vector<Span>& spans);
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_MappedFile_hpp
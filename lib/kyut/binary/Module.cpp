@@ -0,0 +1,92 @@
+#include "Module.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace kyut::binary {
+    namespace {
+        bool is_debug_section(const Section& section) {
+            return section.id == SectionId::custom &&
+                   (section.name == "name" || section.name == "sourceMappingURL" || section.name.compare(0, 7, ".debug_") == 0);
+        }
+    } // namespace
+
+    Module::Module(std::vector<std::uint8_t> bytes)
+        : bytes_(std::move(bytes))
+        , sections_() {
+        if (bytes_.size() < std::size(magic) || !std::equal(std::begin(magic), std::end(magic), std::begin(bytes_))) {
+            throw std::runtime_error{"not a WebAssembly version 1 binary"};
+        }
+
+        Reader r{bytes_.data(), std::size(magic), bytes_.size()};
+
+        while (!r.at_end()) {
+            const auto offset = r.offset();
+            const auto id = r.read_byte();
+            const auto size = r.read_u32();
+            const auto payload_offset = r.offset();
+
+            if (id > static_cast<std::uint8_t>(SectionId::event)) {
+                throw std::runtime_error{"unknown section id"};
+            }
+
+            r.skip(size);
+
+            auto& section = sections_.emplace_back(Section{static_cast<SectionId>(id), offset, payload_offset, r.offset(), {}});
+
+            if (section.id == SectionId::custom) {
+                auto name_reader = reader(section);
+                section.name = std::string{name_reader.read_name()};
+            }
+        }
+    }
+
+    const Section* Module::find_section(SectionId id) const noexcept {
+        if (id == SectionId::custom) {
+            return nullptr;
+        }
+
+        const auto it = std::find_if(std::begin(sections_), std::end(sections_), [&](const Section& s) {
+            return s.id == id;
+        });
+
+        return it != std::end(sections_) ? &*it : nullptr;
+    }
+
+    Module read_module(const std::string& filename) {
+        std::ifstream f{filename, std::ios::binary};
+        if (!f) {
+            throw std::runtime_error{"failed to open " + filename};
+        }
+
+        std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{}};
+
+        return Module{std::move(bytes)};
+    }
+
+    void write_module(const Module& module, const std::string& filename, bool debug_info) {
+        std::ofstream f{filename, std::ios::binary};
+        if (!f) {
+            throw std::runtime_error{"failed to open " + filename};
+        }
+
+        const auto write = [&](std::size_t begin, std::size_t end) {
+            f.write(reinterpret_cast<const char*>(module.bytes().data() + begin), end - begin);
+        };
+
+        write(0, std::size(magic));
+
+        for (const auto& section : module.sections()) {
+            if (!debug_info && is_debug_section(section)) {
+                continue;
+            }
+
+            write(section.offset, section.end);
+        }
+
+        if (!f) {
+            throw std::runtime_error{"failed to write " + filename};
+        }
+    }
+} // namespace kyut::binary
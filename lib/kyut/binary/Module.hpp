@@ -0,0 +1,84 @@
+#ifndef INCLUDE_kyut_binary_Module_hpp
+#define INCLUDE_kyut_binary_Module_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Reader.hpp"
+
+namespace kyut::binary {
+    // Magic number and version
+    inline constexpr std::uint8_t magic[] = {0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+    enum class SectionId : std::uint8_t {
+        custom = 0,
+        type = 1,
+        import = 2,
+        function = 3,
+        table = 4,
+        memory = 5,
+        global = 6,
+        export_ = 7,
+        start = 8,
+        element = 9,
+        code = 10,
+        data = 11,
+        data_count = 12,
+        event = 13, // Exception handling proposal, placed after the memory section
+    };
+
+    struct Section {
+        SectionId id;
+        std::size_t offset;         // Offset of the section header
+        std::size_t payload_offset; // Offset of the contents
+        std::size_t end;            // Offset past the contents
+        std::string name;           // Name of a custom section
+    };
+
+    // WebAssembly binary split into its sections, without decoding their contents
+    class Module {
+    public:
+        explicit Module(std::vector<std::uint8_t> bytes);
+
+        // Uncopyable, movable
+        Module(const Module&) = delete;
+        Module(Module&&) = default;
+
+        Module& operator=(const Module&) = delete;
+        Module& operator=(Module&&) = default;
+
+        ~Module() noexcept = default;
+
+        // Returns the first non-custom section of `id`, or nullptr
+        const Section* find_section(SectionId id) const noexcept;
+
+        // Reader over the contents of `section`
+        Reader reader(const Section& section) const noexcept {
+            return Reader{bytes_.data(), section.payload_offset, section.end};
+        }
+
+        const std::vector<Section>& sections() const noexcept {
+            return sections_;
+        }
+
+        // Sections keep their offsets, so contents may be rewritten in place but not resized
+        std::vector<std::uint8_t>& bytes() noexcept {
+            return bytes_;
+        }
+
+        const std::vector<std::uint8_t>& bytes() const noexcept {
+            return bytes_;
+        }
+
+    private:
+        std::vector<std::uint8_t> bytes_;
+        std::vector<Section> sections_;
+    };
+
+    Module read_module(const std::string& filename);
+
+    // Copies every section byte for byte; debug info is the name section, DWARF sections and the source map URL.
+    void write_module(const Module& module, const std::string& filename, bool debug_info);
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Module_hpp
@@ -0,0 +1,154 @@
+#ifndef INCLUDE_kyut_binary_Reader_hpp
+#define INCLUDE_kyut_binary_Reader_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace kyut::binary {
+    // Cursor over a range of a WebAssembly binary.
+    // Offsets are relative to the start of the binary, not to the range.
+    class Reader {
+    public:
+        explicit Reader(const std::uint8_t* base, std::size_t begin, std::size_t end)
+            : base_(base)
+            , pos_(begin)
+            , end_(end) {
+        }
+
+        std::uint8_t read_byte() {
+            require(1);
+
+            return base_[pos_++];
+        }
+
+        // Unsigned LEB128 of at most 32 bits
+        std::uint32_t read_u32() {
+            // Most indices, counts and sizes fit in a byte
+            if (pos_ < end_ && base_[pos_] < 0x80) {
+                return base_[pos_++];
+            }
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            // Decodes a whole integer from a word, leaving errors to the loop below
+            if (end_ - pos_ >= 8) {
+                std::uint64_t word;
+                std::memcpy(&word, base_ + pos_, sizeof(word));
+
+                const auto last_bytes = ~word & 0x8080808080808080;
+
+                if (last_bytes != 0) {
+                    const std::size_t size = (__builtin_ctzll(last_bytes) >> 3) + 1;
+
+                    // The 5th byte holds the 4 most significant bits only
+                    if (size < 5 || (size == 5 && (word & 0x7000000000) == 0)) {
+                        word &= (std::uint64_t{1} << (8 * size)) - 1;
+                        pos_ += size;
+
+                        return static_cast<std::uint32_t>(
+                            (word & 0x7F) | ((word >> 1) & 0x3F80) | ((word >> 2) & 0x1FC000) | ((word >> 3) & 0xFE00000) |
+                            ((word >> 4) & 0xF0000000));
+                    }
+                }
+            }
+#endif
+
+            std::uint32_t x = 0;
+
+            for (std::size_t shift = 0;; shift += 7) {
+                const auto byte = read_byte();
+
+                // The 5th byte holds the 4 most significant bits only
+                if (shift == 28 && (byte & 0xF0) != 0) {
+                    throw std::runtime_error{"integer representation too long"};
+                }
+
+                x |= std::uint32_t{byte & 0x7Fu} << shift;
+
+                if ((byte & 0x80) == 0) {
+                    return x;
+                }
+            }
+        }
+
+        // Signed LEB128 of at most 64 bits
+        std::int64_t read_s64() {
+            std::uint64_t x = 0;
+
+            for (std::size_t shift = 0;; shift += 7) {
+                const auto byte = read_byte();
+
+                // The 10th byte holds the sign bit only
+                if (shift == 63 && byte != 0x00 && byte != 0x7F) {
+                    throw std::runtime_error{"integer representation too long"};
+                }
+
+                x |= std::uint64_t{byte & 0x7Fu} << shift;
+
+                if ((byte & 0x80) == 0) {
+                    // Sign-extend
+                    if (shift < 57 && (byte & 0x40) != 0) {
+                        x |= ~std::uint64_t{0} << (shift + 7);
+                    }
+
+                    return static_cast<std::int64_t>(x);
+                }
+            }
+        }
+
+        std::uint8_t peek_byte() const {
+            require(1);
+
+            return base_[pos_];
+        }
+
+        // Name of `read_u32()` bytes, not validated as UTF-8
+        std::string_view read_name() {
+            const auto size = read_u32();
+            const auto p = read_bytes(size);
+
+            return std::string_view{reinterpret_cast<const char*>(p), size};
+        }
+
+        const std::uint8_t* read_bytes(std::size_t size) {
+            require(size);
+
+            const auto p = base_ + pos_;
+            pos_ += size;
+
+            return p;
+        }
+
+        void skip(std::size_t size) {
+            require(size);
+
+            pos_ += size;
+        }
+
+        std::size_t offset() const noexcept {
+            return pos_;
+        }
+
+        std::size_t end_offset() const noexcept {
+            return end_;
+        }
+
+        bool at_end() const noexcept {
+            return pos_ == end_;
+        }
+
+    private:
+        void require(std::size_t size) const {
+            if (size > end_ - pos_) {
+                throw std::runtime_error{"unexpected end of binary"};
+            }
+        }
+
+        const std::uint8_t* base_;
+        std::size_t pos_;
+        std::size_t end_;
+    };
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Reader_hpp
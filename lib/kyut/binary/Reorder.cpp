@@ -0,0 +1,526 @@
+#include "Reorder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include "../Parallel.hpp"
+#include "Code.hpp"
+#include "Sections.hpp"
+#include "Writer.hpp"
+
+namespace kyut::binary {
+    namespace {
+        constexpr std::uint8_t magic_size = 8;
+
+        // `order` as old to new positions, shifted by `base` in both
+        void invert(const std::vector<std::uint32_t>& order, std::size_t size, std::uint32_t base, std::vector<std::uint32_t>& map) {
+            const auto offset = map.size();
+            map.resize(offset + size);
+
+            if (order.empty()) {
+                std::iota(std::begin(map) + offset, std::end(map), static_cast<std::uint32_t>(base));
+                return;
+            }
+
+            if (order.size() != size) {
+                throw std::runtime_error{"order size mismatch"};
+            }
+
+            std::vector<bool> seen(size);
+            for (std::size_t i = 0; i < size; i++) {
+                if (order[i] >= size || seen[order[i]]) {
+                    throw std::runtime_error{"order is not a permutation"};
+                }
+
+                seen[order[i]] = true;
+                map[offset + order[i]] = base + static_cast<std::uint32_t>(i);
+            }
+        }
+
+        // Old to new indices of imported functions and globals, in the new order of `imports`
+        void invert_imports(const std::vector<ImportEntry>& imports, const std::vector<std::uint32_t>& order, IndexMaps& maps) {
+            // Validates `order`
+            std::vector<std::uint32_t> positions{};
+            invert(order, imports.size(), 0, positions);
+
+            // Index of each import in the index space of its kind
+            std::array<std::uint32_t, 5> counts{};
+            std::vector<std::uint32_t> indices{};
+            indices.reserve(imports.size());
+
+            for (const auto& e : imports) {
+                indices.emplace_back(counts[static_cast<std::size_t>(e.kind)]++);
+            }
+
+            maps.functions.resize(counts[static_cast<std::size_t>(ExternalKind::function)]);
+            maps.globals.resize(counts[static_cast<std::size_t>(ExternalKind::global)]);
+
+            std::array<std::uint32_t, 5> new_counts{};
+            for (std::size_t k = 0; k < imports.size(); k++) {
+                const auto i = order.empty() ? k : order[k];
+                const auto kind = imports[i].kind;
+                const auto new_index = new_counts[static_cast<std::size_t>(kind)]++;
+
+                if (kind == ExternalKind::function) {
+                    maps.functions[indices[i]] = new_index;
+                } else if (kind == ExternalKind::global) {
+                    maps.globals[indices[i]] = new_index;
+                } else if (new_index != indices[i]) {
+                    throw std::runtime_error{"table, memory and event imports cannot be reordered"};
+                }
+            }
+        }
+
+        template <typename Entry>
+        std::vector<Entry> permute(const std::vector<Entry>& entries, const std::vector<std::uint32_t>& order) {
+            if (order.empty()) {
+                return entries;
+            }
+
+            std::vector<Entry> result{};
+            result.reserve(order.size());
+
+            for (const auto i : order) {
+                result.emplace_back(entries[i]);
+            }
+
+            return result;
+        }
+
+        bool is_identity(const std::vector<std::uint32_t>& map) {
+            for (std::size_t i = 0; i < map.size(); i++) {
+                if (map[i] != i) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool is_debug_section(const Section& section) {
+            return section.id == SectionId::custom && (section.name == "sourceMappingURL" || section.name.compare(0, 7, ".debug_") == 0);
+        }
+
+        class Rebuilder {
+        public:
+            explicit Rebuilder(const Module& module, const IndexMaps& maps)
+                : module_(module)
+                , maps_(maps) {
+            }
+
+            void copy(std::vector<std::uint8_t>& out, std::size_t begin, std::size_t end) const {
+                write_bytes(out, module_.bytes().data() + begin, module_.bytes().data() + end);
+            }
+
+            // Reads an index and writes its new one, in the same width if possible
+            void index(Reader& r, const std::vector<std::uint32_t>& map, std::vector<std::uint8_t>& out) const {
+                const auto offset = r.offset();
+                const auto old_index = r.read_u32();
+
+                if (old_index >= map.size() || map[old_index] == no_index) {
+                    throw std::runtime_error{"index out of range"};
+                }
+
+                write_u32(out, map[old_index], r.offset() - offset);
+            }
+
+            void expr(Reader& r, std::vector<std::uint8_t>& out) const {
+                if (!rewrite_expr(module_, r, maps_, out)) {
+                    throw std::runtime_error{"unknown constant expression"};
+                }
+            }
+
+            // Vector section of `entries`, each written by `write_entry(r, out)` with `r` over the entry
+            template <typename Entry, typename WriteEntry>
+            std::vector<std::uint8_t> entries(const std::vector<Entry>& entries, WriteEntry write_entry) const {
+                std::vector<std::uint8_t> out{};
+                write_u32(out, static_cast<std::uint32_t>(entries.size()));
+
+                for (const auto& e : entries) {
+                    Reader r{module_.bytes().data(), e.offset, e.end};
+                    write_entry(r, out);
+
+                    if (!r.at_end()) {
+                        throw std::runtime_error{"entry size mismatch"};
+                    }
+                }
+
+                return out;
+            }
+
+            std::vector<std::uint8_t> types(const std::vector<Entry>& types) const {
+                return entries(types, [&](Reader& r, std::vector<std::uint8_t>& out) {
+                    copy(out, r.offset(), r.end_offset());
+                    r.skip(r.end_offset() - r.offset());
+                });
+            }
+
+            std::vector<std::uint8_t> imports(const std::vector<ImportEntry>& imports) const {
+                return entries(imports, [&](Reader& r, std::vector<std::uint8_t>& out) {
+                    const auto offset = r.offset();
+                    r.read_name(); // Module
+                    r.read_name(); // Field
+                    const auto kind = static_cast<ExternalKind>(r.read_byte());
+
+                    if (kind == ExternalKind::event) {
+                        r.read_u32(); // Attribute
+                    }
+
+                    copy(out, offset, r.offset());
+
+                    if (kind == ExternalKind::function || kind == ExternalKind::event) {
+                        index(r, maps_.types, out);
+                    }
+
+                    copy(out, r.offset(), r.end_offset());
+                    r.skip(r.end_offset() - r.offset());
+                });
+            }
+
+            std::vector<std::uint8_t> functions(const std::vector<FunctionEntry>& functions) const {
+                return entries(functions, [&](Reader& r, std::vector<std::uint8_t>& out) {
+                    index(r, maps_.types, out);
+                });
+            }
+
+            std::vector<std::uint8_t> globals(const std::vector<Entry>& globals) const {
+                return entries(globals, [&](Reader& r, std::vector<std::uint8_t>& out) {
+                    const auto offset = r.offset();
+                    r.skip(2); // Value type and mutability
+                    copy(out, offset, r.offset());
+
+                    expr(r, out);
+                });
+            }
+
+            std::vector<std::uint8_t> elements(const std::vector<SegmentEntry>& elements) const {
+                return entries(elements, [&](Reader& r, std::vector<std::uint8_t>& out) {
+                    const auto flags = r.read_u32();
+                    write_u32(out, flags);
+
+                    const bool passive_or_declarative = (flags & 0x01) != 0;
+                    const bool explicit_table = (flags & 0x02) != 0;
+                    const bool expressions = (flags & 0x04) != 0;
+
+                    if (explicit_table && !passive_or_declarative) {
+                        // Table index
+                        const auto offset = r.offset();
+                        r.read_u32();
+                        copy(out, offset, r.offset());
+                    }
+
+                    if (!passive_or_declarative) {
+                        expr(r, out);
+                    }
+
+                    if (passive_or_declarative || explicit_table) {
+                        // Element kind or reference type
+                        out.push_back(r.read_byte());
+                    }
+
+                    const auto num_elements = r.read_u32();
+                    write_u32(out, num_elements);
+
+                    for (std::uint32_t k = 0; k < num_elements; k++) {
+                        if (expressions) {
+                            expr(r, out);
+                        } else {
+                            index(r, maps_.functions, out);
+                        }
+                    }
+                });
+            }
+
+            std::vector<std::uint8_t> data(const std::vector<SegmentEntry>& data) const {
+                return entries(data, [&](Reader& r, std::vector<std::uint8_t>& out) {
+                    const auto offset = r.offset();
+                    const auto flags = r.read_u32();
+
+                    if (flags == 2) {
+                        r.read_u32(); // Memory index
+                    }
+
+                    copy(out, offset, r.offset());
+
+                    if ((flags & 0x01) == 0) {
+                        expr(r, out);
+                    }
+
+                    copy(out, r.offset(), r.end_offset());
+                    r.skip(r.end_offset() - r.offset());
+                });
+            }
+
+            std::vector<std::uint8_t> exports(const Section& section) const {
+                auto r = module_.reader(section);
+                std::vector<std::uint8_t> out{};
+
+                const auto count = r.read_u32();
+                write_u32(out, count);
+
+                for (std::uint32_t i = 0; i < count; i++) {
+                    const auto offset = r.offset();
+                    r.read_name();
+                    const auto kind = static_cast<ExternalKind>(r.read_byte());
+                    copy(out, offset, r.offset());
+
+                    if (kind == ExternalKind::function) {
+                        index(r, maps_.functions, out);
+                    } else if (kind == ExternalKind::global) {
+                        index(r, maps_.globals, out);
+                    } else {
+                        const auto index_offset = r.offset();
+                        r.read_u32();
+                        copy(out, index_offset, r.offset());
+                    }
+                }
+
+                return out;
+            }
+
+            std::vector<std::uint8_t> events(const Section& section) const {
+                auto r = module_.reader(section);
+                std::vector<std::uint8_t> out{};
+
+                const auto count = r.read_u32();
+                write_u32(out, count);
+
+                for (std::uint32_t i = 0; i < count; i++) {
+                    const auto offset = r.offset();
+                    r.read_u32(); // Attribute
+                    copy(out, offset, r.offset());
+
+                    index(r, maps_.types, out);
+                }
+
+                return out;
+            }
+
+            std::vector<std::uint8_t> start(const Section& section) const {
+                auto r = module_.reader(section);
+                std::vector<std::uint8_t> out{};
+
+                index(r, maps_.functions, out);
+
+                return out;
+            }
+
+            // Name section with indices updated, and the entries of each name map sorted again
+            std::vector<std::uint8_t> names(const Section& section) const {
+                auto r = module_.reader(section);
+                std::vector<std::uint8_t> out{};
+
+                write_name(out, r.read_name());
+
+                while (!r.at_end()) {
+                    const auto id = r.read_byte();
+                    const auto size = r.read_u32();
+                    const auto end = r.offset() + size;
+
+                    const auto map = name_map(id);
+                    if (map == nullptr) {
+                        out.push_back(id);
+                        write_u32(out, size);
+                        copy(out, r.offset(), end);
+                        r.skip(size);
+                        continue;
+                    }
+
+                    Reader sub{module_.bytes().data(), r.offset(), end};
+                    r.skip(size);
+
+                    // New index and the rest of each entry
+                    std::vector<std::pair<std::uint32_t, Entry>> entries{};
+
+                    const auto count = sub.read_u32();
+                    for (std::uint32_t i = 0; i < count; i++) {
+                        const auto old_index = sub.read_u32();
+                        if (old_index >= map->size() || (*map)[old_index] == no_index) {
+                            throw std::runtime_error{"index out of range"};
+                        }
+
+                        const auto offset = sub.offset();
+                        if (id == 2 || id == 3 || id == 10) {
+                            // Indirect name map
+                            const auto n = sub.read_u32();
+                            for (std::uint32_t k = 0; k < n; k++) {
+                                sub.read_u32();
+                                sub.read_name();
+                            }
+                        } else {
+                            sub.read_name();
+                        }
+
+                        entries.emplace_back((*map)[old_index], Entry{offset, sub.offset()});
+                    }
+
+                    std::sort(std::begin(entries), std::end(entries), [](const auto& a, const auto& b) {
+                        return a.first < b.first;
+                    });
+
+                    std::vector<std::uint8_t> payload{};
+                    write_u32(payload, count);
+
+                    for (const auto& [new_index, entry] : entries) {
+                        write_u32(payload, new_index);
+                        copy(payload, entry.offset, entry.end);
+                    }
+
+                    out.push_back(id);
+                    write_u32(out, static_cast<std::uint32_t>(payload.size()));
+                    write_bytes(out, payload.data(), payload.data() + payload.size());
+                }
+
+                return out;
+            }
+
+        private:
+            // Index space of the name subsection `id`, or nullptr if its entries are not reordered
+            const std::vector<std::uint32_t>* name_map(std::uint8_t id) const noexcept {
+                switch (id) {
+                    case 1: // Function names
+                    case 2: // Local names
+                    case 3: // Label names
+                        return &maps_.functions;
+
+                    case 4:  // Type names
+                    case 10: // Field names
+                        return &maps_.types;
+
+                    case 7: // Global names
+                        return &maps_.globals;
+
+                    case 8: // Element segment names
+                        return &maps_.elements;
+
+                    case 9: // Data segment names
+                        return &maps_.data;
+
+                    default:
+                        return nullptr;
+                }
+            }
+
+            const Module& module_;
+            const IndexMaps& maps_;
+        };
+    } // namespace
+
+    Module reorder(const Module& module, const ModuleOrder& order, std::size_t num_threads) {
+        std::vector<Entry> types{};
+        for (const auto& t : read_types(module)) {
+            const auto offset = static_cast<std::size_t>(reinterpret_cast<const std::uint8_t*>(t.data()) - module.bytes().data());
+            types.emplace_back(Entry{offset, offset + t.size()});
+        }
+
+        const auto imports = read_imports(module);
+        const auto functions = read_functions(module);
+        const auto globals = read_globals(module);
+        const auto elements = read_elements(module);
+        const auto data = read_data(module);
+        const auto code = read_code(module);
+
+        if (functions.size() != code.size()) {
+            throw std::runtime_error{"function and code section size mismatch"};
+        }
+
+        IndexMaps maps{};
+        invert(order.types, types.size(), 0, maps.types);
+        invert_imports(imports, order.imports, maps);
+        invert(order.functions, functions.size(), static_cast<std::uint32_t>(maps.functions.size()), maps.functions);
+        invert(order.globals, globals.size(), static_cast<std::uint32_t>(maps.globals.size()), maps.globals);
+        invert(order.elements, elements.size(), 0, maps.elements);
+        invert(order.data, data.size(), 0, maps.data);
+
+        const auto new_code = permute(code, order.functions);
+        const bool code_unchanged =
+            is_identity(maps.functions) && is_identity(maps.types) && is_identity(maps.globals) && is_identity(maps.elements) && is_identity(maps.data);
+
+        std::vector<std::vector<std::uint8_t>> bodies(new_code.size());
+        std::vector<char> failed(new_code.size());
+
+        if (!code_unchanged) {
+            parallel_for(new_code.size(), num_threads, [&](std::size_t i) {
+                failed[i] = !rewrite_body(module, new_code[i], maps, bodies[i]);
+            });
+
+            if (std::find(std::begin(failed), std::end(failed), true) != std::end(failed)) {
+                throw std::runtime_error{"unknown instruction in function body"};
+            }
+        }
+
+        const Rebuilder rebuilder{module, maps};
+
+        std::vector<std::uint8_t> out(std::begin(module.bytes()), std::begin(module.bytes()) + magic_size);
+        for (const auto& section : module.sections()) {
+            const auto id = static_cast<std::uint8_t>(section.id);
+
+            switch (section.id) {
+                case SectionId::type:
+                    write_section(out, id, rebuilder.types(permute(types, order.types)));
+                    break;
+
+                case SectionId::import:
+                    write_section(out, id, rebuilder.imports(permute(imports, order.imports)));
+                    break;
+
+                case SectionId::function:
+                    write_section(out, id, rebuilder.functions(permute(functions, order.functions)));
+                    break;
+
+                case SectionId::global:
+                    write_section(out, id, rebuilder.globals(permute(globals, order.globals)));
+                    break;
+
+                case SectionId::element:
+                    write_section(out, id, rebuilder.elements(permute(elements, order.elements)));
+                    break;
+
+                case SectionId::data:
+                    write_section(out, id, rebuilder.data(permute(data, order.data)));
+                    break;
+
+                case SectionId::code:
+                    if (code_unchanged) {
+                        rebuilder.copy(out, section.offset, section.end);
+                    } else {
+                        std::vector<std::uint8_t> payload{};
+                        write_u32(payload, static_cast<std::uint32_t>(bodies.size()));
+
+                        for (const auto& body : bodies) {
+                            write_bytes(payload, body.data(), body.data() + body.size());
+                        }
+
+                        write_section(out, id, payload);
+                    }
+                    break;
+
+                case SectionId::export_:
+                    write_section(out, id, rebuilder.exports(section));
+                    break;
+
+                case SectionId::start:
+                    write_section(out, id, rebuilder.start(section));
+                    break;
+
+                case SectionId::event:
+                    write_section(out, id, rebuilder.events(section));
+                    break;
+
+                case SectionId::custom:
+                    if (section.name == "name") {
+                        write_section(out, id, rebuilder.names(section));
+                    } else if (code_unchanged || !is_debug_section(section)) {
+                        rebuilder.copy(out, section.offset, section.end);
+                    }
+                    break;
+
+                default:
+                    rebuilder.copy(out, section.offset, section.end);
+                    break;
+            }
+        }
+
+        return Module{std::move(out)};
+    }
+} // namespace kyut::binary
@@ -0,0 +1,27 @@
+#ifndef INCLUDE_kyut_binary_Reorder_hpp
+#define INCLUDE_kyut_binary_Reorder_hpp
+
+#include <cstdint>
+#include <vector>
+#include "Module.hpp"
+
+namespace kyut::binary {
+    // New order of the entries of sections, as `order[new_position] = old_position`; empty keeps the order
+    struct ModuleOrder {
+        std::vector<std::uint32_t> types;
+        std::vector<std::uint32_t> imports;   // Table, memory and event imports must keep their relative order
+        std::vector<std::uint32_t> functions; // Entries of both the function and the code sections
+        std::vector<std::uint32_t> globals;   // Entries of the global section, without imported globals
+        std::vector<std::uint32_t> elements;
+        std::vector<std::uint32_t> data;
+    };
+
+    // Rebuilds `module` with its entries reordered, updating every index that refers to them.
+    // Function bodies are rewritten on up to `num_threads` threads, and copied if no index in them can change.
+    // DWARF sections and the source map URL are dropped if function bodies change, as code offsets do.
+    // Active segments are initialized in order, so reordering overlapping ones changes the module; it is not checked.
+    // Throws std::runtime_error if an index cannot be updated.
+    Module reorder(const Module& module, const ModuleOrder& order, std::size_t num_threads = 1);
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Reorder_hpp
@@ -0,0 +1,251 @@
+#include "Sections.hpp"
+
+#include <stdexcept>
+
+namespace kyut::binary {
+    namespace {
+        // Calls `read_entry(r)` for each entry of the section `id`, which reads the entry and returns it
+        template <typename T, typename ReadEntry>
+        std::vector<T> read_entries(const Module& module, SectionId id, const char* name, ReadEntry read_entry) {
+            const auto section = module.find_section(id);
+            if (section == nullptr) {
+                return {};
+            }
+
+            auto r = module.reader(*section);
+
+            const auto count = r.read_u32();
+
+            std::vector<T> entries{};
+            entries.reserve((std::min)(std::size_t{count}, section->end - section->payload_offset));
+
+            for (std::uint32_t i = 0; i < count; i++) {
+                entries.emplace_back(read_entry(r));
+            }
+
+            if (!r.at_end()) {
+                throw std::runtime_error{std::string{name} + " section size mismatch"};
+            }
+
+            return entries;
+        }
+
+        void skip_limits(Reader& r) {
+            const auto flags = r.read_byte();
+
+            r.read_s64(); // Minimum, 64 bits with memory64
+            if ((flags & 0x01) != 0) {
+                r.read_s64(); // Maximum
+            }
+        }
+
+        // Skips a constant expression
+        void skip_expr(Reader& r) {
+            for (;;) {
+                switch (r.read_byte()) {
+                    case 0x0B: // end
+                        return;
+
+                    case 0x41: // i32.const
+                    case 0x42: // i64.const
+                        r.read_s64();
+                        break;
+
+                    case 0x43: // f32.const
+                        r.skip(4);
+                        break;
+
+                    case 0x44: // f64.const
+                        r.skip(8);
+                        break;
+
+                    case 0x23: // global.get
+                    case 0xD2: // ref.func
+                        r.read_u32();
+                        break;
+
+                    case 0xD0: // ref.null
+                        r.read_byte();
+                        break;
+
+                    case 0xFD: // v128.const
+                        if (r.read_u32() != 0x0C) {
+                            throw std::runtime_error{"unknown constant expression"};
+                        }
+                        r.skip(16);
+                        break;
+
+                    default:
+                        throw std::runtime_error{"unknown constant expression"};
+                }
+            }
+        }
+
+        // Skips the offset of an active segment, returning it if it is a constant
+        std::optional<std::uint64_t> read_offset(Reader& r) {
+            auto constant = r;
+            skip_expr(r);
+
+            const auto opcode = constant.read_byte();
+            if (opcode != 0x41 && opcode != 0x42) {
+                return std::nullopt;
+            }
+
+            const auto value = constant.read_s64();
+            if (constant.read_byte() != 0x0B) {
+                return std::nullopt;
+            }
+
+            // i32 offsets are unsigned
+            return opcode == 0x41 ? std::uint64_t{static_cast<std::uint32_t>(value)} : static_cast<std::uint64_t>(value);
+        }
+    } // namespace
+
+    std::vector<ExportEntry> read_exports(const Module& module) {
+        return read_entries<ExportEntry>(module, SectionId::export_, "export", [](Reader& r) {
+            const auto offset = r.offset();
+            const auto name = r.read_name();
+            r.read_byte(); // Kind
+            r.read_u32();  // Index
+
+            return ExportEntry{name, offset, r.offset()};
+        });
+    }
+
+    std::vector<ImportEntry> read_imports(const Module& module) {
+        return read_entries<ImportEntry>(module, SectionId::import, "import", [](Reader& r) {
+            const auto offset = r.offset();
+            const auto kind = read_import(r);
+
+            return ImportEntry{kind, offset, r.offset()};
+        });
+    }
+
+    std::vector<FunctionEntry> read_functions(const Module& module) {
+        return read_entries<FunctionEntry>(module, SectionId::function, "function", [](Reader& r) {
+            const auto offset = r.offset();
+            const auto type_index = r.read_u32();
+
+            return FunctionEntry{type_index, offset, r.offset()};
+        });
+    }
+
+    std::vector<Entry> read_globals(const Module& module) {
+        return read_entries<Entry>(module, SectionId::global, "global", [](Reader& r) {
+            const auto offset = r.offset();
+            r.read_byte(); // Value type
+            r.read_byte(); // Mutability
+            skip_expr(r);
+
+            return Entry{offset, r.offset()};
+        });
+    }
+
+    std::vector<SegmentEntry> read_elements(const Module& module) {
+        return read_entries<SegmentEntry>(module, SectionId::element, "element", [](Reader& r) {
+            SegmentEntry e{};
+            e.offset = r.offset();
+            e.flags = r.read_u32();
+
+            if (e.flags > 7) {
+                throw std::runtime_error{"unknown element segment"};
+            }
+
+            const bool explicit_table = (e.flags & 0x02) != 0;
+            const bool expressions = (e.flags & 0x04) != 0;
+
+            if (e.active()) {
+                if (explicit_table) {
+                    e.target = r.read_u32();
+                }
+
+                e.base = read_offset(r);
+            }
+
+            if (!e.active() || explicit_table) {
+                r.read_byte(); // Element kind or reference type
+            }
+
+            e.size = r.read_u32();
+            for (std::uint64_t i = 0; i < e.size; i++) {
+                if (expressions) {
+                    skip_expr(r);
+                } else {
+                    r.read_u32();
+                }
+            }
+
+            e.init_offset = e.end = r.offset();
+            return e;
+        });
+    }
+
+    std::vector<SegmentEntry> read_data(const Module& module) {
+        return read_entries<SegmentEntry>(module, SectionId::data, "data", [](Reader& r) {
+            SegmentEntry e{};
+            e.offset = r.offset();
+            e.flags = r.read_u32();
+
+            if (e.flags > 2) {
+                throw std::runtime_error{"unknown data segment"};
+            }
+
+            if (e.active()) {
+                if (e.flags == 2) {
+                    e.target = r.read_u32();
+                }
+
+                e.base = read_offset(r);
+            }
+
+            e.init_offset = r.offset();
+            e.size = r.read_u32();
+            r.skip(e.size);
+
+            e.end = r.offset();
+            return e;
+        });
+    }
+
+    ExternalKind read_import(Reader& r) {
+        r.read_name(); // Module
+        r.read_name(); // Field
+
+        const auto kind = static_cast<ExternalKind>(r.read_byte());
+        switch (kind) {
+            case ExternalKind::function:
+                r.read_u32(); // Type
+                break;
+
+            case ExternalKind::table:
+                r.read_byte(); // Element type
+                skip_limits(r);
+                break;
+
+            case ExternalKind::memory:
+                skip_limits(r);
+                break;
+
+            case ExternalKind::global:
+                r.read_byte(); // Value type
+                r.read_byte(); // Mutability
+                break;
+
+            case ExternalKind::event:
+                r.read_u32(); // Attribute
+                r.read_u32(); // Type
+                break;
+
+            default:
+                throw std::runtime_error{"unknown import kind"};
+        }
+
+        return kind;
+    }
+
+    std::size_t count_imports(const std::vector<ImportEntry>& imports, ExternalKind kind) {
+        return std::count_if(std::begin(imports), std::end(imports), [&](const ImportEntry& e) {
+            return e.kind == kind;
+        });
+    }
+} // namespace kyut::binary
@@ -0,0 +1,88 @@
+#ifndef INCLUDE_kyut_binary_Sections_hpp
+#define INCLUDE_kyut_binary_Sections_hpp
+
+#include <cassert>
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "Module.hpp"
+
+namespace kyut::binary {
+    enum class ExternalKind : std::uint8_t {
+        function = 0,
+        table = 1,
+        memory = 2,
+        global = 3,
+        event = 4,
+    };
+
+    // Byte range of an entry in a vector section
+    struct Entry {
+        std::size_t offset;
+        std::size_t end;
+    };
+
+    struct ExportEntry {
+        std::string_view name; // Points into the module
+        std::size_t offset;    // Byte range of the whole entry
+        std::size_t end;
+    };
+
+    struct ImportEntry {
+        ExternalKind kind;
+        std::size_t offset; // Byte range of the whole entry
+        std::size_t end;
+    };
+
+    struct FunctionEntry {
+        std::uint32_t type_index;
+        std::size_t offset;
+        std::size_t end;
+    };
+
+    // Entry of the element or the data section
+    struct SegmentEntry {
+        std::uint32_t flags;
+        std::uint32_t target;              // Table or memory index of an active segment
+        std::optional<std::uint64_t> base; // Offset of an active segment if it is a constant
+        std::uint64_t size;                // Number of elements or bytes
+        std::size_t init_offset;           // Byte range of the contents of a data segment, with its size
+        std::size_t offset;                // Byte range of the whole entry
+        std::size_t end;
+
+        bool active() const noexcept {
+            return (flags & 0x01) == 0;
+        }
+    };
+
+    // Entries of each section, in order; empty if there is none
+    std::vector<ExportEntry> read_exports(const Module& module);
+    std::vector<ImportEntry> read_imports(const Module& module);
+    std::vector<FunctionEntry> read_functions(const Module& module);
+    std::vector<Entry> read_globals(const Module& module);
+    std::vector<SegmentEntry> read_elements(const Module& module);
+    std::vector<SegmentEntry> read_data(const Module& module);
+
+    // Reads an entry of the import section, returning its kind
+    ExternalKind read_import(Reader& r);
+
+    // Number of imports of `kind`
+    std::size_t count_imports(const std::vector<ImportEntry>& imports, ExternalKind kind);
+
+    // Rewrites the contiguous entries starting at `offset` in the order of `entries`, which covers the same bytes.
+    template <typename Entry>
+    void write_entries(Module& module, std::size_t offset, const std::vector<Entry>& entries) {
+        std::vector<std::uint8_t> buffer{};
+
+        for (const auto& e : entries) {
+            buffer.insert(std::end(buffer), std::begin(module.bytes()) + e.offset, std::begin(module.bytes()) + e.end);
+        }
+
+        assert(offset + buffer.size() <= module.bytes().size());
+
+        std::copy(std::begin(buffer), std::end(buffer), std::begin(module.bytes()) + offset);
+    }
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Sections_hpp
@@ -0,0 +1,70 @@
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include "MappedFile.hpp"
+#include "Module.hpp"
+#include "Sections.hpp"
+
+namespace kyut::binary {
+    ModuleStats scan_module(const std::uint8_t* data, std::size_t size) {
+        if (size < std::size(magic) || !std::equal(std::begin(magic), std::end(magic), data)) {
+            throw std::runtime_error{"not a WebAssembly version 1 binary"};
+        }
+
+        ModuleStats stats{};
+
+        Reader r{data, std::size(magic), size};
+
+        while (!r.at_end()) {
+            const auto id = r.read_byte();
+            const auto section_size = r.read_u32();
+            const auto payload_offset = r.offset();
+
+            if (id > static_cast<std::uint8_t>(SectionId::event)) {
+                throw std::runtime_error{"unknown section id"};
+            }
+
+            r.skip(section_size);
+
+            Reader payload{data, payload_offset, r.offset()};
+
+            switch (static_cast<SectionId>(id)) {
+                case SectionId::import: {
+                    const auto count = payload.read_u32();
+                    for (std::uint32_t i = 0; i < count; i++) {
+                        if (read_import(payload) == ExternalKind::function) {
+                            stats.imports++;
+                        }
+                    }
+
+                    if (!payload.at_end()) {
+                        throw std::runtime_error{"import section size mismatch"};
+                    }
+                    break;
+                }
+
+                case SectionId::function:
+                    stats.functions += payload.read_u32();
+                    break;
+
+                case SectionId::export_:
+                    stats.exports = payload.read_u32();
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        stats.functions += stats.imports;
+
+        return stats;
+    }
+
+    ModuleStats scan_module(const std::string& filename) {
+        const MappedFile file{filename};
+
+        return scan_module(file.data(), file.size());
+    }
+} // namespace kyut::binary
@@ -0,0 +1,23 @@
+#ifndef INCLUDE_kyut_binary_Stats_hpp
+#define INCLUDE_kyut_binary_Stats_hpp
+
+#include <cstdint>
+#include <string>
+
+namespace kyut::binary {
+    struct ModuleStats {
+        std::size_t functions; // Imported and defined functions
+        std::size_t exports;
+        std::size_t imports; // Imported functions
+    };
+
+    // Counts entries from the section headers, the vector sizes of the function and the export sections, and the
+    // import section, without decoding or copying any other contents.
+    // Throws std::runtime_error if the binary is malformed.
+    ModuleStats scan_module(const std::uint8_t* data, std::size_t size);
+
+    // Same as above, for a file mapped into memory
+    ModuleStats scan_module(const std::string& filename);
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Stats_hpp
@@ -0,0 +1,57 @@
+#ifndef INCLUDE_kyut_binary_Writer_hpp
+#define INCLUDE_kyut_binary_Writer_hpp
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace kyut::binary {
+    // Appends `x` as unsigned LEB128, padded to at least `min_size` bytes
+    inline void write_u32(std::vector<std::uint8_t>& out, std::uint32_t x, std::size_t min_size = 1) {
+        for (std::size_t n = 1;; n++) {
+            const auto byte = static_cast<std::uint8_t>(x & 0x7F);
+            x >>= 7;
+
+            if (x == 0 && n >= min_size) {
+                out.push_back(byte);
+                return;
+            }
+
+            out.push_back(byte | 0x80);
+        }
+    }
+
+    // Appends a non-negative `x` as signed LEB128, padded to at least `min_size` bytes
+    inline void write_s33(std::vector<std::uint8_t>& out, std::uint32_t x, std::size_t min_size = 1) {
+        for (std::size_t n = 1;; n++) {
+            const auto byte = static_cast<std::uint8_t>(x & 0x7F);
+            x >>= 7;
+
+            // The sign bit of the last byte must be clear
+            if (x == 0 && (byte & 0x40) == 0 && n >= min_size) {
+                out.push_back(byte);
+                return;
+            }
+
+            out.push_back(byte | 0x80);
+        }
+    }
+
+    inline void write_bytes(std::vector<std::uint8_t>& out, const std::uint8_t* begin, const std::uint8_t* end) {
+        out.insert(std::end(out), begin, end);
+    }
+
+    inline void write_name(std::vector<std::uint8_t>& out, std::string_view name) {
+        write_u32(out, static_cast<std::uint32_t>(name.size()));
+        out.insert(std::end(out), std::begin(name), std::end(name));
+    }
+
+    // Appends a section of `id` with `payload` as its contents
+    inline void write_section(std::vector<std::uint8_t>& out, std::uint8_t id, const std::vector<std::uint8_t>& payload) {
+        out.push_back(id);
+        write_u32(out, static_cast<std::uint32_t>(payload.size()));
+        out.insert(std::end(out), std::begin(payload), std::end(payload));
+    }
+} // namespace kyut::binary
+
+#endif // INCLUDE_kyut_binary_Writer_hpp
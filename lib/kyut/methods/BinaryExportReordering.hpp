@@ -0,0 +1,76 @@
+#ifndef INCLUDE_kyut_methods_BinaryExportReordering_hpp
+#define INCLUDE_kyut_methods_BinaryExportReordering_hpp
+
+#include "../NameKey.hpp"
+#include "../Reordering.hpp"
+#include "../binary/Sections.hpp"
+
+namespace kyut {
+    class CircularBitStreamReader;
+    class BitStreamWriter;
+} // namespace kyut
+
+// Export reordering on the export section of a binary, without building IR.
+// Embeds and extracts the same bits as the overloads on `wasm::Module`.
+namespace kyut::methods::export_reordering {
+    inline std::size_t embed(CircularBitStreamReader& r, binary::Module& module, std::size_t limit, std::size_t chunk_size) {
+        auto exports = binary::read_exports(module);
+        if (exports.empty()) {
+            return 0;
+        }
+
+        const auto offset = exports.front().offset;
+
+        const auto size_bits = embed_by_reordering(
+            r,
+            limit,
+            chunk_size,
+            std::begin(exports),
+            std::end(exports),
+            three_way_less([](const NameKey& a, const NameKey& b) {
+                return compare3(a, b);
+            }),
+            [](const binary::ExportEntry& e) {
+                return name_key(e.name);
+            });
+
+        binary::write_entries(module, offset, exports);
+
+        return size_bits;
+    }
+
+    inline std::size_t extract(BitStreamWriter& w, const binary::Module& module, std::size_t chunk_size) {
+        const auto exports = binary::read_exports(module);
+
+        const auto size_bits = extract_by_reordering(
+            w,
+            chunk_size,
+            std::begin(exports),
+            std::end(exports),
+            three_way_less([](const NameKey& a, const NameKey& b) {
+                return compare3(a, b);
+            }),
+            [](const binary::ExportEntry& e) {
+                return name_key(e.name);
+            });
+
+        return size_bits;
+    }
+
+    inline std::size_t capacity(const binary::Module& module, std::size_t chunk_size) {
+        const auto exports = binary::read_exports(module);
+
+        return capacity_by_reordering(
+            chunk_size,
+            std::begin(exports),
+            std::end(exports),
+            three_way_less([](const NameKey& a, const NameKey& b) {
+                return compare3(a, b);
+            }),
+            [](const binary::ExportEntry& e) {
+                return name_key(e.name);
+            });
+    }
+} // namespace kyut::methods::export_reordering
+
+#endif // INCLUDE_kyut_methods_BinaryExportReordering_hpp
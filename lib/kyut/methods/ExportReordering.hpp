@@ -1,6 +1,7 @@
 #ifndef INCLUDE_kyut_methods_ExportReordering_hpp
 #define INCLUDE_kyut_methods_ExportReordering_hpp
 
+#include "../NameKey.hpp"
 #include "../Reordering.hpp"
 #include "wasm.h"
 
@@ -10,6 +11,12 @@ namespace kyut {
 } // namespace kyut
 
 namespace kyut::methods::export_reordering {
+    namespace detail {
+        inline NameKey name_key(wasm::Name name) {
+            return kyut::name_key(name.str != nullptr ? name.str : "");
+        }
+    } // namespace detail
+
     inline std::size_t embed(CircularBitStreamReader& r, wasm::Module& module, std::size_t limit, std::size_t chunk_size) {
         const auto size_bits = embed_by_reordering(
             r,
@@ -17,8 +24,11 @@ namespace kyut::methods::export_reordering {
             chunk_size,
             std::begin(module.exports),
             std::end(module.exports),
-            [](const auto& a, const auto& b) {
-                return a->name < b->name;
+            three_way_less([](const NameKey& a, const NameKey& b) {
+                return compare3(a, b);
+            }),
+            [](const auto& e) {
+                return detail::name_key(e->name);
             });
 
         return size_bits;
@@ -30,12 +40,29 @@ namespace kyut::methods::export_reordering {
             chunk_size,
             std::begin(module.exports),
             std::end(module.exports),
-            [](const auto& a, const auto& b) {
-                return a->name < b->name;
+            three_way_less([](const NameKey& a, const NameKey& b) {
+                return compare3(a, b);
+            }),
+            [](const auto& e) {
+                return detail::name_key(e->name);
             });
 
         return size_bits;
     }
+
+    // Number of bits `embed` embeds without a limit; the module is not changed
+    inline std::size_t capacity(const wasm::Module& module, std::size_t chunk_size) {
+        return capacity_by_reordering(
+            chunk_size,
+            std::begin(module.exports),
+            std::end(module.exports),
+            three_way_less([](const NameKey& a, const NameKey& b) {
+                return compare3(a, b);
+            }),
+            [](const auto& e) {
+                return detail::name_key(e->name);
+            });
+    }
 } // namespace kyut::methods::export_reordering
 
 #endif // INCLUDE_kyut_methods_ExportReordering_hpp
@@ -1,8 +1,13 @@
 #ifndef INCLUDE_kyut_methods_FunctionReordering_hpp
 #define INCLUDE_kyut_methods_FunctionReordering_hpp
 
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "../Parallel.hpp"
 #include "../Reordering.hpp"
-#include "../wasm-ext/Compare.hpp"
+#include "../wasm-ext/FlatFunction.hpp"
 
 namespace kyut {
     class CircularBitStreamReader;
@@ -10,13 +15,53 @@ namespace kyut {
 } // namespace kyut
 
 namespace kyut::methods::function_reordering {
-    inline std::size_t embed(CircularBitStreamReader& r, wasm::Module& module, std::size_t limit, std::size_t chunk_size) {
+    namespace detail {
+        // Moves the imported functions of [begin, end) before the defined ones, keeping the order of each, so that
+        // `capacity` chunks defined functions as `embed` and `extract` do.
+        template <typename RandomAccessIterator>
+        RandomAccessIterator partition_imports(RandomAccessIterator begin, RandomAccessIterator end) {
+            return std::stable_partition(begin, end, [](const auto& f) {
+                return f->body == nullptr;
+            });
+        }
+
+        template <typename RandomAccessIterator>
+        std::unordered_map<const wasm::Function*, FlatFunction> flatten_functions(
+            RandomAccessIterator begin,
+            RandomAccessIterator end,
+            std::size_t num_threads) {
+            const std::size_t count = std::distance(begin, end);
+
+            std::vector<std::optional<FlatFunction>> flats(count);
+            parallel_for(count, num_threads, [&](std::size_t i) {
+                flats[i].emplace(**(begin + i));
+            });
+
+            std::unordered_map<const wasm::Function*, FlatFunction> functions{};
+            functions.reserve(count);
+
+            for (std::size_t i = 0; i < count; i++) {
+                functions.emplace(&**(begin + i), std::move(*flats[i]));
+            }
+
+            return functions;
+        }
+    } // namespace detail
+
+    // Functions are flattened and chunks are processed on up to `num_threads` threads; the result does not depend on it.
+    inline std::size_t embed(
+        CircularBitStreamReader& r,
+        wasm::Module& module,
+        std::size_t limit,
+        std::size_t chunk_size,
+        std::size_t num_threads = 1) {
         const auto begin = std::begin(module.functions);
         const auto end = std::end(module.functions);
 
-        const auto start = std::partition(begin, end, [](const auto& f) {
-            return f->body == nullptr;
-        });
+        const auto start = detail::partition_imports(begin, end);
+
+        // Take a snapshot of each function for comparison
+        const auto functions = detail::flatten_functions(start, end, num_threads);
 
         const auto size_bits = embed_by_reordering(
             r,
@@ -24,32 +69,68 @@ namespace kyut::methods::function_reordering {
             chunk_size,
             start,
             end,
-            [](const auto& a, const auto& b) {
-                return *a < *b;
-            });
+            three_way_less([](const FlatFunction* a, const FlatFunction* b) {
+                return compare3(*a, *b);
+            }),
+            [&](const auto& f) {
+                return &functions.at(f.get());
+            },
+            num_threads);
 
         return size_bits;
     }
 
-    inline std::size_t extract(BitStreamWriter& w, wasm::Module& module, std::size_t chunk_size) {
+    inline std::size_t extract(BitStreamWriter& w, wasm::Module& module, std::size_t chunk_size, std::size_t num_threads = 1) {
         const auto begin = std::begin(module.functions);
         const auto end = std::end(module.functions);
 
-        const auto start = std::partition(begin, end, [](const auto& f) {
-            return f->body == nullptr;
-        });
+        const auto start = detail::partition_imports(begin, end);
+
+        // Take a snapshot of each function for comparison
+        const auto functions = detail::flatten_functions(start, end, num_threads);
 
         const auto size_bits = extract_by_reordering(
             w,
             chunk_size,
             start,
             end,
-            [](const auto& a, const auto& b) {
-                return *a < *b;
-            });
+            three_way_less([](const FlatFunction* a, const FlatFunction* b) {
+                return compare3(*a, *b);
+            }),
+            [&](const auto& f) {
+                return &functions.at(f.get());
+            },
+            num_threads);
 
         return size_bits;
     }
+
+    // Number of bits `embed` embeds without a limit; the module is not changed
+    inline std::size_t capacity(const wasm::Module& module, std::size_t chunk_size, std::size_t num_threads = 1) {
+        std::vector<wasm::Function*> functions{};
+        functions.reserve(module.functions.size());
+
+        for (const auto& f : module.functions) {
+            functions.emplace_back(f.get());
+        }
+
+        // Same order of functions as `embed` reorders
+        const auto start = detail::partition_imports(std::begin(functions), std::end(functions));
+
+        const auto flats = detail::flatten_functions(start, std::end(functions), num_threads);
+
+        return capacity_by_reordering(
+            chunk_size,
+            start,
+            std::end(functions),
+            three_way_less([](const FlatFunction* a, const FlatFunction* b) {
+                return compare3(*a, *b);
+            }),
+            [&](const wasm::Function* f) {
+                return &flats.at(f);
+            },
+            num_threads);
+    }
 } // namespace kyut::methods::function_reordering
 
 #endif // INCLUDE_kyut_methods_FunctionReordering_hpp
@@ -1,10 +1,14 @@
 #include "OperandSwapping.hpp"
 
-#include <boost/range/algorithm_ext/erase.hpp>
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <vector>
 #include "../BitStreamWriter.hpp"
 #include "../CircularBitStreamReader.hpp"
-#include "../wasm-ext/Compare.hpp"
-#include "wasm-traversal.h"
+#include "../Commutativity.hpp"
+#include "../Parallel.hpp"
+#include "../wasm-ext/FlatFunction.hpp"
 
 namespace kyut::methods::operand_swapping {
     namespace {
@@ -15,8 +19,8 @@ namespace kyut::methods::operand_swapping {
         };
 
         bool swap_operands(wasm::Binary& expr) {
-            if (const auto swapped_op = swapped_binary_op(expr.op)) {
-                expr.op = *swapped_op;
+            if (is_commutative(expr.op)) {
+                expr.op = swapped_binary_op_unchecked(expr.op);
                 std::swap(expr.left, expr.right);
 
                 return true;
@@ -25,401 +29,239 @@ namespace kyut::methods::operand_swapping {
             return false;
         }
 
-        template <typename Action>
-        struct OperandSwapVisitor : wasm::OverriddenVisitor<OperandSwapVisitor<Action>, SideEffect> {
-            Action action;
-
-            explicit OperandSwapVisitor(Action action)
-                : action(std::move(action)) {
-            }
-
-            SideEffect visitExpressionList(const wasm::ExpressionList& list) {
-                auto effect = SideEffect::none;
-
-                for (const auto& expr : list) {
-                    effect = (std::max)(visit(expr), effect);
-                }
-
-                return effect;
-            }
-
-            SideEffect visitBlock(wasm::Block* expr) {
-                return visitExpressionList(expr->list);
-            }
-
-            SideEffect visitIf(wasm::If* expr) {
-                return (std::max)({
-                    visit(expr->condition),
-                    visit(expr->ifTrue),
-                    visit(expr->ifFalse),
-                });
-            }
-
-            SideEffect visitLoop(wasm::Loop* expr) {
-                return visit(expr->body);
-            }
-
-            SideEffect visitBreak(wasm::Break* expr) {
-                visit(expr->value);
-                visit(expr->condition);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitSwitch(wasm::Switch* expr) {
-                visit(expr->condition);
-                visit(expr->value);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitCall(wasm::Call* expr) {
-                visitExpressionList(expr->operands);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitCallIndirect(wasm::CallIndirect* expr) {
-                visit(expr->target);
-                visitExpressionList(expr->operands);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitLocalGet([[maybe_unused]] wasm::LocalGet* expr) {
-                return SideEffect::read_only;
-            }
-
-            SideEffect visitLocalSet(wasm::LocalSet* expr) {
-                visit(expr->value);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitGlobalGet([[maybe_unused]] wasm::GlobalGet* expr) {
-                return SideEffect::read_only;
-            }
-
-            SideEffect visitGlobalSet(wasm::GlobalSet* expr) {
-                visit(expr->value);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitLoad(wasm::Load* expr) {
-                return (std::max)(visit(expr->ptr), SideEffect::read_only);
+        // Side effect of an expression, given the combined side effects of its operands
+        SideEffect side_effect(wasm::Expression::Id id, SideEffect operands) {
+            static_assert(wasm::Expression::NumExpressionIds == 49);
+
+            switch (id) {
+                case wasm::Expression::Id::BreakId:
+                case wasm::Expression::Id::SwitchId:
+                case wasm::Expression::Id::CallId:
+                case wasm::Expression::Id::CallIndirectId:
+                case wasm::Expression::Id::LocalSetId:
+                case wasm::Expression::Id::GlobalSetId:
+                case wasm::Expression::Id::StoreId:
+                case wasm::Expression::Id::ReturnId:
+                case wasm::Expression::Id::MemoryGrowId:
+                case wasm::Expression::Id::AtomicRMWId:
+                case wasm::Expression::Id::AtomicCmpxchgId:
+                case wasm::Expression::Id::AtomicWaitId:
+                case wasm::Expression::Id::AtomicNotifyId:
+                case wasm::Expression::Id::AtomicFenceId:
+                case wasm::Expression::Id::MemoryInitId:
+                case wasm::Expression::Id::DataDropId:
+                case wasm::Expression::Id::MemoryCopyId:
+                case wasm::Expression::Id::MemoryFillId:
+                case wasm::Expression::Id::PopId:
+                case wasm::Expression::Id::TryId:
+                case wasm::Expression::Id::ThrowId:
+                case wasm::Expression::Id::RethrowId:
+                case wasm::Expression::Id::BrOnExnId:
+                    return SideEffect::write;
+
+                case wasm::Expression::Id::LocalGetId:
+                case wasm::Expression::Id::GlobalGetId:
+                case wasm::Expression::Id::LoadId:
+                case wasm::Expression::Id::MemorySizeId:
+                case wasm::Expression::Id::SIMDLoadId:
+                case wasm::Expression::Id::RefNullId:
+                case wasm::Expression::Id::RefIsNullId:
+                case wasm::Expression::Id::RefFuncId:
+                    return (std::max)(operands, SideEffect::read_only);
+
+                default:
+                    return operands;
             }
+        }
 
-            SideEffect visitStore(wasm::Store* expr) {
-                visit(expr->ptr);
-                visit(expr->value);
-
-                return SideEffect::write;
-            }
+        // A binary expression whose operands can be swapped
+        struct Site {
+            wasm::Binary* expr;
+            const wasm::Expression* lo;
+        };
 
-            SideEffect visitConst([[maybe_unused]] wasm::Const* expr) {
-                return SideEffect::none;
-            }
+        // Appends the binary expressions in `f` whose operands can be swapped, in post-order
+        void find_sites(const FlatFunction& f, std::vector<SideEffect>& effects, std::vector<Site>& sites) {
+            const auto& nodes = f.nodes();
+            effects.resize(nodes.size());
 
-            SideEffect visitUnary(wasm::Unary* expr) {
-                return visit(expr->value);
-            }
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                const auto& node = nodes[i];
 
-            SideEffect visitBinary(wasm::Binary* expr) {
-                if (!is_commutative(expr->op)) {
-                    return (std::max)(visit(expr->left), visit(expr->right));
+                auto operands = SideEffect::none;
+                for (std::size_t k = 0, child = i - 1; k < node.num_children; k++, child -= nodes[child].size) {
+                    operands = (std::max)(operands, effects[child]);
                 }
 
-                if (!(*expr->left < *expr->right) && !(*expr->right < *expr->left)) {
-                    return (std::max)(visit(expr->left), visit(expr->right));
-                }
+                effects[i] = side_effect(node.id, operands);
 
-                // Sort the operands
-                auto [lo, hi] = std::minmax(expr->left, expr->right, [](auto a, auto b) { return *a < *b; });
+                // Skip non-commutative or equal operands, and the operands of rethrow and br_on_exn
+                if (node.order == 0 || node.opaque) {
+                    continue;
+                }
 
-                const auto effect_lo = visit(lo);
-                const auto effect_hi = visit(hi);
+                // The operands are in the order of (lo, hi)
+                const auto hi = i - 1;
+                const auto lo = hi - nodes[hi].size;
 
-                if (static_cast<std::uint32_t>(effect_lo) + static_cast<std::uint32_t>(effect_hi) < 3) {
+                if (static_cast<std::uint32_t>(effects[lo]) + static_cast<std::uint32_t>(effects[hi]) < 3) {
                     // The operands can be swapped
-                    action(*expr, *lo, *hi);
+                    sites.push_back({node.expr->cast<wasm::Binary>(), nodes[lo].expr});
                 }
-
-                return (std::max)(effect_lo, effect_hi);
-            }
-
-            SideEffect visitSelect(wasm::Select* expr) {
-                return (std::max)({
-                    visit(expr->ifTrue),
-                    visit(expr->ifFalse),
-                    visit(expr->condition),
-                });
-            }
-
-            SideEffect visitDrop(wasm::Drop* expr) {
-                return visit(expr->value);
-            }
-
-            SideEffect visitReturn(wasm::Return* expr) {
-                visit(expr->value);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitMemorySize([[maybe_unused]] wasm::MemorySize* expr) {
-                return SideEffect::read_only;
-            }
-
-            SideEffect visitMemoryGrow(wasm::MemoryGrow* expr) {
-                visit(expr->delta);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitNop([[maybe_unused]] wasm::Nop* expr) {
-                return SideEffect::none;
-            }
-
-            SideEffect visitUnreachable([[maybe_unused]] wasm::Unreachable* expr) {
-                return SideEffect::none;
-            }
-
-            SideEffect visitAtomicRMW(wasm::AtomicRMW* expr) {
-                visit(expr->ptr);
-                visit(expr->value);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitAtomicCmpxchg(wasm::AtomicCmpxchg* expr) {
-                visit(expr->ptr);
-                visit(expr->expected);
-                visit(expr->replacement);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitAtomicWait(wasm::AtomicWait* expr) {
-                visit(expr->ptr);
-                visit(expr->expected);
-                visit(expr->timeout);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitAtomicNotify(wasm::AtomicNotify* expr) {
-                visit(expr->ptr);
-                visit(expr->notifyCount);
-
-                return SideEffect::write;
-            }
-
-            SideEffect visitAtomicFence([[maybe_unused]] wasm::AtomicFence* expr) {
-                return SideEffect::write;
-            }
-
-            SideEffect visitSIMDExtract(wasm::SIMDExtract* expr) {
-                return visit(expr->vec);
-            }
-
-            SideEffect visitSIMDReplace(wasm::SIMDReplace* expr) {
-                return (std::max)(visit(expr->vec), visit(expr->value));
-            }
-
-            SideEffect visitSIMDShuffle(wasm::SIMDShuffle* expr) {
-                return (std::max)(visit(expr->left), visit(expr->right));
-            }
-
-            SideEffect visitSIMDTernary(wasm::SIMDTernary* expr) {
-                return (std::max)({
-                    visit(expr->a),
-                    visit(expr->b),
-                    visit(expr->c),
-                });
-            }
-
-            SideEffect visitSIMDShift(wasm::SIMDShift* expr) {
-                return (std::max)(visit(expr->vec), visit(expr->shift));
-            }
-
-            SideEffect visitSIMDLoad(wasm::SIMDLoad* expr) {
-                return (std::max)({
-                    visit(expr->ptr),
-                    SideEffect::read_only,
-                });
             }
+        }
 
-            SideEffect visitMemoryInit(wasm::MemoryInit* expr) {
-                visit(expr->dest);
-                visit(expr->offset);
-                visit(expr->size);
+        // Swap sites of each function with a body, in the order of embedding
+        struct FunctionSites {
+            wasm::Function* function;
+            std::vector<Site> sites;
+        };
 
-                return SideEffect::write;
-            }
+        std::vector<FunctionSites> find_sites(const wasm::Module& module, std::size_t num_threads) {
+            std::vector<wasm::Function*> functions{};
+            functions.reserve(module.functions.size());
 
-            SideEffect visitDataDrop([[maybe_unused]] wasm::DataDrop* expr) {
-                return SideEffect::write;
+            for (const auto& f : module.functions) {
+                // Skip functions without bodies
+                if (f->body != nullptr) {
+                    functions.emplace_back(f.get());
+                }
             }
 
-            SideEffect visitMemoryCopy(wasm::MemoryCopy* expr) {
-                visit(expr->dest);
-                visit(expr->source);
-                visit(expr->size);
+            std::vector<std::optional<FlatFunction>> flats(functions.size());
+            parallel_for(functions.size(), num_threads, [&](std::size_t i) {
+                flats[i].emplace(*functions[i]);
+            });
 
-                return SideEffect::write;
-            }
-
-            SideEffect visitMemoryFill(wasm::MemoryFill* expr) {
-                visit(expr->dest);
-                visit(expr->value);
-                visit(expr->size);
+            parallel_sort(std::begin(flats), std::end(flats), num_threads, [](const auto& a, const auto& b) {
+                return compare3_body(*a, *b) < 0;
+            });
 
-                return SideEffect::write;
-            }
+            std::vector<FunctionSites> sites(flats.size());
+            parallel_for(flats.size(), num_threads, [&](std::size_t i) {
+                sites[i].function = &flats[i]->function();
 
-            SideEffect visitPop([[maybe_unused]] wasm::Pop* expr) {
-                return SideEffect::write;
-            }
+                std::vector<SideEffect> effects{};
+                find_sites(*flats[i], effects, sites[i].sites);
+            });
 
-            SideEffect visitRefNull([[maybe_unused]] wasm::RefNull* expr) {
-                return SideEffect::read_only;
-            }
+            return sites;
+        }
+    } // namespace
 
-            SideEffect visitRefIsNull(wasm::RefIsNull* expr) {
-                return (std::max)(visit(expr->value), SideEffect::read_only);
-            }
+    std::size_t embed(CircularBitStreamReader& r, wasm::Module& module, std::size_t limit, std::size_t num_threads) {
+        std::vector<wasm::Function*> modified{};
+        return embed(r, module, limit, num_threads, modified);
+    }
 
-            SideEffect visitRefFunc([[maybe_unused]] wasm::RefFunc* expr) {
-                return SideEffect::read_only;
-            }
+    std::size_t embed(
+        CircularBitStreamReader& r,
+        wasm::Module& module,
+        std::size_t limit,
+        std::size_t num_threads,
+        std::vector<wasm::Function*>& modified) {
+        const auto sites = find_sites(module, num_threads);
 
-            SideEffect visitTry(wasm::Try* expr) {
-                visit(expr->body);
-                visit(expr->catchBody);
+        // Embed into whole functions until the limit is reached
+        std::vector<std::size_t> offsets{0};
+        for (const auto& s : sites) {
+            offsets.push_back(offsets.back() + s.sites.size());
 
-                return SideEffect::write;
+            if (offsets.back() >= limit) {
+                break;
             }
+        }
 
-            SideEffect visitThrow(wasm::Throw* expr) {
-                visitExpressionList(expr->operands);
-
-                return SideEffect::write;
-            }
+        const auto num_functions = offsets.size() - 1;
+        const auto size_bits = offsets.back();
 
-            SideEffect visitRethrow([[maybe_unused]] wasm::Rethrow* expr) {
-                return SideEffect::write;
-            }
+        // Each function takes the bits at its own offset
+        const auto start = r.position_bits();
 
-            SideEffect visitBrOnExn([[maybe_unused]] wasm::BrOnExn* expr) {
-                return SideEffect::write;
+        // Embed the watermark
+        std::vector<char> swapped(num_functions);
+        parallel_for(num_functions, num_threads, [&](std::size_t i) {
+            const auto& function_sites = sites[i].sites;
+
+            for (std::size_t k = 0; k < function_sites.size(); k += 64) {
+                const auto n = (std::min)(std::size_t{64}, function_sites.size() - k);
+                const auto word = r.read_at(start + offsets[i] + k, n);
+
+                for (std::size_t j = 0; j < n; j++) {
+                    const auto& site = function_sites[k + j];
+                    const auto bit = ((word >> (n - j - 1)) & 1) != 0;
+
+                    // Embed watermark bit into the binary expression
+                    if (bit == (site.expr->left == site.lo)) {
+                        swap_operands(*site.expr);
+                        swapped[i] = true;
+                    }
+                }
             }
+        });
 
-            SideEffect visitTupleMake(wasm::TupleMake* expr) {
-                return visitExpressionList(expr->operands);
-            }
+        r.seek(start + size_bits);
 
-            SideEffect visitTupleExtract(wasm::TupleExtract* expr) {
-                return visit(expr->tuple);
+        for (std::size_t i = 0; i < num_functions; i++) {
+            if (swapped[i]) {
+                modified.emplace_back(sites[i].function);
             }
+        }
 
-            SideEffect visit(wasm::Expression* expr) {
-                if (expr == nullptr) {
-                    return SideEffect::none;
-                }
-                return wasm::OverriddenVisitor<OperandSwapVisitor<Action>, SideEffect>::visit(expr);
-            }
+        return size_bits;
+    }
 
-            void visitFunction(wasm::Function* func) {
-                visit(func->body);
-            }
-        };
-    } // namespace
+    std::size_t extract(BitStreamWriter& w, wasm::Module& module, std::size_t num_threads) {
+        const auto sites = find_sites(module, num_threads);
 
-    std::size_t embed(CircularBitStreamReader& r, wasm::Module& module, std::size_t limit) {
-        std::vector<wasm::Function*> functions{};
-        functions.reserve(module.functions.size());
+        std::vector<std::size_t> offsets{0};
+        for (const auto& s : sites) {
+            offsets.push_back(offsets.back() + s.sites.size());
+        }
 
-        std::transform(
-            std::begin(module.functions),
-            std::end(module.functions),
-            std::back_inserter(functions),
-            [](const auto& f) { return f.get(); });
+        const auto size_bits = offsets.back();
 
-        // Remove functions without bodies
-        boost::range::remove_erase_if(
-            functions,
-            [](const wasm::Function* f) { return f->body == nullptr; });
+        const auto start = w.position_bits();
+        w.resize(start + size_bits);
 
-        // Sort functions in the module by thier body expression
-        std::sort(
-            std::begin(functions),
-            std::end(functions),
-            [](const wasm::Function* a, const wasm::Function* b) { return *a->body < *b->body; });
+        // Extract the watermark, each function to its own offset
+        parallel_for(sites.size(), num_threads, [&](std::size_t i) {
+            const auto& function_sites = sites[i].sites;
 
-        // Embed the watermark
-        std::size_t size_bits = 0;
+            for (std::size_t k = 0; k < function_sites.size(); k += 64) {
+                const auto n = (std::min)(std::size_t{64}, function_sites.size() - k);
 
-        OperandSwapVisitor visitor{
-            [&](wasm::Binary& expr, wasm::Expression& lo, [[maybe_unused]] wasm::Expression& hi) {
-                // Embed watermark bit into the binary expression
-                const bool bit = r.read_bit();
+                std::uint64_t word = 0;
+                for (std::size_t j = 0; j < n; j++) {
+                    const auto& site = function_sites[k + j];
 
-                if (bit == (expr.left == &lo)) {
-                    swap_operands(expr);
+                    // Extract watermark bit from the binary expression
+                    word = (word << 1) | (site.expr->left != site.lo ? 1 : 0);
                 }
 
-                size_bits += 1;
-            }};
-
-        for (const auto& f : functions) {
-            visitor.visitFunction(f);
-
-            if (size_bits >= limit) {
-                break;
+                w.write_at(start + offsets[i] + k, word, n);
             }
-        }
+        });
 
         return size_bits;
     }
 
-    std::size_t extract(BitStreamWriter& w, wasm::Module& module) {
-        std::vector<wasm::Function*> functions{};
-        functions.reserve(module.functions.size());
+    std::size_t capacity(const wasm::Module& module, std::size_t num_threads) {
+        std::vector<std::size_t> counts(module.functions.size());
 
-        std::transform(
-            std::begin(module.functions),
-            std::end(module.functions),
-            std::back_inserter(functions),
-            [](const auto& f) { return f.get(); });
+        // Every site of every function with a body takes a bit, in whichever order
+        parallel_for(module.functions.size(), num_threads, [&](std::size_t i) {
+            auto& f = *module.functions[i];
 
-        // Remove functions without bodies
-        boost::range::remove_erase_if(
-            functions,
-            [](const wasm::Function* f) { return f->body == nullptr; });
+            if (f.body != nullptr) {
+                std::vector<SideEffect> effects{};
+                std::vector<Site> sites{};
+                find_sites(FlatFunction{f}, effects, sites);
 
-        // Sort functions in the module by thier body expression
-        std::sort(
-            std::begin(functions),
-            std::end(functions),
-            [](const wasm::Function* a, const wasm::Function* b) { return *a->body < *b->body; });
-
-        // Extract the watermark
-        std::size_t size_bits = 0;
-
-        OperandSwapVisitor visitor{
-            [&](wasm::Binary& expr, wasm::Expression& lo, [[maybe_unused]] wasm::Expression& hi) {
-                // Extract watermark bit from the binary expression
-                const bool bit = expr.left != &lo;
-
-                w.write_bit(bit);
-
-                size_bits += 1;
-            }};
-
-        for (const auto& f : functions) {
-            visitor.visitFunction(f);
-        }
+                counts[i] = sites.size();
+            }
+        });
 
-        return size_bits;
+        return std::accumulate(std::begin(counts), std::end(counts), std::size_t{0});
     }
 } // namespace kyut::methods::operand_swapping
@@ -2,8 +2,10 @@
 #define INCLUDE_kyut_methods_OperandSwapping_hpp
 
 #include <cstddef>
+#include <vector>
 
 namespace wasm {
+    class Function;
     class Module;
 } // namespace wasm
 
@@ -13,9 +15,21 @@ namespace kyut {
 } // namespace kyut
 
 namespace kyut::methods::operand_swapping {
-    std::size_t embed(CircularBitStreamReader& r, wasm::Module& module, std::size_t limit);
+    // Functions are processed on up to `num_threads` threads; the result does not depend on it
+    std::size_t embed(CircularBitStreamReader& r, wasm::Module& module, std::size_t limit, std::size_t num_threads = 1);
 
-    std::size_t extract(BitStreamWriter& w, wasm::Module& module);
+    // Same as above, and appends the functions whose operands are swapped to `modified`
+    std::size_t embed(
+        CircularBitStreamReader& r,
+        wasm::Module& module,
+        std::size_t limit,
+        std::size_t num_threads,
+        std::vector<wasm::Function*>& modified);
+
+    std::size_t extract(BitStreamWriter& w, wasm::Module& module, std::size_t num_threads = 1);
+
+    // Number of bits `embed` embeds without a limit; the module is not changed
+    std::size_t capacity(const wasm::Module& module, std::size_t num_threads = 1);
 } // namespace kyut::methods::operand_swapping
 
 #endif // INCLUDE_kyut_methods_OperandSwapping_hpp
@@ -0,0 +1,131 @@
+#include "RawFunctionReordering.hpp"
+
+#include <numeric>
+#include "../Parallel.hpp"
+#include "../Reordering.hpp"
+#include "../binary/Code.hpp"
+#include "../binary/Reorder.hpp"
+#include "../binary/Sections.hpp"
+
+namespace kyut::methods::raw_function_reordering {
+    namespace {
+        struct Key {
+            std::uint64_t type_hash;
+            std::uint64_t hash;
+        };
+
+        int compare3(const Key& a, const Key& b) {
+            if (a.type_hash != b.type_hash) {
+                return a.type_hash < b.type_hash ? -1 : 1;
+            }
+
+            if (a.hash != b.hash) {
+                return a.hash < b.hash ? -1 : 1;
+            }
+
+            return 0;
+        }
+
+        // Key of each defined function, in the order of the code section
+        std::vector<Key> make_keys(const binary::Module& module, std::size_t num_threads) {
+            const auto types = binary::read_types(module);
+            const auto functions = binary::read_functions(module);
+            const auto code = binary::read_code(module);
+
+            if (functions.size() != code.size()) {
+                throw std::runtime_error{"function and code section size mismatch"};
+            }
+
+            // Types are keyed by their encoding, as their indices change with section reordering
+            std::vector<std::uint64_t> type_hashes{};
+            type_hashes.reserve(types.size());
+            for (const auto& type : types) {
+                const auto bytes = reinterpret_cast<const std::uint8_t*>(type.data());
+                type_hashes.emplace_back(binary::hash_bytes(bytes, bytes + type.size()));
+            }
+
+            for (const auto& f : functions) {
+                if (f.type_index >= type_hashes.size()) {
+                    throw std::runtime_error{"type index out of range"};
+                }
+            }
+
+            std::vector<Key> keys(code.size());
+            std::vector<char> failed(code.size());
+
+            parallel_for(code.size(), num_threads, [&](std::size_t i) {
+                const auto hash = binary::hash_body(module, code[i]);
+
+                keys[i] = Key{type_hashes[functions[i].type_index], hash.value_or(0)};
+                failed[i] = !hash;
+            });
+
+            if (std::find(std::begin(failed), std::end(failed), true) != std::end(failed)) {
+                throw std::runtime_error{"unknown instruction in function body"};
+            }
+
+            return keys;
+        }
+    } // namespace
+
+    std::size_t embed(CircularBitStreamReader& r, binary::Module& module, std::size_t limit, std::size_t chunk_size, std::size_t num_threads) {
+        const auto keys = make_keys(module, num_threads);
+
+        binary::ModuleOrder order{};
+        order.functions.resize(keys.size());
+        std::iota(std::begin(order.functions), std::end(order.functions), std::uint32_t{0});
+
+        const auto size_bits = embed_by_reordering(
+            r,
+            limit,
+            chunk_size,
+            std::begin(order.functions),
+            std::end(order.functions),
+            three_way_less([](const Key* a, const Key* b) {
+                return compare3(*a, *b);
+            }),
+            [&](std::uint32_t i) {
+                return &keys[i];
+            },
+            num_threads);
+
+        module = binary::reorder(module, order, num_threads);
+
+        return size_bits;
+    }
+
+    std::size_t extract(BitStreamWriter& w, const binary::Module& module, std::size_t chunk_size, std::size_t num_threads) {
+        const auto keys = make_keys(module, num_threads);
+
+        const auto size_bits = extract_by_reordering(
+            w,
+            chunk_size,
+            std::begin(keys),
+            std::end(keys),
+            three_way_less([](const Key* a, const Key* b) {
+                return compare3(*a, *b);
+            }),
+            [](const Key& key) {
+                return &key;
+            },
+            num_threads);
+
+        return size_bits;
+    }
+
+    std::size_t capacity(const binary::Module& module, std::size_t chunk_size, std::size_t num_threads) {
+        const auto keys = make_keys(module, num_threads);
+
+        return capacity_by_reordering(
+            chunk_size,
+            std::begin(keys),
+            std::end(keys),
+            three_way_less([](const Key* a, const Key* b) {
+                return compare3(*a, *b);
+            }),
+            [](const Key& key) {
+                return &key;
+            },
+            num_threads);
+    }
+} // namespace kyut::methods::raw_function_reordering
@@ -0,0 +1,29 @@
+#ifndef INCLUDE_kyut_methods_RawFunctionReordering_hpp
+#define INCLUDE_kyut_methods_RawFunctionReordering_hpp
+
+#include <cstddef>
+
+namespace kyut {
+    class CircularBitStreamReader;
+    class BitStreamWriter;
+
+    namespace binary {
+        class Module;
+    } // namespace binary
+} // namespace kyut
+
+// Function reordering on the function and code sections of a binary, without building IR.
+// Functions are ordered by a hash of their type and a hash of their body, both without any index in them, so the order
+// does not change when `section_reordering` reorders types, imports, globals and segments. This is not the order of
+// `function_reordering`, so watermarks of one cannot be extracted with the other.
+namespace kyut::methods::raw_function_reordering {
+    // Bodies are hashed and rewritten on up to `num_threads` threads; the result does not depend on it
+    std::size_t embed(CircularBitStreamReader& r, binary::Module& module, std::size_t limit, std::size_t chunk_size, std::size_t num_threads = 1);
+
+    std::size_t extract(BitStreamWriter& w, const binary::Module& module, std::size_t chunk_size, std::size_t num_threads = 1);
+
+    // Number of bits `embed` embeds without a limit
+    std::size_t capacity(const binary::Module& module, std::size_t chunk_size, std::size_t num_threads = 1);
+} // namespace kyut::methods::raw_function_reordering
+
+#endif // INCLUDE_kyut_methods_RawFunctionReordering_hpp
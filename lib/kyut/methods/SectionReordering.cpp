@@ -0,0 +1,226 @@
+#include "SectionReordering.hpp"
+
+#include <array>
+#include <functional>
+#include <numeric>
+#include <tuple>
+#include "../Reordering.hpp"
+#include "../binary/Code.hpp"
+#include "../binary/Reorder.hpp"
+#include "../binary/Sections.hpp"
+
+namespace kyut::methods::section_reordering {
+    namespace {
+        // Entries reordered among themselves
+        struct Group {
+            std::vector<std::uint32_t> positions; // Position of each entry in its section
+            std::vector<std::uint64_t> keys;
+        };
+
+        enum GroupId {
+            types,
+            function_imports,
+            global_imports,
+            globals,
+            elements,
+            data,
+            num_groups,
+        };
+
+        struct Groups {
+            std::array<Group, num_groups> groups;
+            std::size_t num_imports;
+        };
+
+        std::uint64_t hash_value(std::uint64_t x, std::uint64_t hash) {
+            std::array<std::uint8_t, 8> bytes{};
+            for (std::size_t i = 0; i < bytes.size(); i++) {
+                bytes[i] = static_cast<std::uint8_t>(x >> (8 * i));
+            }
+
+            return binary::hash_bytes(bytes.data(), bytes.data() + bytes.size(), hash);
+        }
+
+        // Whether reordering `segments` keeps the result of their initialization
+        bool can_reorder(const std::vector<binary::SegmentEntry>& segments) {
+            // Target and range of each active segment
+            std::vector<std::tuple<std::uint32_t, std::uint64_t, std::uint64_t>> ranges{};
+
+            for (const auto& s : segments) {
+                if (!s.active()) {
+                    continue;
+                }
+
+                if (!s.base || *s.base + s.size < *s.base) {
+                    return false;
+                }
+
+                if (s.size != 0) {
+                    ranges.emplace_back(s.target, *s.base, *s.base + s.size);
+                }
+            }
+
+            std::sort(std::begin(ranges), std::end(ranges));
+
+            for (std::size_t i = 1; i < ranges.size(); i++) {
+                const auto& [target, begin, end] = ranges[i];
+                const auto& [prev_target, prev_begin, prev_end] = ranges[i - 1];
+
+                if (target == prev_target && begin < prev_end) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        void add_segments(Group& group, const binary::Module& module, const std::vector<binary::SegmentEntry>& segments) {
+            if (!can_reorder(segments)) {
+                return;
+            }
+
+            const auto bytes = module.bytes().data();
+
+            for (std::size_t i = 0; i < segments.size(); i++) {
+                const auto& s = segments[i];
+
+                auto hash = hash_value(s.flags, binary::hash_seed);
+                hash = hash_value(s.target, hash);
+                hash = hash_value(s.base.value_or(0), hash);
+                hash = hash_value(s.size, hash);
+                hash = binary::hash_bytes(bytes + s.init_offset, bytes + s.end, hash);
+
+                group.positions.emplace_back(static_cast<std::uint32_t>(i));
+                group.keys.emplace_back(hash);
+            }
+        }
+
+        Groups make_groups(const binary::Module& module) {
+            const auto bytes = module.bytes().data();
+            Groups result{};
+            auto& groups = result.groups;
+
+            const auto types = binary::read_types(module);
+            for (std::size_t i = 0; i < types.size(); i++) {
+                const auto type = reinterpret_cast<const std::uint8_t*>(types[i].data());
+
+                groups[GroupId::types].positions.emplace_back(static_cast<std::uint32_t>(i));
+                groups[GroupId::types].keys.emplace_back(binary::hash_bytes(type, type + types[i].size()));
+            }
+
+            // Function imports are keyed by their names only, as their type indices change with types
+            const auto imports = binary::read_imports(module);
+            for (std::size_t i = 0; i < imports.size(); i++) {
+                const auto& e = imports[i];
+
+                if (e.kind == binary::ExternalKind::function) {
+                    binary::Reader r{bytes, e.offset, e.end};
+                    r.read_name(); // Module
+                    r.read_name(); // Field
+
+                    groups[GroupId::function_imports].positions.emplace_back(static_cast<std::uint32_t>(i));
+                    groups[GroupId::function_imports].keys.emplace_back(binary::hash_bytes(bytes + e.offset, bytes + r.offset()));
+                } else if (e.kind == binary::ExternalKind::global) {
+                    groups[GroupId::global_imports].positions.emplace_back(static_cast<std::uint32_t>(i));
+                    groups[GroupId::global_imports].keys.emplace_back(binary::hash_bytes(bytes + e.offset, bytes + e.end));
+                }
+            }
+
+            result.num_imports = imports.size();
+
+            const auto globals = binary::read_globals(module);
+            for (std::size_t i = 0; i < globals.size(); i++) {
+                const auto& e = globals[i];
+
+                // Value type and mutability, and the initializer
+                binary::Reader r{bytes, e.offset + 2, e.end};
+                const auto hash = binary::hash_expr(module, r, binary::hash_bytes(bytes + e.offset, bytes + e.offset + 2));
+
+                if (!hash) {
+                    throw std::runtime_error{"unknown constant expression"};
+                }
+
+                groups[GroupId::globals].positions.emplace_back(static_cast<std::uint32_t>(i));
+                groups[GroupId::globals].keys.emplace_back(*hash);
+            }
+
+            add_segments(groups[GroupId::elements], module, binary::read_elements(module));
+            add_segments(groups[GroupId::data], module, binary::read_data(module));
+
+            return result;
+        }
+    } // namespace
+
+    std::size_t embed(CircularBitStreamReader& r, binary::Module& module, std::size_t limit, std::size_t chunk_size, std::size_t num_threads) {
+        const auto [groups, num_imports] = make_groups(module);
+
+        // New order of the positions of each group
+        std::array<std::vector<std::uint32_t>, num_groups> orders{};
+
+        std::size_t size_bits = 0;
+        for (std::size_t k = 0; k < num_groups; k++) {
+            const auto& g = groups[k];
+            auto& order = orders[k];
+
+            order.resize(g.keys.size());
+            std::iota(std::begin(order), std::end(order), std::uint32_t{0});
+
+            if (size_bits < limit) {
+                size_bits += embed_by_reordering(
+                    r,
+                    limit - size_bits,
+                    chunk_size,
+                    std::begin(order),
+                    std::end(order),
+                    std::less<>{},
+                    [&](std::uint32_t i) {
+                        return g.keys[i];
+                    });
+            }
+
+            for (auto& i : order) {
+                i = g.positions[i];
+            }
+        }
+
+        binary::ModuleOrder order{};
+        order.types = std::move(orders[GroupId::types]);
+        order.globals = std::move(orders[GroupId::globals]);
+        order.elements = std::move(orders[GroupId::elements]);
+        order.data = std::move(orders[GroupId::data]);
+
+        // Function and global imports are reordered within their own positions
+        order.imports.resize(num_imports);
+        std::iota(std::begin(order.imports), std::end(order.imports), std::uint32_t{0});
+
+        for (const auto k : {GroupId::function_imports, GroupId::global_imports}) {
+            for (std::size_t i = 0; i < orders[k].size(); i++) {
+                order.imports[groups[k].positions[i]] = orders[k][i];
+            }
+        }
+
+        module = binary::reorder(module, order, num_threads);
+
+        return size_bits;
+    }
+
+    std::size_t extract(BitStreamWriter& w, const binary::Module& module, std::size_t chunk_size) {
+        std::size_t size_bits = 0;
+        for (const auto& g : make_groups(module).groups) {
+            size_bits += extract_by_reordering(w, chunk_size, std::begin(g.keys), std::end(g.keys), std::less<>{});
+        }
+
+        return size_bits;
+    }
+
+    std::size_t capacity(const binary::Module& module, std::size_t chunk_size) {
+        std::size_t size_bits = 0;
+        for (const auto& g : make_groups(module).groups) {
+            size_bits += capacity_by_reordering(chunk_size, std::begin(g.keys), std::end(g.keys), std::less<>{}, [](std::uint64_t key) {
+                return key;
+            });
+        }
+
+        return size_bits;
+    }
+} // namespace kyut::methods::section_reordering
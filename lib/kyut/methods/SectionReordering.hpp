@@ -0,0 +1,31 @@
+#ifndef INCLUDE_kyut_methods_SectionReordering_hpp
+#define INCLUDE_kyut_methods_SectionReordering_hpp
+
+#include <cstddef>
+
+namespace kyut {
+    class CircularBitStreamReader;
+    class BitStreamWriter;
+
+    namespace binary {
+        class Module;
+    } // namespace binary
+} // namespace kyut
+
+// Reordering of the entries of the type, import, global, element and data sections of a binary, without building IR.
+// The watermark is embedded into types, function imports, global imports, defined globals, element segments and
+// data segments, in this order. Entries are ordered by a hash of their encoding without the indices in it, so the
+// order does not depend on the other reorderings.
+// Segments are reordered only if every active one has a constant offset and none of them overlap, as active segments
+// are initialized in order.
+namespace kyut::methods::section_reordering {
+    // Function bodies are rewritten on up to `num_threads` threads; the result does not depend on it
+    std::size_t embed(CircularBitStreamReader& r, binary::Module& module, std::size_t limit, std::size_t chunk_size, std::size_t num_threads = 1);
+
+    std::size_t extract(BitStreamWriter& w, const binary::Module& module, std::size_t chunk_size);
+
+    // Number of bits `embed` embeds without a limit
+    std::size_t capacity(const binary::Module& module, std::size_t chunk_size);
+} // namespace kyut::methods::section_reordering
+
+#endif // INCLUDE_kyut_methods_SectionReordering_hpp
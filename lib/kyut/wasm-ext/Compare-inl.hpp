@@ -4,379 +4,590 @@
 #include "Compare.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 #include "../Commutativity.hpp"
 
-namespace wasm {
-    inline bool operator<(const Literal& a, const Literal& b) {
-        return std::less<Literal>{}(a, b);
+namespace kyut::detail {
+    template <typename T>
+    int compare3_values(const T& a, const T& b) {
+        return a < b ? -1 : b < a ? 1 : 0;
     }
 
-    inline bool operator<(const Expression& a, const Expression& b) {
-        static_assert(Expression::NumExpressionIds == 49);
-
-        // Expr* -> optional<Expr&>
-        constexpr auto opt = [](const Expression* p) -> boost::optional<const Expression&> {
-            if (p == nullptr) {
-                return boost::none;
-            }
-            return *p;
+    // Pending work of the iterative comparison
+    struct Compare3Task {
+        enum class Kind : std::uint8_t {
+            result,              // `result` is the outcome of a scalar field
+            expression,          // Compare `*a` and `*b`
+            optional_expression, // Compare `a` and `b` (nullptr is the least)
+            normalize,           // Order the operands of the binary nodes `a` and `b`, then compare them
         };
 
-        if (&a == &b) {
-            return false;
-        }
-
-        if (a._id != b._id) {
-            return a._id < b._id;
-        }
-
-        if (a.type != b.type) {
-            return a.type < b.type;
+        Kind kind;
+        std::int8_t result; // normalize: the order of the operands of `a`
+        std::uint8_t stage; // normalize: 0 while ordering the operands of `a`, 1 while ordering those of `b`
+        const wasm::Expression* a;
+        const wasm::Expression* b;
+    };
+
+    // Schedules the fields of a pair of nodes to be compared lexicographically from left to right.
+    // The tasks are pushed in field order and reversed when the chain goes out of scope, so the first field is on the top.
+    class Compare3Fields {
+    public:
+        explicit Compare3Fields(std::vector<Compare3Task>& tasks)
+            : tasks_(tasks)
+            , begin_(tasks.size())
+            , decided_(false) {
         }
 
-        switch (a._id) {
-            case Expression::Id::BlockId: {
-                const auto& x = *a.cast<Block>();
-                const auto& y = *b.cast<Block>();
-
-                return x.list < y.list;
-            }
-            case Expression::Id::IfId: {
-                const auto& x = *a.cast<If>();
-                const auto& y = *b.cast<If>();
-
-                return std::forward_as_tuple(*x.condition, *x.ifTrue, opt(x.ifFalse)) <
-                       std::forward_as_tuple(*y.condition, *y.ifTrue, opt(y.ifFalse));
-            }
-            case Expression::Id::LoopId: {
-                const auto& x = *a.cast<Loop>();
-                const auto& y = *b.cast<Loop>();
-
-                return *x.body < *y.body;
-            }
-            case Expression::Id::BreakId: {
-                const auto& x = *a.cast<Break>();
-                const auto& y = *b.cast<Break>();
+        // Uncopyable and unmovable
+        Compare3Fields(const Compare3Fields&) = delete;
+        Compare3Fields(Compare3Fields&&) = delete;
 
-                return std::forward_as_tuple(opt(x.value), opt(x.condition)) <
-                       std::forward_as_tuple(opt(y.value), opt(y.condition));
-            }
-            case Expression::Id::SwitchId: {
-                const auto& x = *a.cast<Switch>();
-                const auto& y = *b.cast<Switch>();
+        Compare3Fields& operator=(const Compare3Fields&) = delete;
+        Compare3Fields& operator=(Compare3Fields&&) = delete;
 
-                return std::forward_as_tuple(opt(x.value), opt(x.condition)) <
-                       std::forward_as_tuple(opt(y.value), opt(y.condition));
-            }
-            case Expression::Id::CallId: {
-                const auto& x = *a.cast<Call>();
-                const auto& y = *b.cast<Call>();
+        ~Compare3Fields() noexcept {
+            std::reverse(std::begin(tasks_) + begin_, std::end(tasks_));
+        }
 
-                return x.operands < y.operands;
-            }
-            case Expression::Id::CallIndirectId: {
-                const auto& x = *a.cast<CallIndirect>();
-                const auto& y = *b.cast<CallIndirect>();
+        // Expressions
+        Compare3Fields& operator()(const wasm::Expression& a, const wasm::Expression& b) {
+            push({Compare3Task::Kind::expression, 0, 0, &a, &b});
+            return *this;
+        }
 
-                return std::forward_as_tuple(x.operands, *x.target) < std::forward_as_tuple(y.operands, *y.target);
-            }
-            case Expression::Id::LocalGetId: {
-                const auto& x = *a.cast<LocalGet>();
-                const auto& y = *b.cast<LocalGet>();
+        // Optional expressions (nullptr is the least)
+        Compare3Fields& operator()(const wasm::Expression* a, const wasm::Expression* b) {
+            push({Compare3Task::Kind::optional_expression, 0, 0, a, b});
+            return *this;
+        }
 
-                return x.index < y.index;
-            }
-            case Expression::Id::LocalSetId: {
-                const auto& x = *a.cast<LocalSet>();
-                const auto& y = *b.cast<LocalSet>();
+        Compare3Fields& operator()(const wasm::ExpressionList& a, const wasm::ExpressionList& b) {
+            result(compare3_values(a.size(), b.size()));
 
-                return std::tie(x.index, *x.value) < std::tie(y.index, *y.value);
+            for (std::size_t i = 0; i < a.size() && !decided_; i++) {
+                (*this)(*a[i], *b[i]);
             }
-            case Expression::Id::GlobalGetId: {
-                const auto& x = *a.cast<GlobalGet>();
-                const auto& y = *b.cast<GlobalGet>();
+            return *this;
+        }
 
-                return x.name < y.name;
-            }
-            case Expression::Id::GlobalSetId: {
-                const auto& x = *a.cast<GlobalSet>();
-                const auto& y = *b.cast<GlobalSet>();
+        Compare3Fields& operator()(const wasm::Literal& a, const wasm::Literal& b) {
+            result(wasm::compare3(a, b));
+            return *this;
+        }
 
-                return std::tie(*x.value, x.name) < std::tie(*y.value, y.name);
-            }
-            case Expression::Id::LoadId: {
-                const auto& x = *a.cast<Load>();
-                const auto& y = *b.cast<Load>();
+        // Other values ordered by `operator<`
+        template <typename T, typename = std::enable_if_t<!std::is_pointer_v<T>>>
+        Compare3Fields& operator()(const T& a, const T& b) {
+            result(compare3_values(a, b));
+            return *this;
+        }
 
-                return *x.ptr < *y.ptr;
+    private:
+        void push(const Compare3Task& task) {
+            // Fields after a differing scalar never affect the result
+            if (!decided_) {
+                tasks_.push_back(task);
             }
-            case Expression::Id::StoreId: {
-                const auto& x = *a.cast<Store>();
-                const auto& y = *b.cast<Store>();
+        }
 
-                return std::tie(*x.ptr, *x.value) < std::tie(*y.ptr, *y.value);
+        void result(int c) {
+            if (c != 0) {
+                push({Compare3Task::Kind::result, static_cast<std::int8_t>(c), 0, nullptr, nullptr});
+                decided_ = true;
             }
-            case Expression::Id::ConstId: {
-                const auto& x = *a.cast<Const>();
-                const auto& y = *b.cast<Const>();
+        }
 
-                return x.value < y.value;
-            }
-            case Expression::Id::UnaryId: {
-                const auto& x = *a.cast<Unary>();
-                const auto& y = *b.cast<Unary>();
+        std::vector<Compare3Task>& tasks_;
+        std::size_t begin_;
+        bool decided_;
+    };
+
+    // Three-way comparison of expression trees with an explicit stack, so that deep trees do not overflow the call stack.
+    class Compare3Engine {
+    public:
+        // Tasks of the comparison to run; schedule them with `Compare3Fields`
+        std::vector<Compare3Task>& start() noexcept {
+            tasks_.clear();
+            return tasks_;
+        }
 
-                return std::tie(x.op, *x.value) < std::tie(y.op, *y.value);
-            }
-            case Expression::Id::BinaryId: {
-                const auto& x = *a.cast<Binary>();
-                const auto& y = *b.cast<Binary>();
-
-                constexpr auto normalize = [](const wasm::Binary& node)
-                    -> std::tuple<wasm::BinaryOp, wasm::Expression&, wasm::Expression&> {
-                    if (!kyut::is_commutative(node.op)) {
-                        // Non-commutative binary expr
-                        return {node.op, *node.left, *node.right};
-                    }
+        int run() {
+            while (!tasks_.empty()) {
+                const auto task = tasks_.back();
+                tasks_.pop_back();
+
+                int c = 0;
+
+                switch (task.kind) {
+                    case Compare3Task::Kind::result:
+                        c = task.result;
+                        break;
+                    case Compare3Task::Kind::optional_expression:
+                        if (task.a == nullptr || task.b == nullptr) {
+                            c = (task.a != nullptr ? 1 : 0) - (task.b != nullptr ? 1 : 0);
+                            break;
+                        }
+                        c = expand(*task.a, *task.b);
+                        break;
+                    case Compare3Task::Kind::expression:
+                        c = expand(*task.a, *task.b);
+                        break;
+                    case Compare3Task::Kind::normalize:
+                        normalize(task, 0);
+                        continue;
+                }
+
+                if (c == 0) {
+                    continue;
+                }
+
+                // The rest of the current comparison is decided; return to the innermost pending normalization
+                while (!tasks_.empty() && tasks_.back().kind != Compare3Task::Kind::normalize) {
+                    tasks_.pop_back();
+                }
+
+                if (tasks_.empty()) {
+                    return c;
+                }
+
+                const auto pending = tasks_.back();
+                tasks_.pop_back();
+
+                normalize(pending, c);
+            }
+
+            return 0;
+        }
 
-                    // Commutative binary expr
-                    if (*node.left < *node.right) {
-                        return {node.op, *node.left, *node.right};
-                    } else {
-                        return {*kyut::swapped_binary_op(node.op), *node.right, *node.left};
+    private:
+        // Compares the node-local fields of `a` and `b`, and schedules their operands
+        int expand(const wasm::Expression& a, const wasm::Expression& b) {
+            static_assert(wasm::Expression::NumExpressionIds == 49);
+
+            if (&a == &b) {
+                return 0;
+            }
+
+            if (const auto c = compare3_values(a._id, b._id); c != 0) {
+                return c;
+            }
+
+            if (const auto c = compare3_values(a.type, b.type); c != 0) {
+                return c;
+            }
+
+            switch (a._id) {
+                case wasm::Expression::Id::BlockId: {
+                    const auto& x = *a.cast<wasm::Block>();
+                    const auto& y = *b.cast<wasm::Block>();
+
+                    Compare3Fields{tasks_}(x.list, y.list);
+                    return 0;
+                }
+                case wasm::Expression::Id::IfId: {
+                    const auto& x = *a.cast<wasm::If>();
+                    const auto& y = *b.cast<wasm::If>();
+
+                    Compare3Fields{tasks_}(*x.condition, *y.condition)(*x.ifTrue, *y.ifTrue)(x.ifFalse, y.ifFalse);
+                    return 0;
+                }
+                case wasm::Expression::Id::LoopId: {
+                    const auto& x = *a.cast<wasm::Loop>();
+                    const auto& y = *b.cast<wasm::Loop>();
+
+                    Compare3Fields{tasks_}(*x.body, *y.body);
+                    return 0;
+                }
+                case wasm::Expression::Id::BreakId: {
+                    const auto& x = *a.cast<wasm::Break>();
+                    const auto& y = *b.cast<wasm::Break>();
+
+                    Compare3Fields{tasks_}(x.value, y.value)(x.condition, y.condition);
+                    return 0;
+                }
+                case wasm::Expression::Id::SwitchId: {
+                    const auto& x = *a.cast<wasm::Switch>();
+                    const auto& y = *b.cast<wasm::Switch>();
+
+                    Compare3Fields{tasks_}(x.value, y.value)(x.condition, y.condition);
+                    return 0;
+                }
+                case wasm::Expression::Id::CallId: {
+                    const auto& x = *a.cast<wasm::Call>();
+                    const auto& y = *b.cast<wasm::Call>();
+
+                    Compare3Fields{tasks_}(x.operands, y.operands);
+                    return 0;
+                }
+                case wasm::Expression::Id::CallIndirectId: {
+                    const auto& x = *a.cast<wasm::CallIndirect>();
+                    const auto& y = *b.cast<wasm::CallIndirect>();
+
+                    Compare3Fields{tasks_}(x.operands, y.operands)(*x.target, *y.target);
+                    return 0;
+                }
+                case wasm::Expression::Id::LocalGetId: {
+                    const auto& x = *a.cast<wasm::LocalGet>();
+                    const auto& y = *b.cast<wasm::LocalGet>();
+
+                    Compare3Fields{tasks_}(x.index, y.index);
+                    return 0;
+                }
+                case wasm::Expression::Id::LocalSetId: {
+                    const auto& x = *a.cast<wasm::LocalSet>();
+                    const auto& y = *b.cast<wasm::LocalSet>();
+
+                    Compare3Fields{tasks_}(x.index, y.index)(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::GlobalGetId: {
+                    const auto& x = *a.cast<wasm::GlobalGet>();
+                    const auto& y = *b.cast<wasm::GlobalGet>();
+
+                    Compare3Fields{tasks_}(x.name, y.name);
+                    return 0;
+                }
+                case wasm::Expression::Id::GlobalSetId: {
+                    const auto& x = *a.cast<wasm::GlobalSet>();
+                    const auto& y = *b.cast<wasm::GlobalSet>();
+
+                    Compare3Fields{tasks_}(*x.value, *y.value)(x.name, y.name);
+                    return 0;
+                }
+                case wasm::Expression::Id::LoadId: {
+                    const auto& x = *a.cast<wasm::Load>();
+                    const auto& y = *b.cast<wasm::Load>();
+
+                    Compare3Fields{tasks_}(*x.ptr, *y.ptr);
+                    return 0;
+                }
+                case wasm::Expression::Id::StoreId: {
+                    const auto& x = *a.cast<wasm::Store>();
+                    const auto& y = *b.cast<wasm::Store>();
+
+                    Compare3Fields{tasks_}(*x.ptr, *y.ptr)(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::ConstId: {
+                    const auto& x = *a.cast<wasm::Const>();
+                    const auto& y = *b.cast<wasm::Const>();
+
+                    Compare3Fields{tasks_}(x.value, y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::UnaryId: {
+                    const auto& x = *a.cast<wasm::Unary>();
+                    const auto& y = *b.cast<wasm::Unary>();
+
+                    Compare3Fields{tasks_}(x.op, y.op)(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::BinaryId: {
+                    const auto& x = *a.cast<wasm::Binary>();
+                    const auto& y = *b.cast<wasm::Binary>();
+
+                    // Operands of commutative nodes are ordered before comparing them
+                    tasks_.push_back({Compare3Task::Kind::normalize, 0, 0, &x, &y});
+                    if (kyut::is_commutative(x.op)) {
+                        tasks_.push_back({Compare3Task::Kind::expression, 0, 0, x.left, x.right});
                     }
-                };
-
-                return normalize(x) < normalize(y);
-            }
-            case Expression::Id::SelectId: {
-                const auto& x = *a.cast<Select>();
-                const auto& y = *b.cast<Select>();
-
-                return std::tie(*x.ifTrue, *x.ifFalse, *x.condition) < std::tie(*y.ifTrue, *y.ifFalse, *y.condition);
-            }
-            case Expression::Id::DropId: {
-                const auto& x = *a.cast<Drop>();
-                const auto& y = *b.cast<Drop>();
-
-                return *x.value < *y.value;
-            }
-            case Expression::Id::ReturnId: {
-                const auto& x = *a.cast<Return>();
-                const auto& y = *b.cast<Return>();
-
-                return opt(x.value) < opt(y.value);
-            }
-            case Expression::Id::MemorySizeId: {
-                [[maybe_unused]] const auto& x = *a.cast<MemorySize>();
-                [[maybe_unused]] const auto& y = *b.cast<MemorySize>();
-
-                return false;
-            }
-            case Expression::Id::MemoryGrowId: {
-                const auto& x = *a.cast<MemoryGrow>();
-                const auto& y = *b.cast<MemoryGrow>();
-
-                return opt(x.delta) < opt(y.delta);
-            }
-            case Expression::Id::NopId: {
-                [[maybe_unused]] const auto& x = *a.cast<Nop>();
-                [[maybe_unused]] const auto& y = *b.cast<Nop>();
-
-                return false;
-            }
-            case Expression::Id::UnreachableId: {
-                [[maybe_unused]] const auto& x = *a.cast<Unreachable>();
-                [[maybe_unused]] const auto& y = *b.cast<Unreachable>();
-
-                return false;
-            }
-            case Expression::Id::AtomicRMWId: {
-                const auto& x = *a.cast<AtomicRMW>();
-                const auto& y = *b.cast<AtomicRMW>();
-
-                return std::tie(x.op, x.bytes, x.offset, *x.ptr, *x.value) <
-                       std::tie(y.op, y.bytes, y.offset, *y.ptr, *y.value);
-            }
-            case Expression::Id::AtomicCmpxchgId: {
-                const auto& x = *a.cast<AtomicCmpxchg>();
-                const auto& y = *b.cast<AtomicCmpxchg>();
-
-                return std::tie(x.bytes, x.offset, *x.ptr, *x.expected, *x.replacement) <
-                       std::tie(y.bytes, y.offset, *y.ptr, *y.expected, *y.replacement);
+                    return 0;
+                }
+                case wasm::Expression::Id::SelectId: {
+                    const auto& x = *a.cast<wasm::Select>();
+                    const auto& y = *b.cast<wasm::Select>();
+
+                    Compare3Fields{tasks_}(*x.ifTrue, *y.ifTrue)(*x.ifFalse, *y.ifFalse)(*x.condition, *y.condition);
+                    return 0;
+                }
+                case wasm::Expression::Id::DropId: {
+                    const auto& x = *a.cast<wasm::Drop>();
+                    const auto& y = *b.cast<wasm::Drop>();
+
+                    Compare3Fields{tasks_}(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::ReturnId: {
+                    const auto& x = *a.cast<wasm::Return>();
+                    const auto& y = *b.cast<wasm::Return>();
+
+                    Compare3Fields{tasks_}(x.value, y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::MemorySizeId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::MemoryGrowId: {
+                    const auto& x = *a.cast<wasm::MemoryGrow>();
+                    const auto& y = *b.cast<wasm::MemoryGrow>();
+
+                    Compare3Fields{tasks_}(x.delta, y.delta);
+                    return 0;
+                }
+                case wasm::Expression::Id::NopId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::UnreachableId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::AtomicRMWId: {
+                    const auto& x = *a.cast<wasm::AtomicRMW>();
+                    const auto& y = *b.cast<wasm::AtomicRMW>();
+
+                    Compare3Fields{tasks_}(x.op, y.op)(x.bytes, y.bytes)(x.offset, y.offset)(*x.ptr, *y.ptr)(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::AtomicCmpxchgId: {
+                    const auto& x = *a.cast<wasm::AtomicCmpxchg>();
+                    const auto& y = *b.cast<wasm::AtomicCmpxchg>();
+
+                    Compare3Fields{tasks_}(x.bytes, y.bytes)(x.offset, y.offset)(*x.ptr, *y.ptr)(*x.expected, *y.expected)(*x.replacement, *y.replacement);
+                    return 0;
+                }
+                case wasm::Expression::Id::AtomicWaitId: {
+                    const auto& x = *a.cast<wasm::AtomicWait>();
+                    const auto& y = *b.cast<wasm::AtomicWait>();
+
+                    Compare3Fields{tasks_}(x.offset, y.offset)(*x.ptr, *y.ptr)(*x.expected, *y.expected)(*x.timeout, *y.timeout)(x.expectedType, y.expectedType);
+                    return 0;
+                }
+                case wasm::Expression::Id::AtomicNotifyId: {
+                    const auto& x = *a.cast<wasm::AtomicNotify>();
+                    const auto& y = *b.cast<wasm::AtomicNotify>();
+
+                    Compare3Fields{tasks_}(x.offset, y.offset)(*x.ptr, *y.ptr)(*x.notifyCount, *y.notifyCount);
+                    return 0;
+                }
+                case wasm::Expression::Id::AtomicFenceId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::SIMDExtractId: {
+                    const auto& x = *a.cast<wasm::SIMDExtract>();
+                    const auto& y = *b.cast<wasm::SIMDExtract>();
+
+                    Compare3Fields{tasks_}(x.op, y.op)(*x.vec, *y.vec)(x.index, y.index);
+                    return 0;
+                }
+                case wasm::Expression::Id::SIMDReplaceId: {
+                    const auto& x = *a.cast<wasm::SIMDReplace>();
+                    const auto& y = *b.cast<wasm::SIMDReplace>();
+
+                    Compare3Fields{tasks_}(x.op, y.op)(*x.vec, *y.vec)(x.index, y.index)(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::SIMDShuffleId: {
+                    const auto& x = *a.cast<wasm::SIMDShuffle>();
+                    const auto& y = *b.cast<wasm::SIMDShuffle>();
+
+                    Compare3Fields{tasks_}(*x.left, *y.left)(*x.right, *y.right)(x.mask, y.mask);
+                    return 0;
+                }
+                case wasm::Expression::Id::SIMDTernaryId: {
+                    const auto& x = *a.cast<wasm::SIMDTernary>();
+                    const auto& y = *b.cast<wasm::SIMDTernary>();
+
+                    Compare3Fields{tasks_}(*x.a, *y.a)(*x.b, *y.b)(*x.c, *y.c);
+                    return 0;
+                }
+                case wasm::Expression::Id::SIMDShiftId: {
+                    const auto& x = *a.cast<wasm::SIMDShift>();
+                    const auto& y = *b.cast<wasm::SIMDShift>();
+
+                    Compare3Fields{tasks_}(x.op, y.op)(*x.vec, *y.vec)(*x.shift, *y.shift);
+                    return 0;
+                }
+                case wasm::Expression::Id::SIMDLoadId: {
+                    const auto& x = *a.cast<wasm::SIMDLoad>();
+                    const auto& y = *b.cast<wasm::SIMDLoad>();
+
+                    Compare3Fields{tasks_}(x.op, y.op)(x.offset, y.offset)(x.align, y.align)(*x.ptr, *y.ptr);
+                    return 0;
+                }
+                case wasm::Expression::Id::MemoryInitId: {
+                    const auto& x = *a.cast<wasm::MemoryInit>();
+                    const auto& y = *b.cast<wasm::MemoryInit>();
+
+                    Compare3Fields{tasks_}(x.segment, y.segment)(*x.dest, *y.dest)(*x.offset, *y.offset)(*x.size, *y.size);
+                    return 0;
+                }
+                case wasm::Expression::Id::DataDropId: {
+                    const auto& x = *a.cast<wasm::DataDrop>();
+                    const auto& y = *b.cast<wasm::DataDrop>();
+
+                    Compare3Fields{tasks_}(x.segment, y.segment);
+                    return 0;
+                }
+                case wasm::Expression::Id::MemoryCopyId: {
+                    const auto& x = *a.cast<wasm::MemoryCopy>();
+                    const auto& y = *b.cast<wasm::MemoryCopy>();
+
+                    Compare3Fields{tasks_}(*x.dest, *y.dest)(*x.source, *y.source)(*x.size, *y.size);
+                    return 0;
+                }
+                case wasm::Expression::Id::MemoryFillId: {
+                    const auto& x = *a.cast<wasm::MemoryFill>();
+                    const auto& y = *b.cast<wasm::MemoryFill>();
+
+                    Compare3Fields{tasks_}(*x.dest, *y.dest)(*x.value, *y.value)(*x.size, *y.size);
+                    return 0;
+                }
+                case wasm::Expression::Id::PopId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::RefNullId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::RefIsNullId: {
+                    const auto& x = *a.cast<wasm::RefIsNull>();
+                    const auto& y = *b.cast<wasm::RefIsNull>();
+
+                    Compare3Fields{tasks_}(*x.value, *y.value);
+                    return 0;
+                }
+                case wasm::Expression::Id::RefFuncId: {
+                    return 0;
+                }
+                case wasm::Expression::Id::TryId: {
+                    const auto& x = *a.cast<wasm::Try>();
+                    const auto& y = *b.cast<wasm::Try>();
+
+                    Compare3Fields{tasks_}(x.body, y.body)(x.catchBody, y.catchBody);
+                    return 0;
+                }
+                case wasm::Expression::Id::ThrowId: {
+                    const auto& x = *a.cast<wasm::Throw>();
+                    const auto& y = *b.cast<wasm::Throw>();
+
+                    Compare3Fields{tasks_}(x.operands, y.operands);
+                    return 0;
+                }
+                case wasm::Expression::Id::RethrowId: {
+                    const auto& x = *a.cast<wasm::Rethrow>();
+                    const auto& y = *b.cast<wasm::Rethrow>();
+
+                    Compare3Fields{tasks_}(x.exnref, y.exnref);
+                    return 0;
+                }
+                case wasm::Expression::Id::BrOnExnId: {
+                    const auto& x = *a.cast<wasm::BrOnExn>();
+                    const auto& y = *b.cast<wasm::BrOnExn>();
+
+                    Compare3Fields{tasks_}(x.exnref, y.exnref);
+                    return 0;
+                }
+                case wasm::Expression::Id::TupleMakeId: {
+                    const auto& x = *a.cast<wasm::TupleMake>();
+                    const auto& y = *b.cast<wasm::TupleMake>();
+
+                    Compare3Fields{tasks_}(x.operands, y.operands);
+                    return 0;
+                }
+                case wasm::Expression::Id::TupleExtractId: {
+                    const auto& x = *a.cast<wasm::TupleExtract>();
+                    const auto& y = *b.cast<wasm::TupleExtract>();
+
+                    Compare3Fields{tasks_}(*x.tuple, *y.tuple)(x.index, y.index);
+                    return 0;
+                }
+
+                default: {
+                    WASM_UNREACHABLE("unknown expression id");
+                }
             }
-            case Expression::Id::AtomicWaitId: {
-                const auto& x = *a.cast<AtomicWait>();
-                const auto& y = *b.cast<AtomicWait>();
-
-                return std::tie(x.offset, *x.ptr, *x.expected, *x.timeout, x.expectedType) <
-                       std::tie(y.offset, *y.ptr, *y.expected, *y.timeout, y.expectedType);
-            }
-            case Expression::Id::AtomicNotifyId: {
-                const auto& x = *a.cast<AtomicNotify>();
-                const auto& y = *b.cast<AtomicNotify>();
-
-                return std::tie(x.offset, *x.ptr, *x.notifyCount) < std::tie(y.offset, *y.ptr, *y.notifyCount);
-            }
-            case Expression::Id::AtomicFenceId: {
-                [[maybe_unused]] const auto& x = *a.cast<AtomicFence>();
-                [[maybe_unused]] const auto& y = *b.cast<AtomicFence>();
-
-                return false;
-            }
-            case Expression::Id::SIMDExtractId: {
-                const auto& x = *a.cast<SIMDExtract>();
-                const auto& y = *b.cast<SIMDExtract>();
-
-                return std::tie(x.op, *x.vec, x.index) < std::tie(y.op, *y.vec, y.index);
-            }
-            case Expression::Id::SIMDReplaceId: {
-                const auto& x = *a.cast<SIMDReplace>();
-                const auto& y = *b.cast<SIMDReplace>();
+        }
 
-                return std::tie(x.op, *x.vec, x.index, *x.value) < std::tie(y.op, *y.vec, y.index, *y.value);
-            }
-            case Expression::Id::SIMDShuffleId: {
-                const auto& x = *a.cast<SIMDShuffle>();
-                const auto& y = *b.cast<SIMDShuffle>();
+        // Continues the normalization of binary nodes after ordering the operands of one of them
+        void normalize(const Compare3Task& task, int order) {
+            const auto& x = *task.a->cast<wasm::Binary>();
+            const auto& y = *task.b->cast<wasm::Binary>();
 
-                return std::tie(*x.left, *x.right, x.mask) < std::tie(*y.left, *y.right, y.mask);
+            if (task.stage == 0) {
+                tasks_.push_back({Compare3Task::Kind::normalize, static_cast<std::int8_t>(order), 1, &x, &y});
+                if (is_commutative(y.op)) {
+                    tasks_.push_back({Compare3Task::Kind::expression, 0, 0, y.left, y.right});
+                }
+                return;
             }
-            case Expression::Id::SIMDTernaryId: {
-                const auto& x = *a.cast<SIMDTernary>();
-                const auto& y = *b.cast<SIMDTernary>();
 
-                return std::tie(*x.a, *x.b, *x.c) < std::tie(*y.a, *y.b, *y.c);
-            }
-            case Expression::Id::SIMDShiftId: {
-                const auto& x = *a.cast<SIMDShift>();
-                const auto& y = *b.cast<SIMDShift>();
+            const auto normalized = [](const wasm::Binary& node, int c)
+                -> std::tuple<wasm::BinaryOp, const wasm::Expression&, const wasm::Expression&> {
+                if (!is_commutative(node.op) || c < 0) {
+                    return {node.op, *node.left, *node.right};
+                } else {
+                    return {swapped_binary_op_unchecked(node.op), *node.right, *node.left};
+                }
+            };
 
-                return std::tie(x.op, *x.vec, *x.shift) < std::tie(y.op, *y.vec, *y.shift);
-            }
-            case Expression::Id::SIMDLoadId: {
-                const auto& x = *a.cast<SIMDLoad>();
-                const auto& y = *b.cast<SIMDLoad>();
+            const auto [x_op, x_lo, x_hi] = normalized(x, task.result);
+            const auto [y_op, y_lo, y_hi] = normalized(y, order);
 
-                return std::tie(x.op, x.offset, x.align, *x.ptr) < std::tie(y.op, y.offset, y.align, *y.ptr);
-            }
-            case Expression::Id::MemoryInitId: {
-                const auto& x = *a.cast<MemoryInit>();
-                const auto& y = *b.cast<MemoryInit>();
+            Compare3Fields{tasks_}(x_op, y_op)(x_lo, y_lo)(x_hi, y_hi);
+        }
 
-                return std::tie(x.segment, *x.dest, *x.offset, *x.size) < std::tie(y.segment, *y.dest, *y.offset, *y.size);
-            }
-            case Expression::Id::DataDropId: {
-                const auto& x = *a.cast<DataDrop>();
-                const auto& y = *b.cast<DataDrop>();
+        std::vector<Compare3Task> tasks_;
+    };
 
-                return x.segment < y.segment;
-            }
-            case Expression::Id::MemoryCopyId: {
-                const auto& x = *a.cast<MemoryCopy>();
-                const auto& y = *b.cast<MemoryCopy>();
+    // Reuses the allocation of the stack across comparisons
+    inline Compare3Engine& compare3_engine() {
+        thread_local Compare3Engine engine{};
+        return engine;
+    }
+} // namespace kyut::detail
 
-                return std::tie(*x.dest, *x.source, *x.size) < std::tie(*y.dest, *y.source, *y.size);
-            }
-            case Expression::Id::MemoryFillId: {
-                const auto& x = *a.cast<MemoryFill>();
-                const auto& y = *b.cast<MemoryFill>();
+namespace wasm {
+    inline int compare3(const Literal& a, const Literal& b) {
+        const std::less<Literal> less{};
+        return less(a, b) ? -1 : less(b, a) ? 1 : 0;
+    }
 
-                return std::tie(*x.dest, *x.value, *x.size) < std::tie(*y.dest, *y.value, *y.size);
-            }
-            case Expression::Id::PopId: {
-                [[maybe_unused]] const auto& x = *a.cast<Pop>();
-                [[maybe_unused]] const auto& y = *b.cast<Pop>();
+    inline int compare3(const Expression& a, const Expression& b) {
+        auto& engine = kyut::detail::compare3_engine();
+        kyut::detail::Compare3Fields{engine.start()}(a, b);
 
-                return false;
-            }
-            case Expression::Id::RefNullId: {
-                [[maybe_unused]] const auto& x = *a.cast<RefNull>();
-                [[maybe_unused]] const auto& y = *b.cast<RefNull>();
+        return engine.run();
+    }
 
-                return false;
-            }
-            case Expression::Id::RefIsNullId: {
-                const auto& x = *a.cast<RefIsNull>();
-                const auto& y = *b.cast<RefIsNull>();
+    inline int compare3(const ExpressionList& a, const ExpressionList& b) {
+        if (&a == &b) {
+            return 0;
+        }
 
-                return *x.value < *y.value;
-            }
-            case Expression::Id::RefFuncId: {
-                [[maybe_unused]] const auto& x = *a.cast<RefFunc>();
-                [[maybe_unused]] const auto& y = *b.cast<RefFunc>();
+        auto& engine = kyut::detail::compare3_engine();
+        kyut::detail::Compare3Fields{engine.start()}(a, b);
 
-                return false;
-            }
-            case Expression::Id::TryId: {
-                const auto& x = *a.cast<Try>();
-                const auto& y = *b.cast<Try>();
-
-                return std::forward_as_tuple(opt(x.body), opt(x.catchBody)) < std::forward_as_tuple(opt(y.body), opt(y.catchBody));
-            }
-            case Expression::Id::ThrowId: {
-                const auto& x = *a.cast<Throw>();
-                const auto& y = *b.cast<Throw>();
+        return engine.run();
+    }
 
-                return x.operands < y.operands;
-            }
-            case Expression::Id::RethrowId: {
-                const auto& x = *a.cast<Rethrow>();
-                const auto& y = *b.cast<Rethrow>();
+    inline int compare3(const Function& a, const Function& b) {
+        if (&a == &b) {
+            return 0;
+        }
 
-                return std::forward_as_tuple(opt(x.exnref)) < std::forward_as_tuple(opt(y.exnref));
-            }
-            case Expression::Id::BrOnExnId: {
-                const auto& x = *a.cast<BrOnExn>();
-                const auto& y = *b.cast<BrOnExn>();
+        // wasm::Function::getNumVars() does not modify states
+        auto& engine = kyut::detail::compare3_engine();
+        kyut::detail::Compare3Fields{engine.start()}(a.sig, b.sig)(const_cast<Function&>(a).getNumVars(), const_cast<Function&>(b).getNumVars())(*a.body, *b.body);
 
-                return std::forward_as_tuple(opt(x.exnref)) < std::forward_as_tuple(opt(y.exnref));
-            }
-            case Expression::Id::TupleMakeId: {
-                const auto& x = *a.cast<TupleMake>();
-                const auto& y = *b.cast<TupleMake>();
+        return engine.run();
+    }
 
-                return x.operands < y.operands;
-            }
-            case Expression::Id::TupleExtractId: {
-                const auto& x = *a.cast<TupleExtract>();
-                const auto& y = *b.cast<TupleExtract>();
+    inline bool operator<(const Literal& a, const Literal& b) {
+        return std::less<Literal>{}(a, b);
+    }
 
-                return std::tie(*x.tuple, x.index) < std::tie(*y.tuple, y.index);
-            }
-            default: {
-                WASM_UNREACHABLE("unknown expression id");
-            }
-        }
+    inline bool operator<(const Expression& a, const Expression& b) {
+        return compare3(a, b) < 0;
     }
 
     inline bool operator<(const ExpressionList& a, const ExpressionList& b) {
-        if (&a == &b) {
-            return false;
-        }
-
-        if (a.size() != b.size()) {
-            return a.size() < b.size();
-        }
-
-        return std::lexicographical_compare(
-            std::begin(a),
-            std::end(a),
-            std::begin(b),
-            std::end(b),
-            [](const Expression* a, const Expression* b) {
-                return *a < *b;
-            });
+        return compare3(a, b) < 0;
     }
 
     inline bool operator<(const Function& a, const Function& b) {
-        if (&a == &b) {
-            return false;
-        }
-
-        // wasm::Function::getNumVars() does not modify states
-        return std::forward_as_tuple(a.sig, const_cast<Function&>(a).getNumVars(), *a.body) <
-               std::forward_as_tuple(b.sig, const_cast<Function&>(b).getNumVars(), *b.body);
+        return compare3(a, b) < 0;
     }
 } // namespace wasm
 
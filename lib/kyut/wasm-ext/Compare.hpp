@@ -4,6 +4,12 @@
 #include "wasm.h"
 
 namespace wasm {
+    // Three-way comparison: negative if a < b, zero if equivalent, positive if a > b
+    int compare3(const Literal& a, const Literal& b);
+    int compare3(const Expression& a, const Expression& b);
+    int compare3(const ExpressionList& a, const ExpressionList& b);
+    int compare3(const Function& a, const Function& b);
+
     bool operator<(const Literal& a, const Literal& b);
     bool operator<(const Expression& a, const Expression& b);
     bool operator<(const ExpressionList& a, const ExpressionList& b);
@@ -0,0 +1,824 @@
+#include "FlatFunction.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <unordered_map>
+#include "../Commutativity.hpp"
+#include "Compare.hpp"
+#include "Traversal.hpp"
+
+namespace kyut {
+    namespace {
+        // Labels of equivalence classes are in [0, 2^label_bits)
+        constexpr int label_bits = 62;
+
+        void mix(std::uint64_t& hash, std::uint64_t x) noexcept {
+            x *= 0x9E3779B97F4A7C15;
+            x ^= x >> 32;
+            hash ^= x + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+        }
+
+        std::uint64_t hash_literal(const wasm::Literal& value) noexcept {
+            switch (value.type.getID()) {
+                case wasm::Type::i32:
+                    return static_cast<std::uint64_t>(value.geti32());
+                case wasm::Type::i64:
+                    return static_cast<std::uint64_t>(value.geti64());
+                case wasm::Type::f32:
+                    return static_cast<std::uint64_t>(value.reinterpreti32());
+                case wasm::Type::f64:
+                    return static_cast<std::uint64_t>(value.reinterpreti64());
+                default:
+                    return value.type.getID();
+            }
+        }
+
+        // Whether the operands of `node` are laid out last first.
+        // The canonical bit order is that of the released binaries, which are built with GCC. Their recursive visitor
+        // evaluated the arguments of `(std::max)(visit(left), visit(right))` right to left, so it visited the last
+        // operand first. Watermarks keep that order whatever compiler builds this.
+        // The operands of a commutative binary expression are in the order of (lo, hi) when they differ.
+        bool reversed_operands(const FlatFunction::Node& node) noexcept {
+            switch (node.id) {
+                case wasm::Expression::Id::BinaryId:
+                    return node.order >= 0;
+
+                case wasm::Expression::Id::SIMDReplaceId:
+                case wasm::Expression::Id::SIMDShuffleId:
+                case wasm::Expression::Id::SIMDShiftId:
+                    return true;
+
+                default:
+                    return false;
+            }
+        }
+
+        // Labels `*it`, just inserted into `order`, between the labels of its neighbors
+        template <typename Set>
+        void assign_label(const Set& order, typename Set::const_iterator it, std::vector<std::uint64_t>& labels) {
+            const auto next = std::next(it);
+
+            // Take the middle of the gap between the neighbors if any
+            const auto lo = it == std::begin(order) ? std::uint64_t{0} : labels[*std::prev(it)] + 1;
+            const auto hi = next == std::end(order) ? std::uint64_t{1} << label_bits : labels[*next];
+
+            if (lo < hi) {
+                labels[*it] = lo + (hi - lo) / 2;
+                return;
+            }
+
+            // Otherwise spread the labels evenly over the smallest aligned range around `it` that is sparse enough.
+            // The density threshold shrinks as the range grows, which makes insertions O(log n) amortized.
+            const auto anchor = it == std::begin(order) ? labels[*next] : labels[*std::prev(it)];
+            double threshold = 1;
+
+            for (int bits = 1; bits <= label_bits; bits++) {
+                const auto width = std::uint64_t{1} << bits;
+                const auto base = anchor & ~(width - 1);
+                threshold *= 1.6;
+
+                auto first = it;
+                while (first != std::begin(order) && labels[*std::prev(first)] >= base) {
+                    --first;
+                }
+
+                auto last = std::next(it);
+                while (last != std::end(order) && labels[*last] - base < width) {
+                    ++last;
+                }
+
+                const auto count = static_cast<std::uint64_t>(std::distance(first, last));
+
+                if (count < width && (bits == label_bits || static_cast<double>(count) <= threshold)) {
+                    const auto step = width / count;
+
+                    auto label = base;
+                    for (auto p = first; p != last; ++p, label += step) {
+                        labels[*p] = label;
+                    }
+
+                    return;
+                }
+            }
+        }
+    } // namespace
+
+    // Builds the nodes bottom-up in visiting order, and finds equal subtrees by hash-consing their fields.
+    // Subtrees are ranked in the order of `wasm::compare3` only when the operands of a commutative binary expression
+    // differ in some operand of theirs, so most decisions never touch the ranking.
+    class FlatFunction::Builder {
+    public:
+        explicit Builder(FlatFunction& f)
+            : f_(f)
+            , nodes_()
+            , fields_()
+            , first_field_{0}
+            , class_of_()
+            , representatives_()
+            , labels_()
+            , ranked_()
+            , classes_()
+            , order_(ClassLess{this})
+            , operands_() {
+        }
+
+        // Adds a node whose operands are the last added subtrees since `begin`
+        void add(wasm::Expression& expr, std::uint32_t begin, bool opaque) {
+            const auto index = static_cast<std::uint32_t>(nodes_.size());
+
+            // Operands in visiting order
+            operands_.clear();
+            for (auto end = index; end > begin; end -= nodes_[end - 1].size) {
+                operands_.push_back(end - 1);
+            }
+            std::reverse(std::begin(operands_), std::end(operands_));
+
+            std::int8_t order = 0;
+
+            if (const auto binary = expr.dynCast<wasm::Binary>(); binary != nullptr && is_commutative(binary->op)) {
+                order = static_cast<std::int8_t>(compare3_subtrees(operands_[0], operands_[1]));
+            }
+
+            nodes_.push_back({&expr, index - begin + 1, static_cast<std::uint32_t>(operands_.size()), expr._id, order, opaque});
+
+            // Operands in the order of comparison
+            if (expr.is<wasm::Switch>() && operands_.size() == 2) {
+                std::swap(operands_[0], operands_[1]);
+            } else if (expr.is<wasm::CallIndirect>()) {
+                std::rotate(std::begin(operands_), std::begin(operands_) + 1, std::end(operands_));
+            } else if (order > 0) {
+                std::swap(operands_[0], operands_[1]);
+            }
+
+            f_.encode(expr, order, operands_, fields_);
+            first_field_.push_back(static_cast<std::uint32_t>(fields_.size()));
+
+            class_of_.push_back(find_class(index));
+        }
+
+        // Expands the fields of the root in pre-order
+        void encode() const {
+            std::vector<Key> pending{};
+            pending.push_back({Key::Kind::child, nodes_.size() - 1});
+
+            while (!pending.empty()) {
+                const auto key = pending.back();
+                pending.pop_back();
+
+                if (key.kind != Key::Kind::child) {
+                    f_.keys_.push_back(key);
+                    continue;
+                }
+
+                // The first field is on the top
+                const auto [first, last] = fields(static_cast<std::uint32_t>(key.value));
+                pending.insert(std::end(pending), std::make_reverse_iterator(last), std::make_reverse_iterator(first));
+            }
+        }
+
+        // Lays out the nodes again, in the order of operand swapping
+        void lay_out() const {
+            struct Visit {
+                std::uint32_t node;
+                bool expanded;
+            };
+
+            std::vector<Visit> stack{};
+            stack.push_back({static_cast<std::uint32_t>(nodes_.size() - 1), false});
+
+            f_.nodes_.reserve(nodes_.size());
+
+            while (!stack.empty()) {
+                const auto v = stack.back();
+                stack.pop_back();
+
+                const auto& node = nodes_[v.node];
+
+                if (v.expanded) {
+                    f_.nodes_.push_back(node);
+                    continue;
+                }
+
+                stack.push_back({v.node, true});
+
+                // The first operand in visiting order is on the top, unless the operands are reversed
+                const auto mark = stack.size();
+                for (auto end = v.node; end > v.node + 1 - node.size; end -= nodes_[end - 1].size) {
+                    stack.push_back({end - 1, false});
+                }
+
+                if (reversed_operands(node)) {
+                    std::reverse(std::begin(stack) + mark, std::end(stack));
+                }
+            }
+        }
+
+    private:
+        struct ClassLess {
+            const Builder* builder;
+
+            bool operator()(std::uint32_t a, std::uint32_t b) const {
+                return builder->compare3_ranked(builder->representatives_[a], builder->representatives_[b]) < 0;
+            }
+        };
+
+        std::pair<const Key*, const Key*> fields(std::uint32_t node) const noexcept {
+            return {fields_.data() + first_field_[node], fields_.data() + first_field_[node + 1]};
+        }
+
+        std::uint32_t find_class(std::uint32_t node) {
+            const auto [first, last] = fields(node);
+
+            std::uint64_t hash = 0;
+            for (auto p = first; p != last; ++p) {
+                switch (p->kind) {
+                    case Key::Kind::name:
+                        mix(hash, static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(f_.names_[p->value].str)));
+                        break;
+                    case Key::Kind::literal:
+                        mix(hash, hash_literal(f_.literals_[p->value]));
+                        break;
+                    case Key::Kind::child:
+                        mix(hash, class_of_[p->value]);
+                        break;
+                    default:
+                        mix(hash, p->value);
+                        break;
+                }
+            }
+
+            const auto [begin, end] = classes_.equal_range(hash);
+            for (auto it = begin; it != end; ++it) {
+                if (equal(node, representatives_[it->second])) {
+                    return it->second;
+                }
+            }
+
+            const auto c = static_cast<std::uint32_t>(representatives_.size());
+
+            representatives_.push_back(node);
+            labels_.push_back(0);
+            ranked_.push_back(false);
+            classes_.emplace(hash, c);
+
+            return c;
+        }
+
+        bool equal(std::uint32_t a, std::uint32_t b) const {
+            const auto [a_first, a_last] = fields(a);
+            const auto [b_first, b_last] = fields(b);
+
+            if (a_last - a_first != b_last - b_first) {
+                return false;
+            }
+
+            for (auto x = a_first, y = b_first; x != a_last; ++x, ++y) {
+                const auto c = x->kind == Key::Kind::child && y->kind == Key::Kind::child
+                                   ? detail::compare3_values(class_of_[x->value], class_of_[y->value])
+                                   : f_.compare3(*x, f_, *y);
+
+                if (c != 0) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Same as `wasm::compare3` on two subtrees, ranking their operands as needed
+        int compare3_subtrees(std::uint32_t a, std::uint32_t b) {
+            if (class_of_[a] == class_of_[b]) {
+                return 0;
+            }
+
+            const auto [a_first, a_last] = fields(a);
+            const auto [b_first, b_last] = fields(b);
+
+            for (auto x = a_first, y = b_first; x != a_last && y != b_last; ++x, ++y) {
+                if (x->kind == Key::Kind::child && y->kind == Key::Kind::child) {
+                    const auto cx = class_of_[x->value];
+                    const auto cy = class_of_[y->value];
+
+                    if (cx == cy) {
+                        continue;
+                    }
+
+                    rank(cx);
+                    rank(cy);
+
+                    return detail::compare3_values(labels_[cx], labels_[cy]);
+                }
+
+                if (const auto c = f_.compare3(*x, f_, *y); c != 0) {
+                    return c;
+                }
+            }
+
+            return detail::compare3_values(a_last - a_first, b_last - b_first);
+        }
+
+        // Same as `wasm::compare3` on two subtrees whose operands are ranked
+        int compare3_ranked(std::uint32_t a, std::uint32_t b) const {
+            const auto [a_first, a_last] = fields(a);
+            const auto [b_first, b_last] = fields(b);
+
+            for (auto x = a_first, y = b_first; x != a_last && y != b_last; ++x, ++y) {
+                const auto c = x->kind == Key::Kind::child && y->kind == Key::Kind::child
+                                   ? detail::compare3_values(labels_[class_of_[x->value]], labels_[class_of_[y->value]])
+                                   : f_.compare3(*x, f_, *y);
+
+                if (c != 0) {
+                    return c;
+                }
+            }
+
+            return detail::compare3_values(a_last - a_first, b_last - b_first);
+        }
+
+        // Inserts the class and its operands into `order_`, operands first
+        void rank(std::uint32_t c) {
+            std::vector<std::uint32_t> stack{c};
+
+            while (!stack.empty()) {
+                const auto top = stack.back();
+
+                if (ranked_[top]) {
+                    stack.pop_back();
+                    continue;
+                }
+
+                const auto mark = stack.size();
+
+                const auto [first, last] = fields(representatives_[top]);
+                for (auto p = first; p != last; ++p) {
+                    if (p->kind == Key::Kind::child && !ranked_[class_of_[p->value]]) {
+                        stack.push_back(class_of_[p->value]);
+                    }
+                }
+
+                if (stack.size() == mark) {
+                    stack.pop_back();
+
+                    assign_label(order_, order_.insert(top).first, labels_);
+                    ranked_[top] = true;
+                }
+            }
+        }
+
+        FlatFunction& f_;
+
+        // Nodes in post-order, with operands in visiting order
+        std::vector<Node> nodes_;
+
+        // Fields of each node, in `fields_[first_field_[i]]` to `fields_[first_field_[i + 1]]`
+        std::vector<Key> fields_;
+        std::vector<std::uint32_t> first_field_;
+
+        // Equivalence classes of subtrees
+        std::vector<std::uint32_t> class_of_;        // node -> class
+        std::vector<std::uint32_t> representatives_; // class -> node
+        std::vector<std::uint64_t> labels_;          // class -> label, increasing in the order of `wasm::compare3`
+        std::vector<bool> ranked_;                   // class -> whether in `order_`
+        std::unordered_multimap<std::uint64_t, std::uint32_t> classes_;
+        std::set<std::uint32_t, ClassLess> order_;
+
+        std::vector<std::uint32_t> operands_;
+    };
+
+    FlatFunction::FlatFunction(wasm::Function& f)
+        : function_(&f)
+        , nodes_()
+        , keys_()
+        , names_()
+        , literals_() {
+        if (f.body != nullptr) {
+            flatten(*f.body);
+        }
+    }
+
+    void FlatFunction::flatten(wasm::Expression& body) {
+        struct Entry {
+            wasm::Expression* expr;
+            std::uint32_t begin;
+            bool opaque;
+            bool expanded;
+        };
+
+        Builder builder{*this};
+        std::uint32_t size = 0;
+
+        std::vector<Entry> stack{};
+        stack.push_back({&body, 0, false, false});
+
+        while (!stack.empty()) {
+            if (auto& top = stack.back(); !top.expanded) {
+                top.expanded = true;
+                top.begin = size;
+
+                const auto& expr = *top.expr;
+                const bool opaque = top.opaque || expr.is<wasm::Rethrow>() || expr.is<wasm::BrOnExn>();
+                const auto mark = stack.size();
+
+                for_each_child(expr, [&](wasm::Expression* child) {
+                    stack.push_back({child, 0, opaque, false});
+                });
+
+                std::reverse(std::begin(stack) + mark, std::end(stack));
+                continue;
+            }
+
+            const auto e = stack.back();
+            stack.pop_back();
+
+            builder.add(*e.expr, e.begin, e.opaque);
+            size++;
+        }
+
+        builder.encode();
+        builder.lay_out();
+    }
+
+    void FlatFunction::encode(const wasm::Expression& expr, std::int8_t order, const std::vector<std::uint32_t>& operands, std::vector<Key>& fields) {
+        static_assert(wasm::Expression::NumExpressionIds == 49);
+
+        std::size_t next = 0;
+
+        const auto integer = [&](std::uint64_t value) {
+            fields.push_back({Key::Kind::integer, value});
+        };
+
+        const auto type = [&](wasm::Type value) {
+            fields.push_back({Key::Kind::type, static_cast<std::uint64_t>(value.getID())});
+        };
+
+        const auto name = [&](wasm::Name value) {
+            fields.push_back({Key::Kind::name, names_.size()});
+            names_.push_back(value);
+        };
+
+        const auto literal = [&](const wasm::Literal& value) {
+            fields.push_back({Key::Kind::literal, literals_.size()});
+            literals_.push_back(value);
+        };
+
+        const auto child = [&]() {
+            fields.push_back({Key::Kind::child, operands[next++]});
+        };
+
+        // nullptr is the least
+        const auto optional = [&](const wasm::Expression* p) {
+            integer(p != nullptr ? 1 : 0);
+            if (p != nullptr) {
+                child();
+            }
+        };
+
+        const auto list = [&](const wasm::ExpressionList& l) {
+            integer(l.size());
+            for (std::size_t i = 0; i < l.size(); i++) {
+                child();
+            }
+        };
+
+        integer(expr._id);
+        type(expr.type);
+
+        switch (expr._id) {
+            case wasm::Expression::Id::BlockId: {
+                const auto& x = *expr.cast<wasm::Block>();
+                list(x.list);
+                break;
+            }
+            case wasm::Expression::Id::IfId: {
+                const auto& x = *expr.cast<wasm::If>();
+                child();
+                child();
+                optional(x.ifFalse);
+                break;
+            }
+            case wasm::Expression::Id::LoopId: {
+                child();
+                break;
+            }
+            case wasm::Expression::Id::BreakId: {
+                const auto& x = *expr.cast<wasm::Break>();
+                optional(x.value);
+                optional(x.condition);
+                break;
+            }
+            case wasm::Expression::Id::SwitchId: {
+                const auto& x = *expr.cast<wasm::Switch>();
+                optional(x.value);
+                optional(x.condition);
+                break;
+            }
+            case wasm::Expression::Id::CallId: {
+                const auto& x = *expr.cast<wasm::Call>();
+                list(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::CallIndirectId: {
+                const auto& x = *expr.cast<wasm::CallIndirect>();
+                list(x.operands);
+                child();
+                break;
+            }
+            case wasm::Expression::Id::LocalGetId: {
+                const auto& x = *expr.cast<wasm::LocalGet>();
+                integer(x.index);
+                break;
+            }
+            case wasm::Expression::Id::LocalSetId: {
+                const auto& x = *expr.cast<wasm::LocalSet>();
+                integer(x.index);
+                child();
+                break;
+            }
+            case wasm::Expression::Id::GlobalGetId: {
+                const auto& x = *expr.cast<wasm::GlobalGet>();
+                name(x.name);
+                break;
+            }
+            case wasm::Expression::Id::GlobalSetId: {
+                const auto& x = *expr.cast<wasm::GlobalSet>();
+                child();
+                name(x.name);
+                break;
+            }
+            case wasm::Expression::Id::LoadId: {
+                child();
+                break;
+            }
+            case wasm::Expression::Id::StoreId: {
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::ConstId: {
+                const auto& x = *expr.cast<wasm::Const>();
+                literal(x.value);
+                break;
+            }
+            case wasm::Expression::Id::UnaryId: {
+                const auto& x = *expr.cast<wasm::Unary>();
+                integer(x.op);
+                child();
+                break;
+            }
+            case wasm::Expression::Id::BinaryId: {
+                const auto& x = *expr.cast<wasm::Binary>();
+
+                // The operands are already in the order of (lo, hi)
+                if (!is_commutative(x.op) || order < 0) {
+                    integer(x.op);
+                } else {
+                    integer(swapped_binary_op_unchecked(x.op));
+                }
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::SelectId: {
+                child();
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::DropId: {
+                child();
+                break;
+            }
+            case wasm::Expression::Id::ReturnId: {
+                const auto& x = *expr.cast<wasm::Return>();
+                optional(x.value);
+                break;
+            }
+            case wasm::Expression::Id::MemoryGrowId: {
+                const auto& x = *expr.cast<wasm::MemoryGrow>();
+                optional(x.delta);
+                break;
+            }
+            case wasm::Expression::Id::AtomicRMWId: {
+                const auto& x = *expr.cast<wasm::AtomicRMW>();
+                integer(x.op);
+                integer(x.bytes);
+                integer(x.offset);
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::AtomicCmpxchgId: {
+                const auto& x = *expr.cast<wasm::AtomicCmpxchg>();
+                integer(x.bytes);
+                integer(x.offset);
+                child();
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::AtomicWaitId: {
+                const auto& x = *expr.cast<wasm::AtomicWait>();
+                integer(x.offset);
+                child();
+                child();
+                child();
+                type(x.expectedType);
+                break;
+            }
+            case wasm::Expression::Id::AtomicNotifyId: {
+                const auto& x = *expr.cast<wasm::AtomicNotify>();
+                integer(x.offset);
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::SIMDExtractId: {
+                const auto& x = *expr.cast<wasm::SIMDExtract>();
+                integer(x.op);
+                child();
+                integer(x.index);
+                break;
+            }
+            case wasm::Expression::Id::SIMDReplaceId: {
+                const auto& x = *expr.cast<wasm::SIMDReplace>();
+                integer(x.op);
+                child();
+                integer(x.index);
+                child();
+                break;
+            }
+            case wasm::Expression::Id::SIMDShuffleId: {
+                const auto& x = *expr.cast<wasm::SIMDShuffle>();
+                child();
+                child();
+                for (const auto& lane : x.mask) {
+                    integer(lane);
+                }
+                break;
+            }
+            case wasm::Expression::Id::SIMDTernaryId: {
+                child();
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::SIMDShiftId: {
+                const auto& x = *expr.cast<wasm::SIMDShift>();
+                integer(x.op);
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::SIMDLoadId: {
+                const auto& x = *expr.cast<wasm::SIMDLoad>();
+                integer(x.op);
+                integer(x.offset);
+                integer(x.align);
+                child();
+                break;
+            }
+            case wasm::Expression::Id::MemoryInitId: {
+                const auto& x = *expr.cast<wasm::MemoryInit>();
+                integer(x.segment);
+                child();
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::DataDropId: {
+                const auto& x = *expr.cast<wasm::DataDrop>();
+                integer(x.segment);
+                break;
+            }
+            case wasm::Expression::Id::MemoryCopyId:
+            case wasm::Expression::Id::MemoryFillId: {
+                child();
+                child();
+                child();
+                break;
+            }
+            case wasm::Expression::Id::RefIsNullId: {
+                child();
+                break;
+            }
+            case wasm::Expression::Id::TryId: {
+                const auto& x = *expr.cast<wasm::Try>();
+                optional(x.body);
+                optional(x.catchBody);
+                break;
+            }
+            case wasm::Expression::Id::ThrowId: {
+                const auto& x = *expr.cast<wasm::Throw>();
+                list(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::RethrowId: {
+                const auto& x = *expr.cast<wasm::Rethrow>();
+                optional(x.exnref);
+                break;
+            }
+            case wasm::Expression::Id::BrOnExnId: {
+                const auto& x = *expr.cast<wasm::BrOnExn>();
+                optional(x.exnref);
+                break;
+            }
+            case wasm::Expression::Id::TupleMakeId: {
+                const auto& x = *expr.cast<wasm::TupleMake>();
+                list(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::TupleExtractId: {
+                const auto& x = *expr.cast<wasm::TupleExtract>();
+                child();
+                integer(x.index);
+                break;
+            }
+            case wasm::Expression::Id::MemorySizeId:
+            case wasm::Expression::Id::NopId:
+            case wasm::Expression::Id::UnreachableId:
+            case wasm::Expression::Id::AtomicFenceId:
+            case wasm::Expression::Id::PopId:
+            case wasm::Expression::Id::RefNullId:
+            case wasm::Expression::Id::RefFuncId: {
+                // No fields compared
+                break;
+            }
+            default: {
+                WASM_UNREACHABLE("unknown expression id");
+            }
+        }
+    }
+
+    int FlatFunction::compare3(const Key& a, const FlatFunction& other, const Key& b) const {
+        if (a.kind != b.kind) {
+            // Never happens as long as the preceding keys are equal
+            return a.kind < b.kind ? -1 : 1;
+        }
+
+        switch (a.kind) {
+            case Key::Kind::integer:
+                return detail::compare3_values(a.value, b.value);
+
+            case Key::Kind::type: {
+                if (a.value == b.value) {
+                    return 0;
+                }
+
+                return detail::compare3_values(wasm::Type(a.value), wasm::Type(b.value));
+            }
+
+            case Key::Kind::name: {
+                return detail::compare3_values(names_[a.value], other.names_[b.value]);
+            }
+
+            case Key::Kind::literal:
+                return wasm::compare3(literals_[a.value], other.literals_[b.value]);
+
+            case Key::Kind::child:
+                break;
+        }
+
+        WASM_UNREACHABLE("unknown key kind");
+    }
+
+    int compare3(const FlatFunction& a, const FlatFunction& b) {
+        if (&a == &b) {
+            return 0;
+        }
+
+        // wasm::Function::getNumVars() does not modify states
+        auto& f = a.function();
+        auto& g = b.function();
+
+        if (const auto c = detail::compare3_values(f.sig, g.sig); c != 0) {
+            return c;
+        }
+
+        if (const auto c = detail::compare3_values(f.getNumVars(), g.getNumVars()); c != 0) {
+            return c;
+        }
+
+        return compare3_body(a, b);
+    }
+
+    int compare3_body(const FlatFunction& a, const FlatFunction& b) {
+        const auto n = (std::min)(a.keys_.size(), b.keys_.size());
+
+        for (std::size_t i = 0; i < n; i++) {
+            const auto& x = a.keys_[i];
+            const auto& y = b.keys_[i];
+
+            // Integers and types are equal iff their values are equal
+            if (x.kind == y.kind && x.value == y.value && (x.kind == FlatFunction::Key::Kind::integer || x.kind == FlatFunction::Key::Kind::type)) {
+                continue;
+            }
+
+            if (const auto c = a.compare3(x, b, y); c != 0) {
+                return c;
+            }
+        }
+
+        return detail::compare3_values(a.keys_.size(), b.keys_.size());
+    }
+} // namespace kyut
@@ -0,0 +1,77 @@
+#ifndef INCLUDE_kyut_wasm_ext_FlatFunction_hpp
+#define INCLUDE_kyut_wasm_ext_FlatFunction_hpp
+
+#include <cstdint>
+#include <vector>
+#include "wasm.h"
+
+namespace kyut {
+    // Contiguous snapshot of a function body, scanned linearly instead of chasing expression pointers.
+    // Equal subtrees are found while building it, and compared subtrees are ranked at most once, so ordering the
+    // operands of each commutative binary expression does not walk them again.
+    class FlatFunction {
+    public:
+        struct Node {
+            wasm::Expression* expr;     // The original expression, to map mutations back
+            std::uint32_t size;         // Number of nodes in the subtree
+            std::uint32_t num_children; // Number of operands
+            wasm::Expression::Id id;
+            std::int8_t order; // Sign of `compare3(left, right)` for commutative binary expressions, 0 otherwise
+            bool opaque;       // Below the operand of rethrow or br_on_exn
+        };
+
+        struct Key {
+            enum class Kind : std::uint8_t {
+                integer,
+                type,    // wasm::Type::getID()
+                name,    // Index of `names_`
+                literal, // Index of `literals_`
+                child,   // Index of an operand node, only while building
+            };
+
+            Kind kind;
+            std::uint64_t value;
+        };
+
+        explicit FlatFunction(wasm::Function& f);
+
+        wasm::Function& function() const noexcept {
+            return *function_;
+        }
+
+        // Nodes in post-order, in the order operand swapping embeds bits in. Operands are in the order of `for_each_child`, but
+        // those of a commutative binary expression are in the order of (lo, hi) if they differ, and those of the other
+        // binary expressions and of SIMD replace, shuffle and shift expressions are last first.
+        // The last operand of node `i` is at `i - 1`, and the operand before node `j` is at `j - nodes()[j].size`.
+        const std::vector<Node>& nodes() const noexcept {
+            return nodes_;
+        }
+
+        // Same as `wasm::compare3` on the functions and on their bodies
+        friend int compare3(const FlatFunction& a, const FlatFunction& b);
+        friend int compare3_body(const FlatFunction& a, const FlatFunction& b);
+
+    private:
+        class Builder;
+
+        void flatten(wasm::Expression& body);
+
+        // Appends the fields of `expr` to `fields`, given its operands in the order of comparison
+        void encode(const wasm::Expression& expr, std::int8_t order, const std::vector<std::uint32_t>& operands, std::vector<Key>& fields);
+
+        int compare3(const Key& a, const FlatFunction& other, const Key& b) const;
+
+        wasm::Function* function_;
+        std::vector<Node> nodes_;
+
+        // Fields of the body in pre-order, in the order `wasm::compare3` compares them
+        std::vector<Key> keys_;
+        std::vector<wasm::Name> names_;
+        std::vector<wasm::Literal> literals_;
+    };
+
+    int compare3(const FlatFunction& a, const FlatFunction& b);
+    int compare3_body(const FlatFunction& a, const FlatFunction& b);
+} // namespace kyut
+
+#endif // INCLUDE_kyut_wasm_ext_FlatFunction_hpp
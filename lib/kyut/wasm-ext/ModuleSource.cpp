@@ -0,0 +1,328 @@
+#include "ModuleSource.hpp"
+
+#include <map>
+#include <numeric>
+#include "../Parallel.hpp"
+#include "../binary/Writer.hpp"
+#include "ParallelWriter.hpp"
+#include "wasm-io.h"
+
+namespace kyut {
+    namespace {
+        constexpr std::uint8_t local_names_id = 2;
+
+        const binary::Section* find_name_section(const binary::Module& module) {
+            for (const auto& section : module.sections()) {
+                if (section.id == binary::SectionId::custom && section.name == "name") {
+                    return &section;
+                }
+            }
+
+            return nullptr;
+        }
+
+        // Encoded local name map of each function index in the name section
+        std::map<std::uint32_t, std::string_view> read_local_names(const binary::Module& module) {
+            std::map<std::uint32_t, std::string_view> local_names{};
+
+            const auto section = find_name_section(module);
+            if (section == nullptr) {
+                return local_names;
+            }
+
+            auto r = module.reader(*section);
+            r.read_name();
+
+            while (!r.at_end()) {
+                const auto id = r.read_byte();
+                const auto size = r.read_u32();
+
+                if (id != local_names_id) {
+                    r.skip(size);
+                    continue;
+                }
+
+                binary::Reader sub{module.bytes().data(), r.offset(), r.offset() + size};
+                r.skip(size);
+
+                const auto count = sub.read_u32();
+                for (std::uint32_t i = 0; i < count; i++) {
+                    const auto function_index = sub.read_u32();
+                    const auto offset = sub.offset();
+
+                    const auto num_locals = sub.read_u32();
+                    for (std::uint32_t k = 0; k < num_locals; k++) {
+                        sub.read_u32();
+                        sub.read_name();
+                    }
+
+                    local_names.emplace(function_index, std::string_view{reinterpret_cast<const char*>(module.bytes().data() + offset), sub.offset() - offset});
+                }
+            }
+
+            return local_names;
+        }
+
+        // Name section of `output`, with the local names of the copied functions taken from `source`.
+        // `copied` maps new function indices to original ones.
+        std::vector<std::uint8_t> rewrite_name_section(
+            const binary::Module& output,
+            const binary::Section& section,
+            const binary::Module& source,
+            const std::unordered_map<std::uint32_t, std::uint32_t>& copied) {
+            auto local_names = read_local_names(output);
+            const auto source_local_names = read_local_names(source);
+
+            // Locals of copied functions keep their original indices
+            for (const auto& [new_index, old_index] : copied) {
+                local_names.erase(new_index);
+
+                if (const auto it = source_local_names.find(old_index); it != std::end(source_local_names)) {
+                    local_names.emplace(new_index, it->second);
+                }
+            }
+
+            std::vector<std::uint8_t> local_names_payload{};
+            binary::write_u32(local_names_payload, static_cast<std::uint32_t>(local_names.size()));
+
+            for (const auto& [function_index, name_map] : local_names) {
+                binary::write_u32(local_names_payload, function_index);
+                local_names_payload.insert(std::end(local_names_payload), std::begin(name_map), std::end(name_map));
+            }
+
+            std::vector<std::uint8_t> payload{};
+            binary::write_name(payload, "name");
+
+            auto r = output.reader(section);
+            r.read_name();
+
+            bool written = local_names.empty();
+            const auto write_local_names = [&] {
+                payload.push_back(local_names_id);
+                binary::write_u32(payload, static_cast<std::uint32_t>(local_names_payload.size()));
+                payload.insert(std::end(payload), std::begin(local_names_payload), std::end(local_names_payload));
+
+                written = true;
+            };
+
+            // Subsections are in the order of their ids
+            while (!r.at_end()) {
+                const auto offset = r.offset();
+                const auto id = r.read_byte();
+                const auto size = r.read_u32();
+                r.skip(size);
+
+                if (id >= local_names_id && !written) {
+                    write_local_names();
+                }
+
+                if (id != local_names_id) {
+                    binary::write_bytes(payload, output.bytes().data() + offset, output.bytes().data() + r.offset());
+                }
+            }
+
+            if (!written) {
+                write_local_names();
+            }
+
+            return payload;
+        }
+    } // namespace
+
+    ModuleSource::ModuleSource()
+        : binary_()
+        , code_()
+        , functions_()
+        , globals_()
+        , events_()
+        , bodies_()
+        , modified_()
+        , reader_() {
+    }
+
+    ModuleSource::~ModuleSource() noexcept = default;
+
+    void ModuleSource::read(const std::string& filename, wasm::Module& module, std::size_t num_threads) {
+        binary_.reset();
+        code_.clear();
+        functions_.clear();
+        globals_.clear();
+        events_.clear();
+        bodies_.clear();
+        modified_.clear();
+
+        if (!wasm::ModuleReader{}.isBinaryFile(filename)) {
+            wasm::ModuleReader{}.read(filename, module);
+            return;
+        }
+
+        if (num_threads > 1) {
+            // The binary is read once for both
+            binary_.emplace(binary::read_module(filename));
+            reader_.read(*binary_, module, num_threads);
+        } else {
+            wasm::ModuleReader{}.read(filename, module);
+            binary_.emplace(binary::read_module(filename));
+        }
+
+        code_ = binary::read_code(*binary_);
+
+        // Imports come first in both index spaces, and defined functions are in the order of the code section
+        for (const auto& f : module.functions) {
+            if (f->body != nullptr) {
+                bodies_.emplace(f.get(), Body{static_cast<std::uint32_t>(functions_.size()), bodies_.size()});
+            }
+
+            functions_.emplace_back(f.get());
+        }
+
+        for (const auto& g : module.globals) {
+            globals_.emplace_back(g.get());
+        }
+
+        for (const auto& e : module.events) {
+            events_.emplace_back(e.get());
+        }
+
+        if (bodies_.size() != code_.size()) {
+            // Not the binary the reader saw; encode every function
+            bodies_.clear();
+        }
+    }
+
+    void ModuleSource::mark_modified(const wasm::Function& f) {
+        modified_.emplace(&f);
+    }
+
+    void ModuleSource::write(wasm::Module& module, const std::string& filename, bool debug_info, std::size_t num_threads) {
+        // DWARF refers to offsets in the code section, which `wasm::ModuleWriter` updates for the bodies it encodes
+        if (!binary_ || has_dwarf_sections(module) || has_writer_locations(module)) {
+            write_binary(module, filename, debug_info, num_threads);
+            return;
+        }
+
+        // Event indices in bodies are not rewritten
+        std::vector<const wasm::Event*> events{};
+        for (const auto imported : {true, false}) {
+            for (const auto& e : module.events) {
+                if (e->imported() == imported) {
+                    events.emplace_back(e.get());
+                }
+            }
+        }
+
+        if (events != events_) {
+            write_binary(module, filename, debug_info, num_threads);
+            return;
+        }
+
+        // Indices assigned by `wasm::WasmBinaryWriter`, imports first
+        std::unordered_map<const wasm::Function*, std::uint32_t> function_indices{};
+        for (const auto imported : {true, false}) {
+            for (const auto& f : module.functions) {
+                if ((f->body == nullptr) == imported) {
+                    function_indices.emplace(f.get(), static_cast<std::uint32_t>(function_indices.size()));
+                }
+            }
+        }
+
+        std::unordered_map<const wasm::Global*, std::uint32_t> global_indices{};
+        for (const auto imported : {true, false}) {
+            for (const auto& g : module.globals) {
+                if (g->imported() == imported) {
+                    global_indices.emplace(g.get(), static_cast<std::uint32_t>(global_indices.size()));
+                }
+            }
+        }
+
+        binary::IndexMaps maps{};
+        for (const auto f : functions_) {
+            const auto it = function_indices.find(f);
+            maps.functions.emplace_back(it != std::end(function_indices) ? it->second : binary::no_index);
+        }
+
+        for (const auto g : globals_) {
+            const auto it = global_indices.find(g);
+            maps.globals.emplace_back(it != std::end(global_indices) ? it->second : binary::no_index);
+        }
+
+        // Segments are written in order
+        maps.elements.resize(module.table.segments.size());
+        std::iota(std::begin(maps.elements), std::end(maps.elements), std::uint32_t{0});
+
+        maps.data.resize(module.memory.segments.size());
+        std::iota(std::begin(maps.data), std::end(maps.data), std::uint32_t{0});
+
+        const ParallelWriter writer{module, debug_info};
+        const auto& output = writer.sections();
+        const auto& defined = writer.functions();
+
+        // Types are matched by their encodings
+        std::unordered_map<std::string_view, std::uint32_t> type_indices{};
+        for (const auto& t : binary::read_types(output)) {
+            type_indices.emplace(t, static_cast<std::uint32_t>(type_indices.size()));
+        }
+
+        for (const auto& t : binary::read_types(*binary_)) {
+            const auto it = type_indices.find(t);
+            maps.types.emplace_back(it != std::end(type_indices) ? it->second : binary::no_index);
+        }
+
+        // Without changed indices, entries are copied without scanning them
+        const auto identity = [](const std::vector<std::uint32_t>& map) {
+            for (std::size_t i = 0; i < map.size(); i++) {
+                if (map[i] != i) {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        const bool unchanged = identity(maps.functions) && identity(maps.types) && identity(maps.globals);
+
+        // Original bodies of unmodified functions are copied; the others, and the bodies that cannot be copied, are
+        // encoded from IR
+        std::vector<std::vector<std::uint8_t>> entries(defined.size());
+        std::vector<char> copied(defined.size());
+
+        parallel_for(defined.size(), num_threads, [&](std::size_t i) {
+            const auto it = bodies_.find(defined[i]);
+            if (it == std::end(bodies_) || modified_.count(defined[i]) != 0) {
+                return;
+            }
+
+            const auto& entry = code_[it->second.code_index];
+
+            if (unchanged) {
+                const auto data = binary_->bytes().data();
+                entries[i].assign(data + entry.offset, data + entry.end);
+                copied[i] = true;
+            } else {
+                copied[i] = binary::rewrite_body(*binary_, entry, maps, entries[i]);
+            }
+        });
+
+        parallel_for(defined.size(), num_threads, [&](std::size_t i) {
+            if (!copied[i]) {
+                writer.encode_body(*defined[i], entries[i]);
+            }
+        });
+
+        // Locals of copied functions keep their original indices
+        std::unordered_map<std::uint32_t, std::uint32_t> copied_indices{};
+        for (std::size_t i = 0; i < defined.size(); i++) {
+            if (copied[i]) {
+                copied_indices.emplace(function_indices.at(defined[i]), bodies_.at(defined[i]).function_index);
+            }
+        }
+
+        const auto name_section = find_name_section(output);
+        if (name_section != nullptr && !copied_indices.empty()) {
+            const auto payload = rewrite_name_section(output, *name_section, *binary_, copied_indices);
+            writer.write(filename, entries, &payload);
+        } else {
+            writer.write(filename, entries);
+        }
+    }
+} // namespace kyut
@@ -0,0 +1,68 @@
+#ifndef INCLUDE_kyut_wasm_ext_ModuleSource_hpp
+#define INCLUDE_kyut_wasm_ext_ModuleSource_hpp
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../binary/Code.hpp"
+#include "ParallelReader.hpp"
+#include "wasm.h"
+
+namespace kyut {
+    // Binary a module was read from.
+    // Writing the module copies the original bodies of the functions not marked as modified, instead of encoding
+    // them again; only their function, type and global indices are updated. Event indices are not, so the bodies are
+    // copied only while events keep their indices.
+    class ModuleSource {
+    public:
+        ModuleSource();
+
+        // Uncopyable and unmovable
+        ModuleSource(const ModuleSource&) = delete;
+        ModuleSource(ModuleSource&&) = delete;
+
+        ModuleSource& operator=(const ModuleSource&) = delete;
+        ModuleSource& operator=(ModuleSource&&) = delete;
+
+        ~ModuleSource() noexcept;
+
+        // Reads `filename` into `module`, keeping the binary unless it is a text file.
+        // With more than one thread, function bodies are decoded by a `ParallelReader`, which the source keeps, so
+        // the source must outlive `module`.
+        void read(const std::string& filename, wasm::Module& module, std::size_t num_threads = 1);
+
+        // The body of `f` is encoded from IR on write.
+        // Functions whose body, locals or parameters change must be marked.
+        void mark_modified(const wasm::Function& f);
+
+        // Same output as `wasm::ModuleWriter::writeBinary`, but with the original bodies of unmodified functions.
+        // Modules with DWARF sections are written by `wasm::ModuleWriter`, as copied bodies have no binary locations,
+        // and so are those with `has_writer_locations`.
+        // Bodies are copied, rewritten or encoded on up to `num_threads` threads.
+        void write(wasm::Module& module, const std::string& filename, bool debug_info, std::size_t num_threads = 1);
+
+    private:
+        struct Body {
+            std::uint32_t function_index; // In the original binary
+            std::size_t code_index;
+        };
+
+        std::optional<binary::Module> binary_;
+        std::vector<binary::CodeEntry> code_;
+
+        // Original index spaces
+        std::vector<const wasm::Function*> functions_;
+        std::vector<const wasm::Global*> globals_;
+        std::vector<const wasm::Event*> events_;
+
+        std::unordered_map<const wasm::Function*, Body> bodies_;
+        std::unordered_set<const wasm::Function*> modified_;
+
+        // Owns the bodies of the modules read on several threads
+        ParallelReader reader_;
+    };
+} // namespace kyut
+
+#endif // INCLUDE_kyut_wasm_ext_ModuleSource_hpp
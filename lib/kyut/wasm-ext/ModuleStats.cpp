@@ -0,0 +1,22 @@
+#include "ModuleStats.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include "wasm-io.h"
+
+namespace kyut {
+    binary::ModuleStats read_module_stats(const std::string& filename) {
+        if (wasm::ModuleReader{}.isBinaryFile(filename)) {
+            return binary::scan_module(filename);
+        }
+
+        wasm::Module module{};
+        wasm::ModuleReader{}.read(filename, module);
+
+        const auto num_imports = std::count_if(std::begin(module.functions), std::end(module.functions), [](const auto& f) {
+            return f->body == nullptr;
+        });
+
+        return binary::ModuleStats{module.functions.size(), module.exports.size(), static_cast<std::size_t>(num_imports)};
+    }
+} // namespace kyut
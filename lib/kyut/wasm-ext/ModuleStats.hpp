@@ -0,0 +1,13 @@
+#ifndef INCLUDE_kyut_wasm_ext_ModuleStats_hpp
+#define INCLUDE_kyut_wasm_ext_ModuleStats_hpp
+
+#include <string>
+#include "../binary/Stats.hpp"
+
+namespace kyut {
+    // Stats of the module in `filename`, scanned by `binary::scan_module` if it is a binary.
+    // Text modules are parsed and counted from IR instead.
+    binary::ModuleStats read_module_stats(const std::string& filename);
+} // namespace kyut
+
+#endif // INCLUDE_kyut_wasm_ext_ModuleStats_hpp
@@ -0,0 +1,240 @@
+#include "ParallelReader.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include "../Parallel.hpp"
+#include "../binary/Code.hpp"
+#include "../binary/Sections.hpp"
+#include "../binary/Writer.hpp"
+#include "wasm-binary.h"
+#include "wasm-io.h"
+
+namespace kyut {
+    namespace {
+        // Entry of the code section for a body left out: no locals, `unreachable`
+        constexpr std::uint8_t placeholder[] = {0x03, 0x00, 0x00, 0x0B};
+
+        constexpr std::uint8_t local_names_id = 2;
+
+        bool has_dwarf_sections(const binary::Module& module) {
+            for (const auto& section : module.sections()) {
+                if (section.id == binary::SectionId::custom && section.name.compare(0, 7, ".debug_") == 0) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Bounds of `num_shards` runs of code entries of about the same size in bytes
+        std::vector<std::size_t> split_code(const std::vector<binary::CodeEntry>& code, std::size_t num_shards) {
+            const auto first = code.front().offset;
+            const auto size = code.back().end - first;
+
+            std::vector<std::size_t> bounds{0};
+            for (std::size_t i = 1; i < num_shards; i++) {
+                const auto offset = first + size * i / num_shards;
+                const auto it = std::lower_bound(std::begin(code), std::end(code), offset, [](const binary::CodeEntry& e, std::size_t offset) {
+                    return e.offset < offset;
+                });
+
+                bounds.emplace_back(static_cast<std::size_t>(std::distance(std::begin(code), it)));
+            }
+
+            bounds.emplace_back(code.size());
+
+            return bounds;
+        }
+
+        // Contents of the name section `section` with the local names of the functions outside [begin, end) left out
+        std::vector<std::uint8_t> filter_local_names(const binary::Module& module, const binary::Section& section, std::size_t begin, std::size_t end) {
+            const auto data = module.bytes().data();
+
+            std::vector<std::uint8_t> payload{};
+
+            auto r = module.reader(section);
+            r.read_name();
+            binary::write_bytes(payload, data + section.payload_offset, data + r.offset());
+
+            while (!r.at_end()) {
+                const auto offset = r.offset();
+                const auto id = r.read_byte();
+                const auto size = r.read_u32();
+
+                binary::Reader sub{data, r.offset(), r.offset() + size};
+                r.skip(size);
+
+                if (id != local_names_id) {
+                    binary::write_bytes(payload, data + offset, data + r.offset());
+                    continue;
+                }
+
+                std::uint32_t count = 0;
+                std::vector<std::uint8_t> entries{};
+
+                const auto num_functions = sub.read_u32();
+                for (std::uint32_t i = 0; i < num_functions; i++) {
+                    const auto entry_offset = sub.offset();
+                    const auto function_index = sub.read_u32();
+
+                    const auto num_locals = sub.read_u32();
+                    for (std::uint32_t k = 0; k < num_locals; k++) {
+                        sub.read_u32();
+                        sub.read_name();
+                    }
+
+                    if (begin <= function_index && function_index < end) {
+                        binary::write_bytes(entries, data + entry_offset, data + sub.offset());
+                        count++;
+                    }
+                }
+
+                std::vector<std::uint8_t> contents{};
+                binary::write_u32(contents, count);
+                binary::write_bytes(contents, entries.data(), entries.data() + entries.size());
+
+                binary::write_section(payload, local_names_id, contents);
+            }
+
+            return payload;
+        }
+
+        // Copy of `module` with placeholders for the bodies outside the code entries [begin, end), whose local names
+        // are left out as the placeholders have no locals.
+        // Unless `full`, the contents of data segments and the custom sections function bodies do not depend on are
+        // left out as well.
+        std::vector<char> make_input(
+            const binary::Module& module,
+            const std::vector<binary::CodeEntry>& code,
+            std::size_t num_imported,
+            std::size_t begin,
+            std::size_t end,
+            bool full) {
+            const auto data = module.bytes().data();
+
+            std::vector<std::uint8_t> bytes(std::begin(binary::magic), std::end(binary::magic));
+
+            for (const auto& section : module.sections()) {
+                std::vector<std::uint8_t> payload{};
+
+                if (section.id == binary::SectionId::code) {
+                    binary::write_u32(payload, static_cast<std::uint32_t>(code.size()));
+
+                    for (std::size_t i = 0; i < code.size(); i++) {
+                        if (begin <= i && i < end) {
+                            binary::write_bytes(payload, data + code[i].offset, data + code[i].end);
+                        } else {
+                            binary::write_bytes(payload, std::begin(placeholder), std::end(placeholder));
+                        }
+                    }
+                } else if (section.id == binary::SectionId::custom && section.name == "name") {
+                    payload = filter_local_names(module, section, num_imported + begin, num_imported + end);
+                } else if (full) {
+                    binary::write_bytes(bytes, data + section.offset, data + section.end);
+                    continue;
+                } else if (section.id == binary::SectionId::data) {
+                    // Segments keep their indices for `memory.init` and `data.drop`
+                    const auto segments = binary::read_data(module);
+                    binary::write_u32(payload, static_cast<std::uint32_t>(segments.size()));
+
+                    for (const auto& s : segments) {
+                        binary::write_bytes(payload, data + s.offset, data + s.init_offset);
+                        binary::write_u32(payload, 0);
+                    }
+                } else if (section.id == binary::SectionId::custom && section.name != "target_features") {
+                    continue;
+                } else {
+                    binary::write_bytes(bytes, data + section.offset, data + section.end);
+                    continue;
+                }
+
+                binary::write_section(bytes, static_cast<std::uint8_t>(section.id), payload);
+            }
+
+            return std::vector<char>(std::begin(bytes), std::end(bytes));
+        }
+    } // namespace
+
+    ParallelReader::ParallelReader()
+        : shards_() {
+    }
+
+    ParallelReader::~ParallelReader() noexcept = default;
+
+    void ParallelReader::read(const std::string& filename, wasm::Module& module, std::size_t num_threads) {
+        if (num_threads <= 1 || !wasm::ModuleReader{}.isBinaryFile(filename)) {
+            wasm::ModuleReader{}.read(filename, module);
+            return;
+        }
+
+        read(binary::read_module(filename), module, num_threads);
+    }
+
+    void ParallelReader::read(const binary::Module& binary, wasm::Module& module, std::size_t num_threads) {
+        const auto code = binary::read_code(binary);
+        const auto num_imported = binary::count_imports(binary::read_imports(binary), binary::ExternalKind::function);
+        // Binary locations for DWARF are offsets in the whole code section, which shards do not have
+        const auto num_shards = has_dwarf_sections(binary) ? 1 : (std::min)(num_threads, code.size());
+
+        if (num_shards <= 1) {
+            const std::vector<char> input(std::begin(binary.bytes()), std::end(binary.bytes()));
+            wasm::WasmBinaryBuilder{module, input}.read();
+            return;
+        }
+
+        // Everything but the bodies
+        {
+            const auto input = make_input(binary, code, num_imported, 0, 0, true);
+            wasm::WasmBinaryBuilder{module, input}.read();
+        }
+
+        const auto bounds = split_code(code, num_shards);
+        std::vector<std::unique_ptr<wasm::Module>> shards(num_shards);
+
+        parallel_for(num_shards, num_threads, [&](std::size_t i) {
+            if (bounds[i] == bounds[i + 1]) {
+                return;
+            }
+
+            const auto input = make_input(binary, code, num_imported, bounds[i], bounds[i + 1], false);
+
+            // Created on the thread reading into it, so the arena is not shared with other threads
+            auto shard = std::make_unique<wasm::Module>();
+            wasm::WasmBinaryBuilder{*shard, input}.read();
+
+            shards[i] = std::move(shard);
+        });
+
+        if (module.functions.size() != num_imported + code.size()) {
+            throw std::runtime_error{"function count mismatch"};
+        }
+
+        // Defined functions follow the imported ones, in the order of the code section
+
+        for (std::size_t i = 0; i < num_shards; i++) {
+            if (!shards[i]) {
+                continue;
+            }
+
+            auto& functions = shards[i]->functions;
+            if (functions.size() != module.functions.size()) {
+                throw std::runtime_error{"shard function count mismatch"};
+            }
+
+            // Shards get the placeholders, so both modules keep every function
+            for (auto k = num_imported + bounds[i]; k < num_imported + bounds[i + 1]; k++) {
+                if (functions[k]->name != module.functions[k]->name) {
+                    throw std::runtime_error{"shard function name mismatch"};
+                }
+
+                std::swap(functions[k], module.functions[k]);
+            }
+
+            shards_.emplace_back(std::move(shards[i]));
+        }
+
+        module.updateMaps();
+    }
+} // namespace kyut
@@ -0,0 +1,42 @@
+#ifndef INCLUDE_kyut_wasm_ext_ParallelReader_hpp
+#define INCLUDE_kyut_wasm_ext_ParallelReader_hpp
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../binary/Module.hpp"
+#include "wasm.h"
+
+namespace kyut {
+    // Reads binaries into Binaryen IR, decoding function bodies on several threads.
+    // Sections are read serially into the module, with placeholders for the bodies. The code section is then split
+    // into one shard per thread, and each shard is read into a module of its own, whose functions are moved into the
+    // module. Their expressions stay in the arenas of the shards, so the reader must outlive the modules it reads.
+    class ParallelReader {
+    public:
+        ParallelReader();
+
+        // Uncopyable and unmovable
+        ParallelReader(const ParallelReader&) = delete;
+        ParallelReader(ParallelReader&&) = delete;
+
+        ParallelReader& operator=(const ParallelReader&) = delete;
+        ParallelReader& operator=(ParallelReader&&) = delete;
+
+        ~ParallelReader() noexcept;
+
+        // Reads `filename` into `module` on up to `num_threads` threads.
+        // With one thread, or for a text file, it is the same as `wasm::ModuleReader::read`.
+        // Binaries with DWARF sections are read on one thread.
+        void read(const std::string& filename, wasm::Module& module, std::size_t num_threads);
+
+        // Reads `binary` into `module`, which must be empty, on up to `num_threads` threads
+        void read(const binary::Module& binary, wasm::Module& module, std::size_t num_threads);
+
+    private:
+        // Shards of every module read, which own the memory of their functions
+        std::vector<std::unique_ptr<wasm::Module>> shards_;
+    };
+} // namespace kyut
+
+#endif // INCLUDE_kyut_wasm_ext_ParallelReader_hpp
@@ -0,0 +1,173 @@
+#include "ParallelWriter.hpp"
+
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include "../Parallel.hpp"
+#include "../binary/MappedFile.hpp"
+#include "../binary/Writer.hpp"
+#include "wasm-binary.h"
+#include "wasm-builder.h"
+#include "wasm-io.h"
+#include "wasm-stack.h"
+
+namespace kyut {
+    ParallelWriter::ParallelWriter(wasm::Module& module, bool debug_info)
+        : buffer_(std::make_unique<wasm::BufferWithRandomAccess>())
+        , writer_()
+        , sections_()
+        , functions_() {
+        if (has_dwarf_sections(module)) {
+            throw std::runtime_error{"DWARF sections cannot be written in parallel"};
+        }
+
+        if (has_writer_locations(module)) {
+            throw std::runtime_error{"debug locations cannot be written in parallel"};
+        }
+
+        // Indices and types are collected here, from the bodies themselves
+        writer_ = std::make_unique<wasm::WasmBinaryWriter>(&module, *buffer_);
+        writer_->setNamesSection(debug_info);
+
+        for (const auto& f : module.functions) {
+            if (f->body != nullptr) {
+                functions_.emplace_back(f.get());
+            }
+        }
+
+        // The writer encodes a placeholder for each body
+        std::vector<wasm::Expression*> bodies{};
+        bodies.reserve(functions_.size());
+
+        const auto placeholder = wasm::Builder{module}.makeUnreachable();
+        for (const auto f : functions_) {
+            bodies.emplace_back(f->body);
+            f->body = placeholder;
+        }
+
+        const auto restore = [&] {
+            for (std::size_t i = 0; i < functions_.size(); i++) {
+                functions_[i]->body = bodies[i];
+            }
+        };
+
+        try {
+            writer_->write();
+        } catch (...) {
+            restore();
+            throw;
+        }
+
+        restore();
+
+        sections_.emplace(std::move(static_cast<std::vector<std::uint8_t>&>(*buffer_)));
+    }
+
+    ParallelWriter::~ParallelWriter() noexcept = default;
+
+    bool has_dwarf_sections(const wasm::Module& module) {
+        for (const auto& section : module.userSections) {
+            if (section.name.compare(0, 7, ".debug_") == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool has_writer_locations(const wasm::Module& module) {
+        for (const auto& f : module.functions) {
+            if (!f->prologLocation.empty() || !f->epilogLocation.empty() || !f->expressionLocations.empty()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void ParallelWriter::encode_body(wasm::Function& f, std::vector<std::uint8_t>& out) const {
+        // Same as `wasm::WasmBinaryWriter::writeFunctions`, without a source map and DWARF.
+        // The writer only records locations of expressions with a source map, which it is never given, so bodies read
+        // it and nothing else.
+        wasm::BufferWithRandomAccess body{};
+
+        if (f.stackIR) {
+            wasm::StackIRToBinaryWriter{*writer_, body, &f}.write();
+        } else {
+            wasm::BinaryenIRToBinaryWriter{*writer_, body, &f, false, false}.write();
+        }
+
+        binary::write_u32(out, static_cast<std::uint32_t>(body.size()));
+        binary::write_bytes(out, body.data(), body.data() + body.size());
+    }
+
+    void ParallelWriter::write(
+        const std::string& filename,
+        const std::vector<std::vector<std::uint8_t>>& entries,
+        const std::vector<std::uint8_t>* name_section) const {
+        if (entries.size() != functions_.size()) {
+            throw std::runtime_error{"code section size mismatch"};
+        }
+
+        const auto data = sections_->bytes().data();
+
+        // Headers of the sections replaced; their contents do not move while the spans point into them
+        std::vector<std::vector<std::uint8_t>> headers{};
+
+        const auto write_header = [&](binary::SectionId id, std::size_t size) -> std::vector<std::uint8_t>& {
+            auto& header = headers.emplace_back();
+            header.push_back(static_cast<std::uint8_t>(id));
+            binary::write_u32(header, static_cast<std::uint32_t>(size));
+
+            return header;
+        };
+
+        std::vector<binary::Span> spans{{data, std::size(binary::magic)}};
+
+        for (const auto& section : sections_->sections()) {
+            if (section.id == binary::SectionId::code) {
+                std::vector<std::uint8_t> count{};
+                binary::write_u32(count, static_cast<std::uint32_t>(entries.size()));
+
+                const auto size = std::accumulate(std::begin(entries), std::end(entries), count.size(), [](std::size_t acc, const std::vector<std::uint8_t>& e) {
+                    return acc + e.size();
+                });
+
+                auto& header = write_header(section.id, size);
+                binary::write_bytes(header, count.data(), count.data() + count.size());
+                spans.emplace_back(binary::Span{header.data(), header.size()});
+
+                for (const auto& e : entries) {
+                    spans.emplace_back(binary::Span{e.data(), e.size()});
+                }
+            } else if (name_section != nullptr && section.id == binary::SectionId::custom && section.name == "name") {
+                const auto& header = write_header(section.id, name_section->size());
+                spans.emplace_back(binary::Span{header.data(), header.size()});
+                spans.emplace_back(binary::Span{name_section->data(), name_section->size()});
+            } else {
+                spans.emplace_back(binary::Span{data + section.offset, section.end - section.offset});
+            }
+        }
+
+        binary::write_file(filename, spans);
+    }
+
+    void write_binary(wasm::Module& module, const std::string& filename, bool debug_info, std::size_t num_threads) {
+        // Binary locations for DWARF are those of the placeholders in the writer, and locations recorded in it would race
+        if (num_threads <= 1 || has_dwarf_sections(module) || has_writer_locations(module)) {
+            wasm::ModuleWriter w{};
+            w.setDebugInfo(debug_info);
+            w.writeBinary(module, filename);
+            return;
+        }
+
+        const ParallelWriter writer{module, debug_info};
+
+        std::vector<std::vector<std::uint8_t>> entries(writer.functions().size());
+        parallel_for(entries.size(), num_threads, [&](std::size_t i) {
+            writer.encode_body(*writer.functions()[i], entries[i]);
+        });
+
+        writer.write(filename, entries);
+    }
+} // namespace kyut
@@ -0,0 +1,76 @@
+#ifndef INCLUDE_kyut_wasm_ext_ParallelWriter_hpp
+#define INCLUDE_kyut_wasm_ext_ParallelWriter_hpp
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../binary/Module.hpp"
+#include "wasm.h"
+
+namespace wasm {
+    class BufferWithRandomAccess;
+    class WasmBinaryWriter;
+} // namespace wasm
+
+namespace kyut {
+    // Encodes a module as `wasm::ModuleWriter::writeBinary` does, but each function body separately.
+    // The sections are encoded by `wasm::WasmBinaryWriter` with placeholders for the bodies. Bodies are then encoded
+    // into buffers of their own, and the file is written from the sections and the buffers in one pass.
+    class ParallelWriter {
+    public:
+        // Encodes the sections of `module`, which must not change until the writer is destroyed.
+        // Throws if `module` has DWARF sections, whose binary locations would be those of the placeholders, or
+        // `has_writer_locations(module)`.
+        ParallelWriter(wasm::Module& module, bool debug_info);
+
+        // Uncopyable and unmovable
+        ParallelWriter(const ParallelWriter&) = delete;
+        ParallelWriter(ParallelWriter&&) = delete;
+
+        ParallelWriter& operator=(const ParallelWriter&) = delete;
+        ParallelWriter& operator=(ParallelWriter&&) = delete;
+
+        ~ParallelWriter() noexcept;
+
+        // Sections with placeholders for the bodies
+        const binary::Module& sections() const noexcept {
+            return *sections_;
+        }
+
+        // Defined functions, in the order of the code section
+        const std::vector<wasm::Function*>& functions() const noexcept {
+            return functions_;
+        }
+
+        // Appends the body of `f`, with its size, to `out`.
+        // Safe to call from several threads, as no location is recorded in the writer shared by them.
+        void encode_body(wasm::Function& f, std::vector<std::uint8_t>& out) const;
+
+        // Writes the sections to `filename`, with `entries[i]` as the entry of the code section for `functions()[i]`,
+        // and `name_section` as the contents of the name section if it is not null
+        void write(
+            const std::string& filename,
+            const std::vector<std::vector<std::uint8_t>>& entries,
+            const std::vector<std::uint8_t>* name_section = nullptr) const;
+
+    private:
+        std::unique_ptr<wasm::BufferWithRandomAccess> buffer_;
+        std::unique_ptr<wasm::WasmBinaryWriter> writer_;
+        std::optional<binary::Module> sections_;
+        std::vector<wasm::Function*> functions_;
+    };
+
+    // True if `module` has DWARF sections, whose binary locations only `wasm::ModuleWriter` keeps up to date
+    bool has_dwarf_sections(const wasm::Module& module);
+
+    // True if encoding a body of `module` would record locations in `wasm::WasmBinaryWriter`: source map locations of
+    // function prologs and epilogs, and binary locations of expressions read with DWARF
+    bool has_writer_locations(const wasm::Module& module);
+
+    // Same output as `wasm::ModuleWriter::writeBinary`, with function bodies encoded on up to `num_threads` threads
+    void write_binary(wasm::Module& module, const std::string& filename, bool debug_info, std::size_t num_threads);
+} // namespace kyut
+
+#endif // INCLUDE_kyut_wasm_ext_ParallelWriter_hpp
@@ -0,0 +1,308 @@
+#ifndef INCLUDE_kyut_wasm_ext_Traversal_hpp
+#define INCLUDE_kyut_wasm_ext_Traversal_hpp
+
+#include <algorithm>
+#include <vector>
+#include "wasm.h"
+
+namespace kyut {
+    // Calls `f(child)` for each non-null operand of `expr` in visiting order, the order operand swapping has always
+    // visited them in. This is neither evaluation order nor the order `wasm::compare3` compares them in: the condition
+    // of a `Switch` comes before its value, and the target of a `CallIndirect` before its operands.
+    template <typename F>
+    inline void for_each_child(const wasm::Expression& expr, F&& f) {
+        static_assert(wasm::Expression::NumExpressionIds == 49);
+
+        const auto child = [&](wasm::Expression* p) {
+            if (p != nullptr) {
+                f(p);
+            }
+        };
+
+        const auto children = [&](const wasm::ExpressionList& list) {
+            for (const auto& p : list) {
+                child(p);
+            }
+        };
+
+        switch (expr._id) {
+            case wasm::Expression::Id::BlockId: {
+                const auto& x = *expr.cast<wasm::Block>();
+                children(x.list);
+                break;
+            }
+            case wasm::Expression::Id::IfId: {
+                const auto& x = *expr.cast<wasm::If>();
+                child(x.condition);
+                child(x.ifTrue);
+                child(x.ifFalse);
+                break;
+            }
+            case wasm::Expression::Id::LoopId: {
+                const auto& x = *expr.cast<wasm::Loop>();
+                child(x.body);
+                break;
+            }
+            case wasm::Expression::Id::BreakId: {
+                const auto& x = *expr.cast<wasm::Break>();
+                child(x.value);
+                child(x.condition);
+                break;
+            }
+            case wasm::Expression::Id::SwitchId: {
+                const auto& x = *expr.cast<wasm::Switch>();
+                child(x.condition);
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::CallId: {
+                const auto& x = *expr.cast<wasm::Call>();
+                children(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::CallIndirectId: {
+                const auto& x = *expr.cast<wasm::CallIndirect>();
+                child(x.target);
+                children(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::LocalSetId: {
+                const auto& x = *expr.cast<wasm::LocalSet>();
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::GlobalSetId: {
+                const auto& x = *expr.cast<wasm::GlobalSet>();
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::LoadId: {
+                const auto& x = *expr.cast<wasm::Load>();
+                child(x.ptr);
+                break;
+            }
+            case wasm::Expression::Id::StoreId: {
+                const auto& x = *expr.cast<wasm::Store>();
+                child(x.ptr);
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::UnaryId: {
+                const auto& x = *expr.cast<wasm::Unary>();
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::BinaryId: {
+                const auto& x = *expr.cast<wasm::Binary>();
+                child(x.left);
+                child(x.right);
+                break;
+            }
+            case wasm::Expression::Id::SelectId: {
+                const auto& x = *expr.cast<wasm::Select>();
+                child(x.ifTrue);
+                child(x.ifFalse);
+                child(x.condition);
+                break;
+            }
+            case wasm::Expression::Id::DropId: {
+                const auto& x = *expr.cast<wasm::Drop>();
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::ReturnId: {
+                const auto& x = *expr.cast<wasm::Return>();
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::MemoryGrowId: {
+                const auto& x = *expr.cast<wasm::MemoryGrow>();
+                child(x.delta);
+                break;
+            }
+            case wasm::Expression::Id::AtomicRMWId: {
+                const auto& x = *expr.cast<wasm::AtomicRMW>();
+                child(x.ptr);
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::AtomicCmpxchgId: {
+                const auto& x = *expr.cast<wasm::AtomicCmpxchg>();
+                child(x.ptr);
+                child(x.expected);
+                child(x.replacement);
+                break;
+            }
+            case wasm::Expression::Id::AtomicWaitId: {
+                const auto& x = *expr.cast<wasm::AtomicWait>();
+                child(x.ptr);
+                child(x.expected);
+                child(x.timeout);
+                break;
+            }
+            case wasm::Expression::Id::AtomicNotifyId: {
+                const auto& x = *expr.cast<wasm::AtomicNotify>();
+                child(x.ptr);
+                child(x.notifyCount);
+                break;
+            }
+            case wasm::Expression::Id::SIMDExtractId: {
+                const auto& x = *expr.cast<wasm::SIMDExtract>();
+                child(x.vec);
+                break;
+            }
+            case wasm::Expression::Id::SIMDReplaceId: {
+                const auto& x = *expr.cast<wasm::SIMDReplace>();
+                child(x.vec);
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::SIMDShuffleId: {
+                const auto& x = *expr.cast<wasm::SIMDShuffle>();
+                child(x.left);
+                child(x.right);
+                break;
+            }
+            case wasm::Expression::Id::SIMDTernaryId: {
+                const auto& x = *expr.cast<wasm::SIMDTernary>();
+                child(x.a);
+                child(x.b);
+                child(x.c);
+                break;
+            }
+            case wasm::Expression::Id::SIMDShiftId: {
+                const auto& x = *expr.cast<wasm::SIMDShift>();
+                child(x.vec);
+                child(x.shift);
+                break;
+            }
+            case wasm::Expression::Id::SIMDLoadId: {
+                const auto& x = *expr.cast<wasm::SIMDLoad>();
+                child(x.ptr);
+                break;
+            }
+            case wasm::Expression::Id::MemoryInitId: {
+                const auto& x = *expr.cast<wasm::MemoryInit>();
+                child(x.dest);
+                child(x.offset);
+                child(x.size);
+                break;
+            }
+            case wasm::Expression::Id::MemoryCopyId: {
+                const auto& x = *expr.cast<wasm::MemoryCopy>();
+                child(x.dest);
+                child(x.source);
+                child(x.size);
+                break;
+            }
+            case wasm::Expression::Id::MemoryFillId: {
+                const auto& x = *expr.cast<wasm::MemoryFill>();
+                child(x.dest);
+                child(x.value);
+                child(x.size);
+                break;
+            }
+            case wasm::Expression::Id::RefIsNullId: {
+                const auto& x = *expr.cast<wasm::RefIsNull>();
+                child(x.value);
+                break;
+            }
+            case wasm::Expression::Id::TryId: {
+                const auto& x = *expr.cast<wasm::Try>();
+                child(x.body);
+                child(x.catchBody);
+                break;
+            }
+            case wasm::Expression::Id::ThrowId: {
+                const auto& x = *expr.cast<wasm::Throw>();
+                children(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::RethrowId: {
+                const auto& x = *expr.cast<wasm::Rethrow>();
+                child(x.exnref);
+                break;
+            }
+            case wasm::Expression::Id::BrOnExnId: {
+                const auto& x = *expr.cast<wasm::BrOnExn>();
+                child(x.exnref);
+                break;
+            }
+            case wasm::Expression::Id::TupleMakeId: {
+                const auto& x = *expr.cast<wasm::TupleMake>();
+                children(x.operands);
+                break;
+            }
+            case wasm::Expression::Id::TupleExtractId: {
+                const auto& x = *expr.cast<wasm::TupleExtract>();
+                child(x.tuple);
+                break;
+            }
+            case wasm::Expression::Id::LocalGetId:
+            case wasm::Expression::Id::GlobalGetId:
+            case wasm::Expression::Id::ConstId:
+            case wasm::Expression::Id::MemorySizeId:
+            case wasm::Expression::Id::NopId:
+            case wasm::Expression::Id::UnreachableId:
+            case wasm::Expression::Id::AtomicFenceId:
+            case wasm::Expression::Id::DataDropId:
+            case wasm::Expression::Id::PopId:
+            case wasm::Expression::Id::RefNullId:
+            case wasm::Expression::Id::RefFuncId: {
+                // No operands
+                break;
+            }
+            default: {
+                WASM_UNREACHABLE("unknown expression id");
+            }
+        }
+    }
+
+    // Walks the tree under `root` in post-order with an explicit stack, so that deep trees do not overflow the call stack.
+    // `enter(expr)` is called in pre-order and returns whether to walk the operands of `expr`.
+    // `leave(expr)` is called in post-order.
+    template <typename Expression, typename Enter, typename Leave>
+    inline void walk_post_order(Expression* root, Enter&& enter, Leave&& leave) {
+        struct Entry {
+            Expression* expr;
+            bool expanded;
+        };
+
+        if (root == nullptr) {
+            return;
+        }
+
+        std::vector<Entry> stack{};
+        stack.push_back({root, false});
+
+        while (!stack.empty()) {
+            auto& top = stack.back();
+
+            if (top.expanded) {
+                Expression* expr = top.expr;
+                stack.pop_back();
+
+                leave(*expr);
+                continue;
+            }
+
+            top.expanded = true;
+
+            Expression* expr = top.expr;
+            if (!enter(*expr)) {
+                continue;
+            }
+
+            // Push operands in reverse order so that the first operand is on the top
+            const auto mark = stack.size();
+
+            for_each_child(*expr, [&](wasm::Expression* child) {
+                stack.push_back({child, false});
+            });
+
+            std::reverse(std::begin(stack) + mark, std::end(stack));
+        }
+    }
+} // namespace kyut
+
+#endif // INCLUDE_kyut_wasm_ext_Traversal_hpp
@@ -1,6 +1,8 @@
 #include <fmt/printf.h>
 #include "cmdline.h"
-#include "pass.h"
+#include "kyut/wasm-ext/ParallelReader.hpp"
+#include "kyut/wasm-ext/ParallelWriter.hpp"
+#include "kyut/wasm-ext/Traversal.hpp"
 #include "wasm-io.h"
 #include "wasm-validator.h"
 
@@ -208,7 +210,7 @@ namespace {
         }
     }
 
-    class FunctionCallVisitor : public wasm::OverriddenVisitor<FunctionCallVisitor, void> {
+    class FunctionCallVisitor {
         wasm::Module& module_;
         std::uint32_t data_offset_;
 
@@ -218,45 +220,7 @@ namespace {
             , data_offset_(data_offset) {
         }
 
-        void visit(const wasm::ExpressionList& l) {
-            for (const auto& p : l) {
-                visit(p);
-            }
-        }
-
-        void visit(wasm::Expression* p) {
-            if (p) {
-                wasm::OverriddenVisitor<FunctionCallVisitor, void>::visit(p);
-            }
-        }
-
-        void visitBlock(wasm::Block* p) {
-            visit(p->list);
-        }
-
-        void visitIf(wasm::If* p) {
-            visit(p->condition);
-            visit(p->ifTrue);
-            visit(p->ifFalse);
-        }
-
-        void visitLoop(wasm::Loop* p) {
-            visit(p->body);
-        }
-
-        void visitBreak(wasm::Break* p) {
-            visit(p->value);
-            visit(p->condition);
-        }
-
-        void visitSwitch(wasm::Switch* p) {
-            visit(p->condition);
-            visit(p->value);
-        }
-
         void visitCall(wasm::Call* p) {
-            visit(p->operands);
-
             const auto f = module_.getFunctionOrNull(p->target);
             if (f == nullptr || f->body != nullptr) {
                 return;
@@ -267,186 +231,16 @@ namespace {
             modify_call(module_, data_offset_, *p);
         }
 
-        void visitCallIndirect(wasm::CallIndirect* p) {
-            visit(p->target);
-            visit(p->operands);
-        }
-
-        void visitLocalGet([[maybe_unused]] wasm::LocalGet* p) {
-        }
-
-        void visitLocalSet(wasm::LocalSet* p) {
-            visit(p->value);
-        }
-
-        void visitGlobalGet([[maybe_unused]] wasm::GlobalGet* p) {
-        }
-
-        void visitGlobalSet(wasm::GlobalSet* p) {
-            visit(p->value);
-        }
-
-        void visitLoad(wasm::Load* p) {
-            visit(p->ptr);
-        }
-
-        void visitStore(wasm::Store* p) {
-            visit(p->ptr);
-            visit(p->value);
-        }
-
-        void visitConst([[maybe_unused]] wasm::Const* p) {
-        }
-
-        void visitUnary(wasm::Unary* p) {
-            visit(p->value);
-        }
-
-        void visitBinary(wasm::Binary* p) {
-            visit(p->left);
-            visit(p->right);
-        }
-
-        void visitSelect(wasm::Select* p) {
-            visit(p->ifTrue);
-            visit(p->ifFalse);
-            visit(p->condition);
-        }
-
-        void visitDrop(wasm::Drop* p) {
-            visit(p->value);
-        }
-
-        void visitReturn(wasm::Return* p) {
-            visit(p->value);
-        }
-
-        void visitMemorySize([[maybe_unused]] wasm::MemorySize* p) {
-        }
-
-        void visitMemoryGrow(wasm::MemoryGrow* p) {
-            visit(p->delta);
-        }
-
-        void visitNop([[maybe_unused]] wasm::Nop* p) {
-        }
-
-        void visitUnreachable([[maybe_unused]] wasm::Unreachable* p) {
-        }
-
-        void visitAtomicRMW(wasm::AtomicRMW* p) {
-            visit(p->ptr);
-            visit(p->value);
-        }
-
-        void visitAtomicCmpxchg(wasm::AtomicCmpxchg* p) {
-            visit(p->ptr);
-            visit(p->expected);
-            visit(p->replacement);
-        }
-
-        void visitAtomicWait(wasm::AtomicWait* p) {
-            visit(p->ptr);
-            visit(p->expected);
-            visit(p->timeout);
-        }
-
-        void visitAtomicNotify(wasm::AtomicNotify* p) {
-            visit(p->ptr);
-            visit(p->notifyCount);
-        }
-
-        void visitAtomicFence([[maybe_unused]] wasm::AtomicFence* p) {
-        }
-
-        void visitSIMDExtract(wasm::SIMDExtract* p) {
-            visit(p->vec);
-        }
-
-        void visitSIMDReplace(wasm::SIMDReplace* p) {
-            visit(p->vec);
-            visit(p->value);
-        }
-
-        void visitSIMDShuffle(wasm::SIMDShuffle* p) {
-            visit(p->left);
-            visit(p->right);
-        }
-
-        void visitSIMDTernary(wasm::SIMDTernary* p) {
-            visit(p->a);
-            visit(p->b);
-            visit(p->c);
-        }
-
-        void visitSIMDShift(wasm::SIMDShift* p) {
-            visit(p->vec);
-            visit(p->shift);
-        }
-
-        void visitSIMDLoad(wasm::SIMDLoad* p) {
-            visit(p->ptr);
-        }
-
-        void visitMemoryInit(wasm::MemoryInit* p) {
-            visit(p->dest);
-            visit(p->offset);
-            visit(p->size);
-        }
-
-        void visitDataDrop([[maybe_unused]] wasm::DataDrop* p) {
-        }
-
-        void visitMemoryCopy(wasm::MemoryCopy* p) {
-            visit(p->dest);
-            visit(p->source);
-            visit(p->size);
-        }
-
-        void visitMemoryFill(wasm::MemoryFill* p) {
-            visit(p->dest);
-            visit(p->value);
-            visit(p->size);
-        }
-
-        void visitPop([[maybe_unused]] wasm::Pop* p) {
-        }
-
-        void visitRefNull([[maybe_unused]] wasm::RefNull* p) {
-        }
-
-        void visitRefIsNull(wasm::RefIsNull* p) {
-            visit(p->value);
-        }
-
-        void visitRefFunc([[maybe_unused]] wasm::RefFunc* p) {
-        }
-
-        void visitTry(wasm::Try* p) {
-            visit(p->body);
-            visit(p->catchBody);
-        }
-
-        void visitThrow(wasm::Throw* p) {
-            visit(p->operands);
-        }
-
-        void visitRethrow([[maybe_unused]] wasm::Rethrow* p) {
-        }
-
-        void visitBrOnExn([[maybe_unused]] wasm::BrOnExn* p) {
-        }
-
-        void visitTupleMake(wasm::TupleMake* p) {
-            visit(p->operands);
-        }
-
-        void visitTupleExtract(wasm::TupleExtract* p) {
-            visit(p->tuple);
-        }
-
         void visitFunction(wasm::Function* f) {
-            visit(f->body);
+            // Calls are modified after their operands are visited, so the new operands are not visited
+            kyut::walk_post_order(
+                f->body,
+                [](const wasm::Expression& p) { return !p.is<wasm::Rethrow>() && !p.is<wasm::BrOnExn>(); },
+                [&](wasm::Expression& p) {
+                    if (const auto call = p.dynCast<wasm::Call>()) {
+                        visitCall(call);
+                    }
+                });
         }
     };
 } // namespace
@@ -459,6 +253,8 @@ int main(int argc, char* argv[]) {
 
     options.add<std::string>("output", 'o', "Output filename", true);
     options.add<std::string>("watermark", 'w', "Watermark to embed", true);
+    options.add<std::size_t>("jobs", 'j', "Number of threads", false, 1);
+    options.add<std::string>("reader", 0, "Module reader (binaryen, parallel)", false, "binaryen", cmdline::oneof<std::string>("binaryen", "parallel"));
     options.add("debug", 'd', "Preserve debug info");
 
     options.set_program_name(program_name);
@@ -498,11 +294,16 @@ int main(int argc, char* argv[]) {
     const auto input = options.rest()[0];
     const auto output = options.get<std::string>("output");
     const auto watermark = options.get<std::string>("watermark");
+    const auto jobs = options.get<std::size_t>("jobs");
+    const auto read_jobs = options.get<std::string>("reader") == "parallel" ? jobs : 1;
     const auto preserve_debug = options.exist("debug");
 
     try {
+        // Declared first, as it owns the bodies it reads in parallel
+        kyut::ParallelReader reader{};
+
         wasm::Module module{};
-        wasm::ModuleReader{}.read(input, module);
+        reader.read(input, module, read_jobs);
 
         // Insert a watermark data
         const std::uint32_t offset = insert_data(module, watermark);
@@ -527,9 +328,7 @@ int main(int argc, char* argv[]) {
             std::exit(EXIT_FAILURE);
         }
 
-        wasm::ModuleWriter w{};
-        w.setDebugInfo(preserve_debug);
-        w.writeBinary(module, output);
+        kyut::write_binary(module, output, preserve_debug, jobs);
     } catch (const std::exception& e) {
         fmt::print(std::cerr, "error: {}\n", e.what());
         std::exit(EXIT_FAILURE);
@@ -1,8 +1,12 @@
 #include <fmt/printf.h>
 #include "cmdline.h"
+#include "kyut/methods/BinaryExportReordering.hpp"
 #include "kyut/methods/ExportReordering.hpp"
 #include "kyut/methods/FunctionReordering.hpp"
 #include "kyut/methods/OperandSwapping.hpp"
+#include "kyut/methods/RawFunctionReordering.hpp"
+#include "kyut/methods/SectionReordering.hpp"
+#include "kyut/wasm-ext/ParallelReader.hpp"
 #include "wasm-io.h"
 
 namespace {
@@ -16,8 +20,10 @@ int main(int argc, char* argv[]) {
     options.add("help", 'h', "Print help message");
     options.add("version", 'v', "Print version");
 
-    options.add<std::string>("method", 'm', "Embedding method (function-reorder, export-reorder, operand-swap)", true, "", cmdline::oneof<std::string>("function-reorder", "export-reorder", "operand-swap"));
-    options.add<std::size_t>("chunk-size", 'c', "Chunk size [2~20]", false, 20, cmdline::range<std::size_t>(2, 20));
+    options.add<std::string>("method", 'm', "Embedding method (function-reorder, function-reorder-raw, export-reorder, section-reorder, operand-swap)", true, "", cmdline::oneof<std::string>("function-reorder", "function-reorder-raw", "export-reorder", "section-reorder", "operand-swap"));
+    options.add<std::size_t>("chunk-size", 'c', "Chunk size [2~4096]", false, 20, cmdline::range<std::size_t>(2, kyut::max_chunk_size));
+    options.add<std::size_t>("jobs", 'j', "Number of threads", false, 1);
+    options.add<std::string>("reader", 0, "Module reader (binaryen, parallel)", false, "binaryen", cmdline::oneof<std::string>("binaryen", "parallel"));
     options.add<std::string>("dump", 0, "Output format (ascii, hex)", false, "ascii", cmdline::oneof<std::string>("ascii", "hex"));
 
     options.set_program_name(program_name);
@@ -43,23 +49,45 @@ int main(int argc, char* argv[]) {
     const auto input = options.rest()[0];
     const auto method = options.get<std::string>("method");
     const auto chunk_size = options.get<std::size_t>("chunk-size");
+    const auto jobs = options.get<std::size_t>("jobs");
+    const auto read_jobs = options.get<std::string>("reader") == "parallel" ? jobs : 1;
     const auto dump_format = options.get<std::string>("dump");
 
     try {
-        wasm::Module module{};
-        wasm::ModuleReader{}.read(input, module);
-
         kyut::BitStreamWriter w{};
 
         std::size_t size_bits;
-        if (method == "function-reorder") {
-            size_bits = kyut::methods::function_reordering::extract(w, module, chunk_size);
-        } else if (method == "export-reorder") {
+        if (method == "export-reorder" && wasm::ModuleReader{}.isBinaryFile(input)) {
+            // Only the export section is read; text modules are parsed below
+            const auto module = kyut::binary::read_module(input);
+
             size_bits = kyut::methods::export_reordering::extract(w, module, chunk_size);
-        } else if (method == "operand-swap") {
-            size_bits = kyut::methods::operand_swapping::extract(w, module);
+        } else if (method == "function-reorder-raw") {
+            // Only the function and code sections are read
+            const auto module = kyut::binary::read_module(input);
+
+            size_bits = kyut::methods::raw_function_reordering::extract(w, module, chunk_size, jobs);
+        } else if (method == "section-reorder") {
+            // Function bodies are not read
+            const auto module = kyut::binary::read_module(input);
+
+            size_bits = kyut::methods::section_reordering::extract(w, module, chunk_size);
         } else {
-            WASM_UNREACHABLE(("unknown method: " + method).c_str());
+            // Declared first, as it owns the bodies it reads in parallel
+            kyut::ParallelReader reader{};
+
+            wasm::Module module{};
+            reader.read(input, module, read_jobs);
+
+            if (method == "function-reorder") {
+                size_bits = kyut::methods::function_reordering::extract(w, module, chunk_size, jobs);
+            } else if (method == "export-reorder") {
+                size_bits = kyut::methods::export_reordering::extract(w, module, chunk_size);
+            } else if (method == "operand-swap") {
+                size_bits = kyut::methods::operand_swapping::extract(w, module, jobs);
+            } else {
+                WASM_UNREACHABLE(("unknown method: " + method).c_str());
+            }
         }
 
         fmt::print("{} bits\n", size_bits);
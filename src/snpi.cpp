@@ -1,8 +1,12 @@
 #include <fmt/printf.h>
 #include "cmdline.h"
+#include "kyut/methods/BinaryExportReordering.hpp"
 #include "kyut/methods/ExportReordering.hpp"
 #include "kyut/methods/FunctionReordering.hpp"
 #include "kyut/methods/OperandSwapping.hpp"
+#include "kyut/methods/RawFunctionReordering.hpp"
+#include "kyut/methods/SectionReordering.hpp"
+#include "kyut/wasm-ext/ModuleSource.hpp"
 #include "wasm-io.h"
 
 namespace {
@@ -17,10 +21,12 @@ int main(int argc, char* argv[]) {
     options.add("version", 'v', "Print version");
 
     options.add<std::string>("output", 'o', "Output filename", true);
-    options.add<std::string>("method", 'm', "Embedding method (function-reorder, export-reorder, operand-swap, null)", true, "", cmdline::oneof<std::string>("function-reorder", "export-reorder", "operand-swap", "null"));
+    options.add<std::string>("method", 'm', "Embedding method (function-reorder, function-reorder-raw, export-reorder, section-reorder, operand-swap, null)", true, "", cmdline::oneof<std::string>("function-reorder", "function-reorder-raw", "export-reorder", "section-reorder", "operand-swap", "null"));
     options.add<std::string>("watermark", 'w', "Watermark to embed", true);
-    options.add<std::size_t>("chunk-size", 'c', "Chunk size [2~20]", false, 20, cmdline::range<std::size_t>(2, 20));
+    options.add<std::size_t>("chunk-size", 'c', "Chunk size [2~4096]", false, 20, cmdline::range<std::size_t>(2, kyut::max_chunk_size));
     options.add<std::size_t>("limit", 'l', "Embedding limit", false, std::size_t(-1));
+    options.add<std::size_t>("jobs", 'j', "Number of threads", false, 1);
+    options.add<std::string>("reader", 0, "Module reader (binaryen, parallel)", false, "binaryen", cmdline::oneof<std::string>("binaryen", "parallel"));
     options.add("debug", 'd', "Preserve debug info");
 
     options.set_program_name(program_name);
@@ -63,30 +69,62 @@ int main(int argc, char* argv[]) {
     const auto watermark = options.get<std::string>("watermark");
     const auto chunk_size = options.get<std::size_t>("chunk-size");
     const auto limit = options.get<std::size_t>("limit");
+    const auto jobs = options.get<std::size_t>("jobs");
+    const auto read_jobs = options.get<std::string>("reader") == "parallel" ? jobs : 1;
     const auto preserve_debug = options.exist("debug");
 
     try {
+        // Exports of a text module are reordered in the IR
+        const auto binary_export_reorder = method == "export-reorder" && wasm::ModuleReader{}.isBinaryFile(input);
+
+        if (binary_export_reorder || method == "function-reorder-raw" || method == "section-reorder") {
+            // Methods on the binary; sections they do not change are copied as they are
+            auto module = kyut::binary::read_module(input);
+
+            kyut::CircularBitStreamReader r{watermark};
+
+            std::size_t size_bits;
+            if (method == "export-reorder") {
+                size_bits = kyut::methods::export_reordering::embed(r, module, limit, chunk_size);
+            } else if (method == "function-reorder-raw") {
+                size_bits = kyut::methods::raw_function_reordering::embed(r, module, limit, chunk_size, jobs);
+            } else {
+                size_bits = kyut::methods::section_reordering::embed(r, module, limit, chunk_size, jobs);
+            }
+
+            kyut::binary::write_module(module, output, preserve_debug);
+
+            fmt::print("{} bits\n", size_bits);
+            return EXIT_SUCCESS;
+        }
+
+        // Bodies of the functions no method modifies are copied from the input
+        kyut::ModuleSource source{};
+
         wasm::Module module{};
-        wasm::ModuleReader{}.read(input, module);
+        source.read(input, module, read_jobs);
 
         kyut::CircularBitStreamReader r{watermark};
 
         std::size_t size_bits;
         if (method == "function-reorder") {
-            size_bits = kyut::methods::function_reordering::embed(r, module, limit, chunk_size);
+            size_bits = kyut::methods::function_reordering::embed(r, module, limit, chunk_size, jobs);
         } else if (method == "export-reorder") {
             size_bits = kyut::methods::export_reordering::embed(r, module, limit, chunk_size);
         } else if (method == "operand-swap") {
-            size_bits = kyut::methods::operand_swapping::embed(r, module, limit);
+            std::vector<wasm::Function*> modified{};
+            size_bits = kyut::methods::operand_swapping::embed(r, module, limit, jobs, modified);
+
+            for (const auto f : modified) {
+                source.mark_modified(*f);
+            }
         } else if (method == "null") {
             size_bits = 0; /* Don't do anything */
         } else {
             WASM_UNREACHABLE(("unknown method: " + method).c_str());
         }
 
-        wasm::ModuleWriter w{};
-        w.setDebugInfo(preserve_debug);
-        w.writeBinary(module, output);
+        source.write(module, output, preserve_debug, jobs);
 
         fmt::print("{} bits\n", size_bits);
     } catch (const std::exception& e) {
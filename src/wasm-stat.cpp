@@ -1,10 +1,131 @@
+#include <algorithm>
+#include <filesystem>
+#include <optional>
 #include <fmt/printf.h>
 #include "cmdline.h"
+#include "kyut/Parallel.hpp"
+#include "kyut/binary/Stats.hpp"
+#include "kyut/methods/BinaryExportReordering.hpp"
+#include "kyut/methods/ExportReordering.hpp"
+#include "kyut/methods/FunctionReordering.hpp"
+#include "kyut/methods/OperandSwapping.hpp"
+#include "kyut/methods/RawFunctionReordering.hpp"
+#include "kyut/methods/SectionReordering.hpp"
+#include "kyut/wasm-ext/ModuleStats.hpp"
 #include "wasm-io.h"
 
 namespace {
     const std::string program_name = "wasm-stat";
     const std::string version = "0.1.0";
+
+    // Capacity of each method in bits, or nullopt if the method cannot embed into the module
+    using Capacities = std::vector<std::pair<std::string_view, std::optional<std::size_t>>>;
+
+    struct FileStats {
+        kyut::binary::ModuleStats stats;
+        Capacities capacities;
+    };
+
+    // Files given, and the .wasm files under directories given, in a stable order
+    std::vector<std::string> list_files(const std::vector<std::string>& inputs) {
+        std::vector<std::string> files{};
+
+        for (const auto& input : inputs) {
+            if (!std::filesystem::is_directory(input)) {
+                files.emplace_back(input);
+                continue;
+            }
+
+            std::vector<std::string> found{};
+            for (const auto& entry : std::filesystem::recursive_directory_iterator{input}) {
+                if (entry.is_regular_file() && entry.path().extension() == ".wasm") {
+                    found.emplace_back(entry.path().string());
+                }
+            }
+
+            std::sort(std::begin(found), std::end(found));
+            files.insert(std::end(files), std::begin(found), std::end(found));
+        }
+
+        return files;
+    }
+
+    // Reads the whole module, unlike `kyut::binary::scan_module`
+    Capacities read_capacities(const std::string& filename, std::size_t chunk_size, std::size_t num_threads) {
+        wasm::Module module{};
+        wasm::ModuleReader{}.read(filename, module);
+
+        // Methods on the binary are not supported by text modules, and reject modules they cannot rewrite
+        std::optional<kyut::binary::Module> binary{};
+        if (wasm::ModuleReader{}.isBinaryFile(filename)) {
+            binary.emplace(kyut::binary::read_module(filename));
+        }
+
+        const auto binary_capacity = [&](auto f) -> std::optional<std::size_t> {
+            if (!binary) {
+                return std::nullopt;
+            }
+
+            try {
+                return f(*binary);
+            } catch (const std::runtime_error&) {
+                return std::nullopt;
+            }
+        };
+
+        return {
+            {"function-reorder", kyut::methods::function_reordering::capacity(module, chunk_size, num_threads)},
+            {"function-reorder-raw", binary_capacity([&](const kyut::binary::Module& b) {
+                 return kyut::methods::raw_function_reordering::capacity(b, chunk_size, num_threads);
+             })},
+            {"export-reorder",
+             binary ? kyut::methods::export_reordering::capacity(*binary, chunk_size) : kyut::methods::export_reordering::capacity(module, chunk_size)},
+            {"section-reorder", binary_capacity([&](const kyut::binary::Module& b) {
+                 return kyut::methods::section_reordering::capacity(b, chunk_size);
+             })},
+            {"operand-swap", kyut::methods::operand_swapping::capacity(module, num_threads)},
+        };
+    }
+
+    std::string json_string(std::string_view s) {
+        std::string result{"\""};
+
+        for (const auto c : s) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                result += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+            } else {
+                result += c;
+            }
+        }
+
+        return result + '"';
+    }
+
+    void print_json(const std::string& filename, const FileStats& s, bool first) {
+        fmt::print(
+            "{}\n  {{\"file\": {}, \"functions\": {}, \"exports\": {}, \"imports\": {}",
+            first ? "[" : ",",
+            json_string(filename),
+            s.stats.functions,
+            s.stats.exports,
+            s.stats.imports);
+
+        if (!s.capacities.empty()) {
+            fmt::print(", \"capacity\": {{");
+
+            for (std::size_t i = 0; i < s.capacities.size(); i++) {
+                const auto& [method, bits] = s.capacities[i];
+                fmt::print("{}\"{}\": {}", i == 0 ? "" : ", ", method, bits ? std::to_string(*bits) : "null");
+            }
+
+            fmt::print("}}");
+        }
+
+        fmt::print("}}");
+    }
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -13,9 +134,13 @@ int main(int argc, char* argv[]) {
     options.add("help", 'h', "Print help message");
     options.add("version", 'v', "Print version");
     options.add("quiet", 'q', "Only display numbers");
+    options.add("capacity", 0, "Display the capacity of each embedding method; reads whole modules");
+    options.add<std::size_t>("chunk-size", 'c', "Chunk size of capacities [2~4096]", false, 20, cmdline::range<std::size_t>(2, kyut::max_chunk_size));
+    options.add("json", 0, "Output in JSON");
+    options.add<std::size_t>("jobs", 'j', "Number of threads", false, 1);
 
     options.set_program_name(program_name);
-    options.footer("filename");
+    options.footer("filename|directory...");
 
     // Parse command line arguments.
     // Exit the program if help flag is specified or arguments are invalid.
@@ -34,47 +159,99 @@ int main(int argc, char* argv[]) {
         std::exit(EXIT_FAILURE);
     }
 
-    if (options.rest().size() > 1) {
-        // Too many input files.
-        fmt::print(std::cerr, "too many input files\n");
-        fmt::print(std::cerr, "{}", options.usage());
-        std::exit(EXIT_FAILURE);
-    }
-
-    const auto input = options.rest()[0];
     const bool quiet = options.exist("quiet");
+    const bool with_capacity = options.exist("capacity");
+    const auto chunk_size = options.get<std::size_t>("chunk-size");
+    const bool json = options.exist("json");
+    const auto jobs = options.get<std::size_t>("jobs");
 
     try {
-        wasm::Module module{};
-        wasm::ModuleReader{}.read(input, module);
+        const auto files = list_files(options.rest());
+
+        // A single file is reported as it was before multiple inputs were accepted
+        const bool single = options.rest().size() == 1 && files.size() == 1 && files[0] == options.rest()[0];
+
+        // Files are processed in parallel, or a single one with all threads
+        const auto jobs_per_file = files.size() == 1 ? jobs : 1;
+
+        std::vector<std::optional<FileStats>> stats(files.size());
+        std::vector<std::string> errors(files.size());
+
+        kyut::parallel_for(files.size(), jobs, [&](std::size_t i) {
+            try {
+                FileStats s{kyut::read_module_stats(files[i]), {}};
 
-        std::size_t num_imports = 0;
-        for (const auto& f : module.functions) {
-            if (f->body == nullptr) {
-                num_imports += 1;
+                if (with_capacity) {
+                    s.capacities = read_capacities(files[i], chunk_size, jobs_per_file);
+                }
+
+                stats[i] = std::move(s);
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            } catch (const wasm::ParseException& e) {
+                errors[i] = e.text;
+            }
+        });
+
+        bool failed = false;
+        bool first = true;
+        for (std::size_t i = 0; i < files.size(); i++) {
+            if (!stats[i]) {
+                fmt::print(std::cerr, "error: {}: {}\n", files[i], errors[i]);
+                failed = true;
+                continue;
+            }
+
+            const auto& s = stats[i]->stats;
+            const auto& capacities = stats[i]->capacities;
+
+            if (json) {
+                print_json(files[i], *stats[i], first);
+                first = false;
+            } else if (!quiet) {
+                if (!single) {
+                    fmt::print("{}:\n", files[i]);
+                }
+
+                fmt::print(
+                    "functions: {}\n"
+                    "exports: {}\n"
+                    "imports: {}\n",
+                    s.functions,
+                    s.exports,
+                    s.imports);
+
+                for (const auto& [method, bits] : capacities) {
+                    fmt::print("{}: {}\n", method, bits ? fmt::format("{} bits", *bits) : "unsupported");
+                }
+            } else {
+                fmt::print(
+                    "{}\t{}\t{}",
+                    s.functions,
+                    s.exports,
+                    s.imports);
+
+                for (const auto& [method, bits] : capacities) {
+                    fmt::print("\t{}", bits ? std::to_string(*bits) : "-");
+                }
+
+                if (!single) {
+                    fmt::print("\t{}", files[i]);
+                }
+
+                fmt::print("\n");
             }
         }
 
-        if (!quiet) {
-            fmt::print(
-                "functions: {}\n"
-                "exports: {}\n"
-                "imports: {}\n",
-                module.functions.size(),
-                module.exports.size(),
-                num_imports);
-        } else {
-            fmt::print(
-                "{}\t{}\t{}\n",
-                module.functions.size(),
-                module.exports.size(),
-                num_imports);
+        if (json) {
+            fmt::print("{}", first ? "[]\n" : "\n]\n");
+        }
+
+        if (failed) {
+            std::exit(EXIT_FAILURE);
         }
     } catch (const std::exception& e) {
         fmt::print(std::cerr, "error: {}\n", e.what());
         std::exit(EXIT_FAILURE);
-    } catch (const wasm::ParseException& e) {
-        e.dump(std::cerr);
-        std::exit(EXIT_FAILURE);
     }
 }
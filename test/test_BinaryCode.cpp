@@ -0,0 +1,183 @@
+#include "kyut/binary/Code.hpp"
+
+#include <optional>
+#include <vector>
+#include "kyut/binary/Writer.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+    using Bytes = std::vector<std::uint8_t>;
+
+    // Module with two types and a function of each `body`, with its size prefix padded to `size_width` bytes
+    Bytes make_module(const std::vector<Bytes>& bodies, std::size_t size_width = 1) {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        kyut::binary::write_section(bytes, 1, {0x02, 0x60, 0x00, 0x00, 0x60, 0x01, 0x7F, 0x01, 0x7F});
+
+        Bytes functions{static_cast<std::uint8_t>(bodies.size())};
+        functions.insert(std::end(functions), bodies.size(), 0x00);
+        kyut::binary::write_section(bytes, 3, functions);
+
+        Bytes code{};
+        kyut::binary::write_u32(code, static_cast<std::uint32_t>(bodies.size()));
+        for (const auto& body : bodies) {
+            kyut::binary::write_u32(code, static_cast<std::uint32_t>(body.size()), size_width);
+            code.insert(std::end(code), std::begin(body), std::end(body));
+        }
+        kyut::binary::write_section(bytes, 10, code);
+
+        return bytes;
+    }
+
+    // Rewritten first body, with its size prefix
+    std::optional<Bytes> rewrite(const Bytes& body, const kyut::binary::IndexMaps& maps, std::size_t size_width = 1) {
+        const kyut::binary::Module module{make_module({body}, size_width)};
+        const auto code = kyut::binary::read_code(module);
+
+        Bytes out{};
+        if (!kyut::binary::rewrite_body(module, code.at(0), maps, out)) {
+            return std::nullopt;
+        }
+
+        return out;
+    }
+
+    const kyut::binary::IndexMaps identity{{0, 1, 2}, {0, 1}, {0, 1}, {}, {}};
+} // namespace
+
+TEST(kyut, binary_write_leb128) {
+    Bytes out{};
+    kyut::binary::write_u32(out, 0);
+    kyut::binary::write_u32(out, 624485);
+    kyut::binary::write_u32(out, 1, 5);
+    kyut::binary::write_s33(out, 63);
+    kyut::binary::write_s33(out, 64);
+    kyut::binary::write_s33(out, 1, 3);
+
+    EXPECT_EQ(out, (Bytes{0x00, 0xE5, 0x8E, 0x26, 0x81, 0x80, 0x80, 0x80, 0x00, 0x3F, 0xC0, 0x00, 0x81, 0x80, 0x00}));
+
+    kyut::binary::Reader r{out.data(), 9, out.size()};
+    EXPECT_EQ(r.read_s64(), 63);
+    EXPECT_EQ(r.read_s64(), 64);
+    EXPECT_EQ(r.read_s64(), 1);
+    EXPECT_TRUE(r.at_end());
+}
+
+TEST(kyut, binary_read_s64) {
+    const Bytes bytes{0x7F, 0x80, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F};
+
+    kyut::binary::Reader r{bytes.data(), 0, bytes.size()};
+    EXPECT_EQ(r.read_s64(), -1);
+    EXPECT_EQ(r.read_s64(), -128);
+    EXPECT_EQ(r.read_s64(), -1);
+    EXPECT_TRUE(r.at_end());
+}
+
+TEST(kyut, binary_read_code_and_types) {
+    const kyut::binary::Module module{make_module({{0x00, 0x0B}, {0x01, 0x01, 0x7F, 0x0B}}, 3)};
+
+    const auto code = kyut::binary::read_code(module);
+    ASSERT_EQ(code.size(), 2u);
+    EXPECT_EQ(code[0].body_offset - code[0].offset, 3u);
+    EXPECT_EQ(code[0].end - code[0].body_offset, 2u);
+    EXPECT_EQ(code[1].end - code[1].body_offset, 4u);
+
+    const auto types = kyut::binary::read_types(module);
+    ASSERT_EQ(types.size(), 2u);
+    EXPECT_EQ(types[0], std::string_view("\x60\x00\x00", 3));
+    EXPECT_EQ(types[1], std::string_view("\x60\x01\x7F\x01\x7F", 5));
+}
+
+TEST(kyut, binary_rewrite_body_unchanged) {
+    // (local i32) (block (result i32) (call 2) (global.get 1) (i32.const -1) (call_indirect (type 1)) ...)
+    const Bytes body{
+        0x01, 0x01, 0x7F,             // Locals
+        0x02, 0x7F,                   // block (result i32)
+        0x10, 0x82, 0x80, 0x00,       // call 2, padded
+        0x23, 0x01,                   // global.get 1
+        0x41, 0x7F,                   // i32.const -1
+        0x11, 0x01, 0x00,             // call_indirect (type 1)
+        0x1A, 0x1A,                   // drop, drop
+        0x41, 0x00, 0x28, 0x02, 0x10, // i32.load offset=16
+        0x0B,                         // end
+        0x1A,                         // drop
+        0x0B,                         // end
+    };
+
+    Bytes expected{};
+    kyut::binary::write_u32(expected, static_cast<std::uint32_t>(body.size()), 2);
+    expected.insert(std::end(expected), std::begin(body), std::end(body));
+
+    EXPECT_EQ(rewrite(body, identity, 2), expected);
+}
+
+TEST(kyut, binary_rewrite_body_indices) {
+    const Bytes body{
+        0x00,                   // No locals
+        0x02, 0x01,             // block (type 1)
+        0x10, 0x02,             // call 2
+        0x10, 0x80, 0x80, 0x00, // call 0, padded
+        0x11, 0x00, 0x00,       // call_indirect (type 0)
+        0xD2, 0x01,             // ref.func 1
+        0x24, 0x00,             // global.set 0
+        0x0B,                   // end
+        0x0B,                   // end
+    };
+
+    const kyut::binary::IndexMaps maps{{200, 1, 0}, {1, 0}, {1}, {}, {}};
+
+    const Bytes expected{
+        0x12,
+        0x00,
+        0x02, 0x00,
+        0x10, 0x00,
+        0x10, 0xC8, 0x81, 0x00,
+        0x11, 0x01, 0x00,
+        0xD2, 0x01,
+        0x24, 0x01,
+        0x0B,
+        0x0B,
+    };
+
+    EXPECT_EQ(rewrite(body, maps), expected);
+}
+
+TEST(kyut, binary_rewrite_body_failures) {
+    // Index without a new one
+    EXPECT_EQ(rewrite({0x00, 0x10, 0x00, 0x0B}, {{kyut::binary::no_index}, {}, {}, {}, {}}), std::nullopt);
+
+    // Index out of range
+    EXPECT_EQ(rewrite({0x00, 0x23, 0x05, 0x0B}, identity), std::nullopt);
+
+    // GC instruction
+    EXPECT_EQ(rewrite({0x00, 0xFB, 0x00, 0x0B}, identity), std::nullopt);
+
+    // Lane load, numbered differently by the SIMD proposal over time
+    EXPECT_EQ(rewrite({0x00, 0xFD, 0x54, 0x00, 0x00, 0x00, 0x0B}, identity), std::nullopt);
+
+    // SIMD opcode not in the proposal
+    EXPECT_EQ(rewrite({0x00, 0xFD, 0x80, 0x02, 0x0B}, identity), std::nullopt);
+
+    // Instructions after the last end
+    EXPECT_EQ(rewrite({0x00, 0x0B, 0x01, 0x0B}, identity), std::nullopt);
+
+    // Truncated
+    EXPECT_EQ(rewrite({0x00, 0x02, 0x40, 0x0B}, identity), std::nullopt);
+}
+
+TEST(kyut, binary_rewrite_body_simd) {
+    const kyut::binary::IndexMaps maps{{1, 0, 2}, {0, 1}, {0, 1}, {}, {}};
+
+    // (i32.const 0) (prefetch.t offset=16) (v128.const 0) (v128.const 0) (i8x16.swizzle) (drop) (call 0)
+    Bytes body{0x00, 0x41, 0x00, 0xFD, 0xC5, 0x01, 0x00, 0x10, 0xFD, 0x0C};
+    body.insert(std::end(body), 16, 0x00);
+    body.insert(std::end(body), {0xFD, 0x0C});
+    body.insert(std::end(body), 16, 0x00);
+    body.insert(std::end(body), {0xFD, 0x0E, 0x1A, 0x10, 0x00, 0x0B});
+
+    Bytes expected{static_cast<std::uint8_t>(body.size())};
+    expected.insert(std::end(expected), std::begin(body), std::end(body));
+    expected[expected.size() - 2] = 0x01;
+
+    EXPECT_EQ(rewrite(body, maps), expected);
+}
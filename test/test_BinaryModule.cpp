@@ -0,0 +1,279 @@
+#include "kyut/binary/Module.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "kyut/BitStreamWriter.hpp"
+#include "kyut/CircularBitStreamReader.hpp"
+#include "kyut/binary/MappedFile.hpp"
+#include "kyut/binary/Sections.hpp"
+#include "kyut/binary/Stats.hpp"
+#include "kyut/binary/Writer.hpp"
+#include "kyut/methods/BinaryExportReordering.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+    using Bytes = std::vector<std::uint8_t>;
+
+    void append(Bytes& bytes, const Bytes& x) {
+        bytes.insert(std::end(bytes), std::begin(x), std::end(x));
+    }
+
+    void append_name(Bytes& bytes, std::string_view name) {
+        bytes.emplace_back(static_cast<std::uint8_t>(name.size()));
+        bytes.insert(std::end(bytes), std::begin(name), std::end(name));
+    }
+
+    void append_section(Bytes& bytes, std::uint8_t id, const Bytes& payload) {
+        bytes.emplace_back(id);
+        bytes.emplace_back(static_cast<std::uint8_t>(payload.size()));
+        append(bytes, payload);
+    }
+
+    // Module with one function of type `() -> ()`, exported under each of `names`
+    Bytes make_module(const std::vector<std::string_view>& names) {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        append_section(bytes, 1, {0x01, 0x60, 0x00, 0x00});
+        append_section(bytes, 3, {0x01, 0x00});
+
+        Bytes exports{static_cast<std::uint8_t>(names.size())};
+        for (const auto& name : names) {
+            append_name(exports, name);
+            append(exports, {0x00, 0x00});
+        }
+        append_section(bytes, 7, exports);
+
+        append_section(bytes, 10, {0x01, 0x02, 0x00, 0x0B});
+
+        Bytes names_payload{};
+        append_name(names_payload, "name");
+        append(names_payload, {0x00, 0x02, 0x01, 0x66});
+        append_section(bytes, 0, names_payload);
+
+        return bytes;
+    }
+
+    std::vector<std::string_view> export_names(const kyut::binary::Module& module) {
+        std::vector<std::string_view> names{};
+        for (const auto& e : kyut::binary::read_exports(module)) {
+            names.emplace_back(e.name);
+        }
+
+        return names;
+    }
+} // namespace
+
+TEST(kyut, binary_reader_u32) {
+    const Bytes bytes{0x00, 0x7F, 0x80, 0x01, 0xE5, 0x8E, 0x26, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F};
+
+    kyut::binary::Reader r{bytes.data(), 0, bytes.size()};
+
+    EXPECT_EQ(r.read_u32(), 0u);
+    EXPECT_EQ(r.read_u32(), 127u);
+    EXPECT_EQ(r.read_u32(), 128u);
+    EXPECT_EQ(r.read_u32(), 624485u);
+    EXPECT_EQ(r.read_u32(), 0xFFFFFFFFu);
+    EXPECT_TRUE(r.at_end());
+
+    EXPECT_THROW(r.read_byte(), std::runtime_error);
+}
+
+TEST(kyut, binary_reader_u32_malformed) {
+    const Bytes too_long{0xFF, 0xFF, 0xFF, 0xFF, 0x1F};
+    const Bytes truncated{0x80, 0x80};
+
+    EXPECT_THROW((kyut::binary::Reader{too_long.data(), 0, too_long.size()}.read_u32()), std::runtime_error);
+    EXPECT_THROW((kyut::binary::Reader{truncated.data(), 0, truncated.size()}.read_u32()), std::runtime_error);
+}
+
+TEST(kyut, binary_reader_u32_word) {
+    // Integers followed by enough bytes to be decoded a word at a time
+    for (const std::uint32_t x : {0u, 1u, 127u, 128u, 300u, 16383u, 16384u, 624485u, 0x0FFFFFFFu, 0x10000000u, 0xFFFFFFFFu}) {
+        for (std::size_t size = 1; size <= 5; size++) {
+            Bytes bytes{};
+            kyut::binary::write_u32(bytes, x, size);
+
+            const auto encoded_size = bytes.size();
+            bytes.resize(encoded_size + 8, 0xFF);
+
+            kyut::binary::Reader r{bytes.data(), 0, bytes.size()};
+            EXPECT_EQ(r.read_u32(), x);
+            EXPECT_EQ(r.offset(), encoded_size);
+        }
+    }
+
+    const Bytes too_long{0xFF, 0xFF, 0xFF, 0xFF, 0x1F, 0x00, 0x00, 0x00};
+    const Bytes six_bytes{0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0x00, 0x00};
+    const Bytes unterminated{0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+
+    for (const auto& bytes : {too_long, six_bytes, unterminated}) {
+        EXPECT_THROW((kyut::binary::Reader{bytes.data(), 0, bytes.size()}.read_u32()), std::runtime_error);
+    }
+}
+
+TEST(kyut, binary_scan_module) {
+    const auto bytes = make_module({"a", "b", "c"});
+
+    auto stats = kyut::binary::scan_module(bytes.data(), bytes.size());
+    EXPECT_EQ(stats.functions, 1u);
+    EXPECT_EQ(stats.exports, 3u);
+    EXPECT_EQ(stats.imports, 0u);
+
+    // Imports of a function, a global and another function before the module
+    Bytes imports{0x03};
+    for (const auto& [field, desc] : std::vector<std::pair<std::string_view, Bytes>>{{"f", {0x00, 0x00}}, {"g", {0x03, 0x7F, 0x00}}, {"h", {0x00, 0x00}}}) {
+        append_name(imports, "env");
+        append_name(imports, field);
+        append(imports, desc);
+    }
+
+    Bytes with_imports(std::begin(bytes), std::begin(bytes) + 14);
+    append_section(with_imports, 2, imports);
+    with_imports.insert(std::end(with_imports), std::begin(bytes) + 14, std::end(bytes));
+
+    const auto filename = testing::TempDir() + "binary_scan_module.wasm";
+    std::ofstream{filename, std::ios::binary}.write(reinterpret_cast<const char*>(with_imports.data()), with_imports.size());
+
+    stats = kyut::binary::scan_module(filename);
+    EXPECT_EQ(stats.functions, 3u);
+    EXPECT_EQ(stats.exports, 3u);
+    EXPECT_EQ(stats.imports, 2u);
+
+    // Event of type 0 after the type section
+    Bytes with_event(std::begin(bytes), std::begin(bytes) + 14);
+    append_section(with_event, 13, {0x01, 0x00, 0x00});
+    with_event.insert(std::end(with_event), std::begin(bytes) + 14, std::end(bytes));
+
+    stats = kyut::binary::scan_module(with_event.data(), with_event.size());
+    EXPECT_EQ(stats.functions, 1u);
+    EXPECT_EQ(stats.exports, 3u);
+
+    EXPECT_THROW(kyut::binary::scan_module(bytes.data(), 4), std::runtime_error);
+    EXPECT_THROW(kyut::binary::scan_module(bytes.data(), bytes.size() - 1), std::runtime_error);
+    EXPECT_THROW(kyut::binary::scan_module(filename + ".missing"), std::runtime_error);
+}
+
+TEST(kyut, binary_write_file) {
+    // More spans than one `writev` takes, some of them empty
+    std::vector<Bytes> pieces{};
+    for (std::size_t i = 0; i < 5000; i++) {
+        pieces.emplace_back(i % 7, static_cast<std::uint8_t>(i));
+    }
+
+    Bytes expected{};
+    std::vector<kyut::binary::Span> spans{};
+    for (const auto& p : pieces) {
+        append(expected, p);
+        spans.emplace_back(kyut::binary::Span{p.data(), p.size()});
+    }
+
+    const auto filename = testing::TempDir() + "binary_write_file.bin";
+    kyut::binary::write_file(filename, spans);
+
+    const kyut::binary::MappedFile file{filename};
+    EXPECT_EQ(Bytes(file.data(), file.data() + file.size()), expected);
+
+    // Truncates the file
+    kyut::binary::write_file(filename, {});
+    EXPECT_EQ(kyut::binary::MappedFile{filename}.size(), 0u);
+
+    EXPECT_THROW(kyut::binary::write_file(testing::TempDir() + "missing/binary_write_file.bin", spans), std::runtime_error);
+}
+
+TEST(kyut, binary_module_sections) {
+    const kyut::binary::Module module{make_module({"a", "b"})};
+
+    const auto& sections = module.sections();
+    ASSERT_EQ(sections.size(), 5u);
+
+    EXPECT_EQ(sections[0].id, kyut::binary::SectionId::type);
+    EXPECT_EQ(sections[0].offset, 8u);
+    EXPECT_EQ(sections[0].payload_offset, 10u);
+    EXPECT_EQ(sections[0].end, 14u);
+    EXPECT_EQ(sections[4].id, kyut::binary::SectionId::custom);
+    EXPECT_EQ(sections[4].name, "name");
+    EXPECT_EQ(sections[4].end, module.bytes().size());
+
+    EXPECT_EQ(module.find_section(kyut::binary::SectionId::export_), &sections[2]);
+    EXPECT_EQ(module.find_section(kyut::binary::SectionId::data), nullptr);
+    EXPECT_EQ(module.find_section(kyut::binary::SectionId::custom), nullptr);
+
+    EXPECT_EQ(export_names(module), (std::vector<std::string_view>{"a", "b"}));
+}
+
+TEST(kyut, binary_module_event_section) {
+    const auto bytes = make_module({"a"});
+
+    // Event of type 0 after the type section
+    Bytes with_event(std::begin(bytes), std::begin(bytes) + 14);
+    append_section(with_event, 13, {0x01, 0x00, 0x00});
+    with_event.insert(std::end(with_event), std::begin(bytes) + 14, std::end(bytes));
+
+    const kyut::binary::Module module{with_event};
+
+    const auto& sections = module.sections();
+    ASSERT_EQ(sections.size(), 6u);
+    EXPECT_EQ(sections[1].id, kyut::binary::SectionId::event);
+    EXPECT_EQ(module.find_section(kyut::binary::SectionId::event), &sections[1]);
+    EXPECT_EQ(export_names(module), (std::vector<std::string_view>{"a"}));
+}
+
+TEST(kyut, binary_module_malformed) {
+    auto bytes = make_module({"a"});
+    bytes[4] = 0x02;
+    EXPECT_THROW(kyut::binary::Module{bytes}, std::runtime_error);
+
+    bytes = make_module({"a"});
+    bytes.pop_back();
+    EXPECT_THROW(kyut::binary::Module{bytes}, std::runtime_error);
+
+    bytes = make_module({"a"});
+    bytes.push_back(14);
+    bytes.push_back(0);
+    EXPECT_THROW(kyut::binary::Module{bytes}, std::runtime_error);
+}
+
+TEST(kyut, binary_export_reordering) {
+    const std::vector<std::string_view> names{"h", "g", "f", "e", "d", "c", "b", "a"};
+
+    kyut::binary::Module module{make_module(names)};
+    const auto original = module.bytes();
+
+    EXPECT_EQ(kyut::methods::export_reordering::capacity(module, 4), 8u);
+
+    kyut::CircularBitStreamReader r{"\x5A"};
+    const auto embedded_bits = kyut::methods::export_reordering::embed(r, module, std::size_t(-1), 4);
+
+    EXPECT_EQ(embedded_bits, 8u);
+    EXPECT_EQ(module.bytes().size(), original.size());
+
+    // Only the export section changes
+    const auto& exports = *module.find_section(kyut::binary::SectionId::export_);
+    EXPECT_TRUE(std::equal(std::begin(original), std::begin(original) + exports.payload_offset, std::begin(module.bytes())));
+    EXPECT_TRUE(std::equal(std::begin(original) + exports.end, std::end(original), std::begin(module.bytes()) + exports.end));
+
+    auto reordered = export_names(module);
+    EXPECT_NE(reordered, names);
+
+    std::sort(std::begin(reordered), std::end(reordered));
+    EXPECT_EQ(reordered, (std::vector<std::string_view>{"a", "b", "c", "d", "e", "f", "g", "h"}));
+
+    kyut::BitStreamWriter w{};
+    const auto extracted_bits = kyut::methods::export_reordering::extract(w, module, 4);
+
+    EXPECT_EQ(extracted_bits, 8u);
+    EXPECT_EQ(w.data(), (std::vector<std::uint8_t>{0x5A}));
+}
+
+TEST(kyut, binary_export_reordering_no_exports) {
+    kyut::binary::Module module{make_module({})};
+    const auto original = module.bytes();
+
+    kyut::CircularBitStreamReader r{"a"};
+    EXPECT_EQ(kyut::methods::export_reordering::embed(r, module, std::size_t(-1), 20), 0u);
+    EXPECT_EQ(module.bytes(), original);
+
+    kyut::BitStreamWriter w{};
+    EXPECT_EQ(kyut::methods::export_reordering::extract(w, module, 20), 0u);
+}
@@ -0,0 +1,448 @@
+#include "kyut/binary/Reorder.hpp"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "kyut/BitStreamWriter.hpp"
+#include "kyut/CircularBitStreamReader.hpp"
+#include "kyut/binary/Code.hpp"
+#include "kyut/binary/Sections.hpp"
+#include "kyut/binary/Writer.hpp"
+#include "kyut/methods/RawFunctionReordering.hpp"
+#include "kyut/methods/SectionReordering.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+    using Bytes = std::vector<std::uint8_t>;
+
+    constexpr std::uint32_t num_functions = 12;
+
+    // Module importing function 0, and defining functions 1 to `num_functions`.
+    // Function `i` pushes `i` and calls function `i % num_functions + 1`; the exports, the element segment, the start
+    // function and the name section refer to functions by index as well.
+    Bytes make_module() {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        kyut::binary::write_section(bytes, 1, {0x01, 0x60, 0x00, 0x00});
+
+        Bytes imports{0x01};
+        kyut::binary::write_name(imports, "env");
+        kyut::binary::write_name(imports, "f");
+        imports.insert(std::end(imports), {0x00, 0x00});
+        kyut::binary::write_section(bytes, 2, imports);
+
+        Bytes functions{};
+        kyut::binary::write_u32(functions, num_functions);
+        functions.insert(std::end(functions), num_functions, 0x00);
+        kyut::binary::write_section(bytes, 3, functions);
+
+        kyut::binary::write_section(bytes, 4, {0x01, 0x70, 0x00, 0x10});
+
+        Bytes exports{0x02};
+        kyut::binary::write_name(exports, "a");
+        exports.insert(std::end(exports), {0x00, 0x03});
+        kyut::binary::write_name(exports, "b");
+        exports.insert(std::end(exports), {0x00, 0x05});
+        kyut::binary::write_section(bytes, 7, exports);
+
+        kyut::binary::write_section(bytes, 8, {0x07});
+
+        kyut::binary::write_section(bytes, 9, {0x01, 0x00, 0x41, 0x00, 0x0B, 0x03, 0x01, 0x02, 0x0C});
+
+        Bytes code{};
+        kyut::binary::write_u32(code, num_functions);
+        for (std::uint32_t i = 1; i <= num_functions; i++) {
+            const Bytes body{0x00, 0x41, static_cast<std::uint8_t>(i), 0x1A, 0x10, static_cast<std::uint8_t>(i % num_functions + 1), 0x0B};
+
+            kyut::binary::write_u32(code, static_cast<std::uint32_t>(body.size()));
+            code.insert(std::end(code), std::begin(body), std::end(body));
+        }
+        kyut::binary::write_section(bytes, 10, code);
+
+        Bytes function_names{0x02, 0x01};
+        kyut::binary::write_name(function_names, "one");
+        function_names.push_back(0x02);
+        kyut::binary::write_name(function_names, "two");
+
+        Bytes names{};
+        kyut::binary::write_name(names, "name");
+        kyut::binary::write_section(names, 1, function_names);
+        kyut::binary::write_section(bytes, 0, names);
+
+        Bytes dwarf{};
+        kyut::binary::write_name(dwarf, ".debug_info");
+        kyut::binary::write_section(bytes, 0, dwarf);
+
+        return bytes;
+    }
+
+    // Module with entries in every section the section reordering changes, and references to them from each other.
+    // The second active data segment starts at `data_offset`.
+    Bytes make_sections_module(std::uint8_t data_offset) {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        // () -> (), (i32) -> (), () -> (i32)
+        kyut::binary::write_section(bytes, 1, {0x03, 0x60, 0x00, 0x00, 0x60, 0x01, 0x7F, 0x00, 0x60, 0x00, 0x01, 0x7F});
+
+        Bytes imports{0x05};
+        for (const auto& [field, desc] : std::vector<std::pair<std::string_view, Bytes>>{
+                 {"f", {0x00, 0x00}},
+                 {"g", {0x03, 0x7F, 0x00}},
+                 {"h", {0x00, 0x01}},
+                 {"t", {0x01, 0x70, 0x00, 0x10}},
+                 {"k", {0x03, 0x7F, 0x00}},
+             }) {
+            kyut::binary::write_name(imports, "env");
+            kyut::binary::write_name(imports, field);
+            imports.insert(std::end(imports), std::begin(desc), std::end(desc));
+        }
+        kyut::binary::write_section(bytes, 2, imports);
+
+        kyut::binary::write_section(bytes, 3, {0x02, 0x00, 0x02});
+        kyut::binary::write_section(bytes, 5, {0x01, 0x00, 0x01});
+        kyut::binary::write_section(bytes, 13, {0x01, 0x00, 0x01});
+        kyut::binary::write_section(bytes, 6, {0x02, 0x7F, 0x00, 0x41, 0x05, 0x0B, 0x7F, 0x01, 0x23, 0x01, 0x0B});
+
+        Bytes exports{0x02};
+        kyut::binary::write_name(exports, "f");
+        exports.insert(std::end(exports), {0x00, 0x02});
+        kyut::binary::write_name(exports, "g");
+        exports.insert(std::end(exports), {0x03, 0x02});
+        kyut::binary::write_section(bytes, 7, exports);
+
+        kyut::binary::write_section(bytes, 8, {0x02});
+
+        // Two active segments and a passive one
+        kyut::binary::write_section(
+            bytes,
+            9,
+            {0x03, 0x00, 0x41, 0x00, 0x0B, 0x01, 0x00, 0x00, 0x41, 0x04, 0x0B, 0x02, 0x02, 0x03, 0x01, 0x00, 0x01, 0x02});
+
+        kyut::binary::write_section(bytes, 12, {0x03});
+
+        const Bytes body0{
+            0x00,                                                 // No locals
+            0x10, 0x00,                                           // call 0
+            0x41, 0x01, 0x10, 0x01,                               // call 1 (i32.const 1)
+            0x41, 0x00, 0x11, 0x00, 0x00,                         // call_indirect 0 0 (i32.const 0)
+            0x23, 0x02, 0x1A,                                     // drop (global.get 2)
+            0x41, 0x00, 0x41, 0x00, 0x41, 0x01, 0xFC, 0x08, 0x02, 0x00, // memory.init 2 0
+            0xFC, 0x09, 0x02,                                     // data.drop 2
+            0x41, 0x00, 0x41, 0x00, 0x41, 0x01, 0xFC, 0x0C, 0x02, 0x00, // table.init 2 0
+            0xFC, 0x0D, 0x00,                                     // elem.drop 0
+            0x41, 0x07, 0x02, 0x01, 0x1A, 0x0B,                   // block (param i32) drop end
+            0x0B,
+        };
+        const Bytes body1{0x00, 0x41, 0x2A, 0x0B};
+
+        Bytes code{0x02};
+        for (const auto& body : {body0, body1}) {
+            kyut::binary::write_u32(code, static_cast<std::uint32_t>(body.size()));
+            code.insert(std::end(code), std::begin(body), std::end(body));
+        }
+        kyut::binary::write_section(bytes, 10, code);
+
+        kyut::binary::write_section(
+            bytes,
+            11,
+            {0x03, 0x00, 0x41, 0x00, 0x0B, 0x02, 'a', 'b', 0x00, 0x41, data_offset, 0x0B, 0x01, 'c', 0x01, 0x02, 'd', 'e'});
+
+        Bytes function_names{0x02, 0x00};
+        kyut::binary::write_name(function_names, "f");
+        function_names.push_back(0x02);
+        kyut::binary::write_name(function_names, "main");
+
+        Bytes global_names{0x02, 0x00};
+        kyut::binary::write_name(global_names, "g");
+        global_names.push_back(0x03);
+        kyut::binary::write_name(global_names, "x");
+
+        Bytes names{};
+        kyut::binary::write_name(names, "name");
+        kyut::binary::write_section(names, 1, function_names);
+        kyut::binary::write_section(names, 7, global_names);
+        kyut::binary::write_section(bytes, 0, names);
+
+        return bytes;
+    }
+
+    // Module defining functions 0 to 7, function `i` being of type `i % 4` and reading global `i % 2`
+    Bytes make_typed_module() {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        // () -> (), (i32) -> (), () -> (i32), (i64) -> ()
+        kyut::binary::write_section(bytes, 1, {0x04, 0x60, 0x00, 0x00, 0x60, 0x01, 0x7F, 0x00, 0x60, 0x00, 0x01, 0x7F, 0x60, 0x01, 0x7E, 0x00});
+        kyut::binary::write_section(bytes, 3, {0x08, 0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03});
+        kyut::binary::write_section(bytes, 6, {0x02, 0x7F, 0x00, 0x41, 0x05, 0x0B, 0x7F, 0x00, 0x41, 0x06, 0x0B});
+
+        Bytes code{0x08};
+        for (std::uint8_t i = 0; i < 8; i++) {
+            // drop (i32.const i), drop (global.get i % 2)
+            Bytes body{0x00, 0x41, i, 0x1A, 0x23, static_cast<std::uint8_t>(i % 2), 0x1A};
+            if (i % 4 == 2) {
+                body.insert(std::end(body), {0x41, 0x00});
+            }
+            body.push_back(0x0B);
+
+            kyut::binary::write_u32(code, static_cast<std::uint32_t>(body.size()));
+            code.insert(std::end(code), std::begin(body), std::end(body));
+        }
+        kyut::binary::write_section(bytes, 10, code);
+
+        return bytes;
+    }
+
+    std::vector<std::string> types(const kyut::binary::Module& module) {
+        const auto types = kyut::binary::read_types(module);
+
+        return std::vector<std::string>(std::begin(types), std::end(types));
+    }
+
+    std::vector<std::uint32_t> inverse(const std::vector<std::uint32_t>& order) {
+        std::vector<std::uint32_t> result(order.size());
+
+        for (std::size_t i = 0; i < order.size(); i++) {
+            result[order[i]] = static_cast<std::uint32_t>(i);
+        }
+
+        return result;
+    }
+
+    // Original index of each function, by the constant its body pushes
+    std::vector<std::uint32_t> original_indices(const kyut::binary::Module& module) {
+        std::vector<std::uint32_t> indices{0};
+
+        for (const auto& entry : kyut::binary::read_code(module)) {
+            indices.emplace_back(module.bytes()[entry.body_offset + 2]);
+        }
+
+        return indices;
+    }
+
+    // Original index of the function called by each function
+    std::map<std::uint32_t, std::uint32_t> callees(const kyut::binary::Module& module) {
+        const auto indices = original_indices(module);
+
+        std::map<std::uint32_t, std::uint32_t> callees{};
+        for (const auto& entry : kyut::binary::read_code(module)) {
+            callees.emplace(module.bytes()[entry.body_offset + 2], indices[module.bytes()[entry.body_offset + 5]]);
+        }
+
+        return callees;
+    }
+} // namespace
+
+TEST(kyut, binary_reorder_functions) {
+    const kyut::binary::Module module{make_module()};
+
+    kyut::binary::ModuleOrder order{};
+    for (std::uint32_t i = 0; i < num_functions; i++) {
+        order.functions.emplace_back((i * 5) % num_functions);
+    }
+
+    const auto reordered = kyut::binary::reorder(module, order);
+    const auto indices = original_indices(reordered);
+
+    for (std::uint32_t i = 0; i < num_functions; i++) {
+        EXPECT_EQ(indices[i + 1], order.functions[i] + 1);
+    }
+
+    EXPECT_EQ(callees(reordered), callees(module));
+
+    // New index of each original function
+    std::vector<std::uint32_t> new_indices(num_functions + 1);
+    for (std::uint32_t i = 0; i <= num_functions; i++) {
+        new_indices[indices[i]] = i;
+    }
+
+    const auto exports = kyut::binary::read_exports(reordered);
+    ASSERT_EQ(exports.size(), 2u);
+    EXPECT_EQ(reordered.bytes()[exports[0].end - 1], new_indices[3]);
+    EXPECT_EQ(reordered.bytes()[exports[1].end - 1], new_indices[5]);
+
+    const auto& start = *reordered.find_section(kyut::binary::SectionId::start);
+    EXPECT_EQ(reordered.bytes()[start.payload_offset], new_indices[7]);
+
+    const auto& elements = *reordered.find_section(kyut::binary::SectionId::element);
+    EXPECT_EQ(
+        Bytes(std::begin(reordered.bytes()) + elements.payload_offset, std::begin(reordered.bytes()) + elements.end),
+        (Bytes{0x01, 0x00, 0x41, 0x00, 0x0B, 0x03, static_cast<std::uint8_t>(new_indices[1]), static_cast<std::uint8_t>(new_indices[2]), static_cast<std::uint8_t>(new_indices[12])}));
+
+    // Function names are sorted by their new indices
+    const auto& sections = reordered.sections();
+    ASSERT_EQ(sections.back().name, "name");
+
+    kyut::binary::Reader r = reordered.reader(sections.back());
+    r.read_name();
+    EXPECT_EQ(r.read_byte(), 1);
+    r.read_u32();
+    EXPECT_EQ(r.read_u32(), 2u);
+
+    std::vector<std::pair<std::uint32_t, std::string_view>> function_names{};
+    for (int i = 0; i < 2; i++) {
+        const auto index = r.read_u32();
+        function_names.emplace_back(index, r.read_name());
+    }
+
+    auto expected = std::vector<std::pair<std::uint32_t, std::string_view>>{{new_indices[1], "one"}, {new_indices[2], "two"}};
+    std::sort(std::begin(expected), std::end(expected));
+    EXPECT_EQ(function_names, expected);
+}
+
+TEST(kyut, binary_reorder_invalid_order) {
+    const kyut::binary::Module module{make_module()};
+
+    kyut::binary::ModuleOrder order{};
+    order.functions = {0, 1, 2};
+    EXPECT_THROW(kyut::binary::reorder(module, order), std::runtime_error);
+
+    order.functions.assign(num_functions, 0);
+    EXPECT_THROW(kyut::binary::reorder(module, order), std::runtime_error);
+}
+
+TEST(kyut, binary_reorder_sections) {
+    const kyut::binary::Module module{make_sections_module(0x10)};
+
+    kyut::binary::ModuleOrder order{};
+    order.types = {2, 0, 1};
+    order.imports = {2, 4, 0, 3, 1};
+    order.functions = {1, 0};
+    order.globals = {1, 0};
+    order.elements = {2, 0, 1};
+    order.data = {1, 2, 0};
+
+    const auto reordered = kyut::binary::reorder(module, order);
+    const auto& bytes = reordered.bytes();
+
+    // Functions f, h, 2 and 3 are now 1, 0, 3 and 2; types 0, 1 and 2 are now 1, 2 and 0
+    const auto functions = kyut::binary::read_functions(reordered);
+    ASSERT_EQ(functions.size(), 2u);
+    EXPECT_EQ(functions[0].type_index, 0u);
+    EXPECT_EQ(functions[1].type_index, 1u);
+
+    EXPECT_EQ(bytes[reordered.find_section(kyut::binary::SectionId::start)->payload_offset], 3);
+
+    // The event is of type 2 now
+    EXPECT_EQ(bytes[reordered.find_section(kyut::binary::SectionId::event)->payload_offset + 2], 2);
+
+    const auto code = kyut::binary::read_code(reordered);
+    ASSERT_EQ(code.size(), 2u);
+    EXPECT_EQ(
+        Bytes(std::begin(bytes) + code[1].body_offset, std::begin(bytes) + code[1].body_offset + 12),
+        (Bytes{0x00, 0x10, 0x01, 0x41, 0x01, 0x10, 0x00, 0x41, 0x00, 0x11, 0x01, 0x00}));
+
+    // Globals g, k, 2 and 3 are now 1, 0, 3 and 2; global 3 reads k
+    const auto globals = kyut::binary::read_globals(reordered);
+    ASSERT_EQ(globals.size(), 2u);
+    EXPECT_EQ(Bytes(std::begin(bytes) + globals[0].offset, std::begin(bytes) + globals[0].end), (Bytes{0x7F, 0x01, 0x23, 0x00, 0x0B}));
+
+    // Data segment 2 is now 1, element segment 0 is now 1
+    EXPECT_EQ(
+        Bytes(std::begin(bytes) + code[1].end - 27, std::begin(bytes) + code[1].end - 7),
+        (Bytes{0xFC, 0x08, 0x01, 0x00, 0xFC, 0x09, 0x01, 0x41, 0x00, 0x41, 0x00, 0x41, 0x01, 0xFC, 0x0C, 0x00, 0x00, 0xFC, 0x0D, 0x01}));
+
+    // Reordering back restores the module, as indices keep their widths
+    kyut::binary::ModuleOrder inverse_order{};
+    inverse_order.types = inverse(order.types);
+    inverse_order.imports = inverse(order.imports);
+    inverse_order.functions = inverse(order.functions);
+    inverse_order.globals = inverse(order.globals);
+    inverse_order.elements = inverse(order.elements);
+    inverse_order.data = inverse(order.data);
+
+    EXPECT_EQ(kyut::binary::reorder(reordered, inverse_order).bytes(), module.bytes());
+
+    // Without changed indices, function bodies are copied
+    kyut::binary::ModuleOrder data_order{};
+    data_order.data = {0, 1, 2};
+    EXPECT_EQ(kyut::binary::reorder(module, data_order).bytes(), module.bytes());
+}
+
+TEST(kyut, binary_reorder_table_imports) {
+    const kyut::binary::Module module{make_sections_module(0x10)};
+
+    kyut::binary::ModuleOrder order{};
+    order.imports = {3, 0, 1, 2, 4};
+    EXPECT_NO_THROW(kyut::binary::reorder(module, order));
+
+    order.imports = {0, 1, 2, 3, 3};
+    EXPECT_THROW(kyut::binary::reorder(module, order), std::runtime_error);
+}
+
+TEST(kyut, section_reordering) {
+    // 2 bits in types, 1 in each of function imports, global imports and globals, 2 in each of element and data
+    // segments; overlapping data segments are not reordered
+    for (const auto& [data_offset, num_bits, watermark] : std::vector<std::tuple<std::uint8_t, std::size_t, Bytes>>{
+             {0x10, 9, {0xA5, 0x80}},
+             {0x01, 7, {0xA4}},
+         }) {
+        kyut::binary::Module module{make_sections_module(data_offset)};
+        EXPECT_EQ(kyut::methods::section_reordering::capacity(module, 4), num_bits);
+
+        kyut::CircularBitStreamReader r{"\xA5\xBC"};
+        EXPECT_EQ(kyut::methods::section_reordering::embed(r, module, std::size_t(-1), 4, 2), num_bits);
+
+        kyut::BitStreamWriter w{};
+        EXPECT_EQ(kyut::methods::section_reordering::extract(w, module, 4), num_bits);
+        EXPECT_EQ(w.data(), watermark);
+    }
+}
+
+TEST(kyut, section_reordering_limit) {
+    kyut::binary::Module module{make_sections_module(0x10)};
+
+    kyut::CircularBitStreamReader r{"\xFF"};
+    EXPECT_EQ(kyut::methods::section_reordering::embed(r, module, 3, 4), 3u);
+
+    kyut::BitStreamWriter w{};
+    kyut::methods::section_reordering::extract(w, module, 4);
+    EXPECT_EQ(w.data()[0] & 0xE0, 0xE0);
+}
+
+TEST(kyut, raw_function_reordering) {
+    kyut::binary::Module module{make_module()};
+    const auto original_callees = callees(module);
+
+    EXPECT_EQ(kyut::methods::raw_function_reordering::capacity(module, 4, 2), 12u);
+
+    kyut::CircularBitStreamReader r{"\xA5\x3C"};
+    const auto embedded_bits = kyut::methods::raw_function_reordering::embed(r, module, std::size_t(-1), 4, 2);
+
+    // 3 chunks of 4 functions, 4 bits each
+    EXPECT_EQ(embedded_bits, 12u);
+    EXPECT_EQ(callees(module), original_callees);
+
+    // DWARF sections are dropped
+    for (const auto& section : module.sections()) {
+        EXPECT_NE(section.name, ".debug_info");
+    }
+
+    for (const std::size_t num_threads : {1, 3}) {
+        kyut::BitStreamWriter w{};
+        const auto extracted_bits = kyut::methods::raw_function_reordering::extract(w, module, 4, num_threads);
+
+        EXPECT_EQ(extracted_bits, 12u);
+        EXPECT_EQ(w.data(), (std::vector<std::uint8_t>{0xA5, 0x30}));
+    }
+}
+
+TEST(kyut, raw_function_reordering_with_section_reordering) {
+    kyut::binary::Module module{make_typed_module()};
+
+    // 2 chunks of 4 functions, 4 bits each
+    kyut::CircularBitStreamReader function_bits{"\xA5"};
+    EXPECT_EQ(kyut::methods::raw_function_reordering::embed(function_bits, module, std::size_t(-1), 4), 8u);
+
+    // Types and globals are reordered, changing the type and global indices of functions
+    const auto original_types = types(module);
+
+    kyut::CircularBitStreamReader section_bits{"\x5A"};
+    EXPECT_EQ(kyut::methods::section_reordering::embed(section_bits, module, std::size_t(-1), 4), 5u);
+    EXPECT_NE(types(module), original_types);
+
+    kyut::BitStreamWriter w{};
+    EXPECT_EQ(kyut::methods::raw_function_reordering::extract(w, module, 4), 8u);
+    EXPECT_EQ(w.data(), (std::vector<std::uint8_t>{0xA5}));
+}
@@ -1,5 +1,7 @@
 #include "kyut/BitStreamWriter.hpp"
 
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST(kyut, BitStreamWriter) {
@@ -23,3 +25,79 @@ TEST(kyut, BitStreamWriter) {
     EXPECT_EQ(w.position_bits(), 24);
     EXPECT_EQ(w.data_as_str(), "\xAB\xCD\xEF");
 }
+
+TEST(kyut, BitStreamWriter_unaligned) {
+    kyut::BitStreamWriter w{};
+    w.reserve(80);
+
+    w.write(0x5, 3);
+    w.write_bit(true);
+    w.write(0, 0);
+    w.write(0x0123456789ABCDEF, 64);
+    w.write(0xFFF, 4);
+
+    EXPECT_EQ(w.position_bits(), 72);
+    EXPECT_EQ(w.data_as_str(), "\xB0\x12\x34\x56\x78\x9A\xBC\xDE\xFF");
+}
+
+TEST(kyut, BitStreamWriter_bit_by_bit) {
+    kyut::BitStreamWriter a{};
+    kyut::BitStreamWriter b{};
+
+    std::uint64_t x = 0x9E3779B97F4A7C15;
+    for (std::size_t n = 0; n <= 64; n++) {
+        a.write(x, n);
+
+        for (std::size_t i = 0; i < n; i++) {
+            b.write_bit(((x >> (n - i - 1)) & 1) != 0);
+        }
+
+        x = x * 6364136223846793005 + 1442695040888963407;
+    }
+
+    EXPECT_EQ(a.position_bits(), b.position_bits());
+    EXPECT_EQ(a.data(), b.data());
+}
+
+TEST(kyut, BitStreamWriter_write_at) {
+    kyut::BitStreamWriter w{};
+
+    w.write(0x1, 1);
+    w.resize(25);
+    w.write_at(13, 0x1F, 5);
+    w.write_at(1, 0xFFF, 12);
+    w.write(0x7F, 7);
+
+    EXPECT_EQ(w.position_bits(), 32);
+    EXPECT_EQ(w.data_as_str(), "\xFF\xFF\xC0\x7F");
+}
+
+TEST(kyut, BitStreamWriter_write_at_threads) {
+    constexpr std::size_t num_threads = 8;
+    constexpr std::size_t width = 13;
+    constexpr std::size_t count = 1000;
+
+    kyut::BitStreamWriter expected{};
+    for (std::size_t i = 0; i < num_threads * count; i++) {
+        expected.write(i, width);
+    }
+
+    kyut::BitStreamWriter w{};
+    w.resize(num_threads * count * width);
+
+    // Interleaved ranges, sharing partial bytes between threads
+    std::vector<std::thread> threads{};
+    for (std::size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i = t; i < num_threads * count; i += num_threads) {
+                w.write_at(i * width, i, width);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(w.data(), expected.data());
+}
@@ -23,3 +23,38 @@ TEST(kyut, CircularBitStreamReader) {
     EXPECT_EQ(a, 0xCDEF8);
     EXPECT_EQ(r.position_bits(), 4);
 }
+
+TEST(kyut, CircularBitStreamReader_wide) {
+    kyut::CircularBitStreamReader r{"\x01\x23\x45"};
+
+    EXPECT_EQ(r.read(0), 0);
+    EXPECT_EQ(r.read(4), 0x0);
+    EXPECT_EQ(r.read(64), 0x1234501234501234);
+    EXPECT_EQ(r.position_bits(), 20);
+
+    EXPECT_TRUE(!r.read_bit());
+    EXPECT_TRUE(r.read_bit());
+    EXPECT_EQ(r.read(2), 0x1);
+    EXPECT_EQ(r.position_bits(), 0);
+}
+
+TEST(kyut, CircularBitStreamReader_read_at) {
+    const kyut::CircularBitStreamReader r{"\x01\x23\x45"};
+
+    EXPECT_EQ(r.read_at(4, 8), 0x12);
+    EXPECT_EQ(r.read_at(20, 8), 0x50);
+    EXPECT_EQ(r.read_at(24 * 3 + 8, 16), 0x2345);
+    EXPECT_EQ(r.position_bits(), 0);
+}
+
+TEST(kyut, CircularBitStreamReader_seek) {
+    kyut::CircularBitStreamReader r{"\x01\x23\x45"};
+
+    r.seek(12);
+    EXPECT_EQ(r.position_bits(), 12);
+    EXPECT_EQ(r.read(8), 0x34);
+
+    r.seek(24 * 2 + 4);
+    EXPECT_EQ(r.position_bits(), 4);
+    EXPECT_EQ(r.read(4), 0x1);
+}
@@ -0,0 +1,317 @@
+#include "kyut/wasm-ext/FlatFunction.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "kyut/Commutativity.hpp"
+#include "wasm-builder.h"
+#include <gtest/gtest.h>
+
+namespace {
+    // The recursive `operator<` of the first release, reduced to the expressions of `make_module`
+    namespace baseline {
+        bool less(const wasm::Expression& a, const wasm::Expression& b);
+
+        // Optional expression (nullptr is the least)
+        struct Ref {
+            const wasm::Expression* expr;
+        };
+
+        struct List {
+            const wasm::ExpressionList* list;
+        };
+
+        bool operator<(Ref a, Ref b) {
+            if (a.expr == nullptr || b.expr == nullptr) {
+                return a.expr == nullptr && b.expr != nullptr;
+            }
+
+            return less(*a.expr, *b.expr);
+        }
+
+        bool operator<(List a, List b) {
+            if (a.list == b.list) {
+                return false;
+            }
+
+            if (a.list->size() != b.list->size()) {
+                return a.list->size() < b.list->size();
+            }
+
+            return std::lexicographical_compare(
+                std::begin(*a.list),
+                std::end(*a.list),
+                std::begin(*b.list),
+                std::end(*b.list),
+                [](const wasm::Expression* a, const wasm::Expression* b) {
+                    return less(*a, *b);
+                });
+        }
+
+        bool less(const wasm::Expression& a, const wasm::Expression& b) {
+            if (&a == &b) {
+                return false;
+            }
+
+            if (a._id != b._id) {
+                return a._id < b._id;
+            }
+
+            if (a.type != b.type) {
+                return a.type < b.type;
+            }
+
+            switch (a._id) {
+                case wasm::Expression::Id::BlockId: {
+                    const auto& x = *a.cast<wasm::Block>();
+                    const auto& y = *b.cast<wasm::Block>();
+
+                    return List{&x.list} < List{&y.list};
+                }
+                case wasm::Expression::Id::SwitchId: {
+                    const auto& x = *a.cast<wasm::Switch>();
+                    const auto& y = *b.cast<wasm::Switch>();
+
+                    return std::make_tuple(Ref{x.value}, Ref{x.condition}) < std::make_tuple(Ref{y.value}, Ref{y.condition});
+                }
+                case wasm::Expression::Id::CallIndirectId: {
+                    const auto& x = *a.cast<wasm::CallIndirect>();
+                    const auto& y = *b.cast<wasm::CallIndirect>();
+
+                    return std::make_tuple(List{&x.operands}, Ref{x.target}) < std::make_tuple(List{&y.operands}, Ref{y.target});
+                }
+                case wasm::Expression::Id::LocalGetId: {
+                    const auto& x = *a.cast<wasm::LocalGet>();
+                    const auto& y = *b.cast<wasm::LocalGet>();
+
+                    return x.index < y.index;
+                }
+                case wasm::Expression::Id::ConstId: {
+                    const auto& x = *a.cast<wasm::Const>();
+                    const auto& y = *b.cast<wasm::Const>();
+
+                    return std::less<wasm::Literal>{}(x.value, y.value);
+                }
+                case wasm::Expression::Id::UnaryId: {
+                    const auto& x = *a.cast<wasm::Unary>();
+                    const auto& y = *b.cast<wasm::Unary>();
+
+                    return std::make_tuple(x.op, Ref{x.value}) < std::make_tuple(y.op, Ref{y.value});
+                }
+                case wasm::Expression::Id::BinaryId: {
+                    const auto& x = *a.cast<wasm::Binary>();
+                    const auto& y = *b.cast<wasm::Binary>();
+
+                    const auto normalize = [](const wasm::Binary& node) -> std::tuple<wasm::BinaryOp, Ref, Ref> {
+                        if (!kyut::is_commutative(node.op)) {
+                            return {node.op, Ref{node.left}, Ref{node.right}};
+                        }
+
+                        if (Ref{node.left} < Ref{node.right}) {
+                            return {node.op, Ref{node.left}, Ref{node.right}};
+                        } else {
+                            return {*kyut::swapped_binary_op(node.op), Ref{node.right}, Ref{node.left}};
+                        }
+                    };
+
+                    return normalize(x) < normalize(y);
+                }
+                case wasm::Expression::Id::DropId: {
+                    const auto& x = *a.cast<wasm::Drop>();
+                    const auto& y = *b.cast<wasm::Drop>();
+
+                    return Ref{x.value} < Ref{y.value};
+                }
+                case wasm::Expression::Id::SIMDReplaceId: {
+                    const auto& x = *a.cast<wasm::SIMDReplace>();
+                    const auto& y = *b.cast<wasm::SIMDReplace>();
+
+                    return std::make_tuple(x.op, Ref{x.vec}, x.index, Ref{x.value}) < std::make_tuple(y.op, Ref{y.vec}, y.index, Ref{y.value});
+                }
+                case wasm::Expression::Id::SIMDShuffleId: {
+                    const auto& x = *a.cast<wasm::SIMDShuffle>();
+                    const auto& y = *b.cast<wasm::SIMDShuffle>();
+
+                    return std::make_tuple(Ref{x.left}, Ref{x.right}, x.mask) < std::make_tuple(Ref{y.left}, Ref{y.right}, y.mask);
+                }
+                case wasm::Expression::Id::SIMDShiftId: {
+                    const auto& x = *a.cast<wasm::SIMDShift>();
+                    const auto& y = *b.cast<wasm::SIMDShift>();
+
+                    return std::make_tuple(x.op, Ref{x.vec}, Ref{x.shift}) < std::make_tuple(y.op, Ref{y.vec}, Ref{y.shift});
+                }
+                case wasm::Expression::Id::PopId: {
+                    return false;
+                }
+                case wasm::Expression::Id::TryId: {
+                    const auto& x = *a.cast<wasm::Try>();
+                    const auto& y = *b.cast<wasm::Try>();
+
+                    return std::make_tuple(Ref{x.body}, Ref{x.catchBody}) < std::make_tuple(Ref{y.body}, Ref{y.catchBody});
+                }
+                case wasm::Expression::Id::ThrowId: {
+                    const auto& x = *a.cast<wasm::Throw>();
+                    const auto& y = *b.cast<wasm::Throw>();
+
+                    return List{&x.operands} < List{&y.operands};
+                }
+                default:
+                    throw std::logic_error{"unexpected expression"};
+            }
+        }
+
+        bool less(const wasm::Function& a, const wasm::Function& b) {
+            if (&a == &b) {
+                return false;
+            }
+
+            // wasm::Function::getNumVars() does not modify states
+            return std::make_tuple(a.sig, const_cast<wasm::Function&>(a).getNumVars(), Ref{a.body}) <
+                   std::make_tuple(b.sig, const_cast<wasm::Function&>(b).getNumVars(), Ref{b.body});
+        }
+    } // namespace baseline
+
+    // Operand `k` of the statements of `make_module`; some of them are equal once commutative operands are ordered
+    wasm::Expression* make_operand(wasm::Builder& builder, std::uint32_t k) {
+        switch (k % 6) {
+            case 0:
+                return builder.makeLocalGet(0, wasm::Type::i32);
+            case 1:
+                return builder.makeLocalGet(1, wasm::Type::i32);
+            case 2:
+                return builder.makeConst(wasm::Literal{std::int32_t{1}});
+            case 3:
+                return builder.makeConst(wasm::Literal{std::int32_t{2}});
+            case 4:
+                return builder.makeBinary(wasm::AddInt32, builder.makeLocalGet(0, wasm::Type::i32), builder.makeConst(wasm::Literal{std::int32_t{1}}));
+            default:
+                return builder.makeBinary(wasm::AddInt32, builder.makeConst(wasm::Literal{std::int32_t{1}}), builder.makeLocalGet(0, wasm::Type::i32));
+        }
+    }
+
+    // f32 literal `k`, including zeros of both signs and NaNs with different payloads
+    wasm::Literal make_literal(std::uint32_t k) {
+        constexpr std::array<std::int32_t, 6> bits{0x00000000, static_cast<std::int32_t>(0x80000000), 0x3F800000, 0x7FC00000, 0x7FC00001, 0x3F800000};
+        return wasm::Literal{bits[k % bits.size()]}.castToF32();
+    }
+
+    wasm::Expression* splat(wasm::Builder& builder, wasm::Expression* value) {
+        return builder.makeUnary(wasm::SplatVecI32x4, value);
+    }
+
+    // Statement `s` on operands `p` and `q`
+    wasm::Expression* make_statement(wasm::Builder& builder, std::uint32_t s, std::uint32_t p, std::uint32_t q) {
+        const auto lhs = make_operand(builder, p);
+        const auto rhs = make_operand(builder, q);
+
+        switch (s % 10) {
+            case 0:
+                return builder.makeDrop(builder.makeBinary(wasm::AddInt32, lhs, rhs));
+            case 1:
+                return builder.makeDrop(builder.makeBinary(wasm::SubInt32, lhs, rhs));
+            case 2:
+                return builder.makeDrop(builder.makeBinary(
+                    wasm::MulInt32,
+                    builder.makeBinary(wasm::AddInt32, lhs, rhs),
+                    builder.makeBinary(wasm::AddInt32, make_operand(builder, q), make_operand(builder, p))));
+            case 3:
+                return builder.makeDrop(builder.makeSIMDShuffle(splat(builder, lhs), splat(builder, rhs), std::array<std::uint8_t, 16>{}));
+            case 4:
+                return builder.makeDrop(builder.makeSIMDReplace(wasm::ReplaceLaneVecI32x4, splat(builder, lhs), static_cast<std::uint8_t>(p % 4), rhs));
+            case 5:
+                return builder.makeDrop(builder.makeSIMDShift(wasm::ShlVecI32x4, splat(builder, lhs), rhs));
+            case 6: {
+                // (block $l (result i32) (br_table $l $l (lhs) (rhs)))
+                std::vector<wasm::Name> targets{"l"};
+                return builder.makeDrop(builder.makeBlock("l", std::vector<wasm::Expression*>{builder.makeSwitch(targets, "l", rhs, lhs)}, wasm::Type::i32));
+            }
+            case 7:
+                return builder.makeDrop(builder.makeCallIndirect(
+                    make_operand(builder, p + q),
+                    std::vector<wasm::Expression*>{lhs, rhs},
+                    wasm::Signature{{wasm::Type::i32, wasm::Type::i32}, wasm::Type::i32}));
+            case 8:
+                // (try (do (throw $e (lhs))) (catch (drop (pop exnref)) (drop (rhs))))
+                return builder.makeTry(
+                    builder.makeThrow("e", std::vector<wasm::Expression*>{lhs}),
+                    builder.makeBlock(std::vector<wasm::Expression*>{builder.makeDrop(builder.makePop(wasm::Type::exnref)), builder.makeDrop(rhs)}));
+            default:
+                return builder.makeDrop(builder.makeBinary(wasm::AddFloat32, builder.makeConst(make_literal(p)), builder.makeConst(make_literal(q))));
+        }
+    }
+
+    // Module defining functions of two statements each, with many ties and bodies differing only deep down
+    void make_module(wasm::Module& module) {
+        wasm::Builder builder{module};
+
+        std::uint32_t seed = 1;
+        const auto next = [&] {
+            seed = seed * 1103515245 + 12345;
+            return seed >> 16;
+        };
+
+        for (std::uint32_t i = 0; i < 200; i++) {
+            std::vector<wasm::Expression*> list{};
+            for (std::uint32_t j = 0; j < 2; j++) {
+                const auto s = i < 100 ? i / 10 : next();
+                list.emplace_back(make_statement(builder, s, next(), next()));
+            }
+
+            std::vector<wasm::Type> vars{};
+            if (i % 7 == 0) {
+                vars.emplace_back(wasm::Type::i32);
+            }
+
+            module.addFunction(builder.makeFunction(
+                "f" + std::to_string(i),
+                wasm::Signature{{wasm::Type::i32, wasm::Type::i32}, wasm::Type::none},
+                std::move(vars),
+                builder.makeBlock(list)));
+        }
+    }
+} // namespace
+
+TEST(kyut, flat_function_compare3) {
+    wasm::Module module{};
+    make_module(module);
+
+    std::vector<wasm::Function*> functions{};
+    std::vector<kyut::FlatFunction> flats{};
+    flats.reserve(module.functions.size());
+    for (const auto& f : module.functions) {
+        functions.emplace_back(f.get());
+        flats.emplace_back(*f);
+    }
+
+    for (std::size_t i = 0; i < functions.size(); i++) {
+        for (std::size_t j = 0; j < functions.size(); j++) {
+            const auto& a = *functions[i];
+            const auto& b = *functions[j];
+
+            EXPECT_EQ(kyut::compare3_body(flats[i], flats[j]) < 0, baseline::less(*a.body, *b.body)) << a.name.str << " < " << b.name.str;
+            EXPECT_EQ(kyut::compare3_body(flats[i], flats[j]) > 0, baseline::less(*b.body, *a.body)) << a.name.str << " > " << b.name.str;
+            EXPECT_EQ(kyut::compare3(flats[i], flats[j]) < 0, baseline::less(a, b)) << a.name.str << " < " << b.name.str;
+            EXPECT_EQ(kyut::compare3(flats[i], flats[j]) > 0, baseline::less(b, a)) << a.name.str << " > " << b.name.str;
+        }
+    }
+
+    // Sorting stably by either keeps ties in the order of the module
+    std::vector<std::size_t> expected(functions.size());
+    std::vector<std::size_t> actual(functions.size());
+    for (std::size_t i = 0; i < functions.size(); i++) {
+        expected[i] = actual[i] = i;
+    }
+
+    std::stable_sort(std::begin(expected), std::end(expected), [&](std::size_t a, std::size_t b) {
+        return baseline::less(*functions[a], *functions[b]);
+    });
+    std::stable_sort(std::begin(actual), std::end(actual), [&](std::size_t a, std::size_t b) {
+        return kyut::compare3(flats[a], flats[b]) < 0;
+    });
+
+    EXPECT_EQ(actual, expected);
+}
@@ -0,0 +1,48 @@
+#include "kyut/methods/FunctionReordering.hpp"
+
+#include <string>
+#include "kyut/BitStreamWriter.hpp"
+#include "kyut/CircularBitStreamReader.hpp"
+#include "wasm-builder.h"
+#include <gtest/gtest.h>
+
+TEST(kyut, function_reordering_capacity) {
+    wasm::Module module{};
+    wasm::Builder builder{module};
+
+    // Functions returning 0 to 9, with an import after every third one
+    for (std::int32_t n = 0; n < 10; n++) {
+        const auto name = std::to_string(n);
+        module.addFunction(builder.makeFunction("f" + name, wasm::Signature{wasm::Type::none, wasm::Type::i32}, {}, builder.makeConst(wasm::Literal{n})));
+
+        if (n % 3 == 2) {
+            auto import = builder.makeFunction("import" + name, wasm::Signature{wasm::Type::none, wasm::Type::none}, {});
+            import->module = "env";
+            import->base = "import" + name;
+            module.addFunction(std::move(import));
+        }
+    }
+
+    const auto capacity = kyut::methods::function_reordering::capacity(module, 4);
+
+    // 2 chunks of 4 functions and one of 2, 4 bits and 1 bit each
+    EXPECT_EQ(capacity, std::size_t{9});
+
+    kyut::CircularBitStreamReader r{"\xA5\x3C"};
+    EXPECT_EQ(kyut::methods::function_reordering::embed(r, module, std::size_t(-1), 4), capacity);
+
+    // Imports come first, and defined functions stay in their chunks
+    for (std::size_t i = 0; i < module.functions.size(); i++) {
+        const auto& f = *module.functions[i];
+        EXPECT_EQ(f.body == nullptr, i < 3) << "function " << i;
+
+        if (f.body != nullptr) {
+            EXPECT_EQ(std::stoul(std::string{f.name.str}.substr(1)) / 4, (i - 3) / 4) << "function " << i;
+        }
+    }
+
+    kyut::BitStreamWriter w{};
+    EXPECT_EQ(kyut::methods::function_reordering::extract(w, module, 4), capacity);
+    EXPECT_EQ(w.data()[0], 0xA5);
+    EXPECT_EQ(w.data()[1] & 0x80, 0x00);
+}
@@ -0,0 +1,168 @@
+#include "kyut/wasm-ext/ModuleSource.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "kyut/CircularBitStreamReader.hpp"
+#include "kyut/binary/MappedFile.hpp"
+#include "kyut/binary/Writer.hpp"
+#include "kyut/methods/FunctionReordering.hpp"
+#include "kyut/methods/OperandSwapping.hpp"
+#include "wasm-io.h"
+#include <gtest/gtest.h>
+
+namespace {
+    using Bytes = std::vector<std::uint8_t>;
+
+    constexpr std::uint32_t num_functions = 8;
+
+    // Module defining functions 0 to `num_functions - 1` of type (i32, i32) -> i32, each exported.
+    // Function `i` adds and multiplies its parameters with constants, and calls function `i + 1`.
+    // With `dwarf`, the module has a compile unit in `.debug_info`.
+    // With `exceptions`, the module defines an event of type (i32) -> (), and each function throws and catches it first.
+    Bytes make_module(bool dwarf, bool exceptions) {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        kyut::binary::write_section(bytes, 1, {0x02, 0x60, 0x02, 0x7F, 0x7F, 0x01, 0x7F, 0x60, 0x01, 0x7F, 0x00});
+
+        Bytes functions{};
+        kyut::binary::write_u32(functions, num_functions);
+        functions.insert(std::end(functions), num_functions, 0x00);
+        kyut::binary::write_section(bytes, 3, functions);
+
+        if (exceptions) {
+            kyut::binary::write_section(bytes, 13, {0x01, 0x00, 0x01});
+        }
+
+        Bytes exports{};
+        kyut::binary::write_u32(exports, num_functions);
+        for (std::uint32_t i = 0; i < num_functions; i++) {
+            kyut::binary::write_name(exports, "f" + std::to_string(i));
+            exports.insert(std::end(exports), {0x00, static_cast<std::uint8_t>(i)});
+        }
+        kyut::binary::write_section(bytes, 7, exports);
+
+        Bytes code{};
+        kyut::binary::write_u32(code, num_functions);
+        for (std::uint32_t i = 0; i < num_functions; i++) {
+            // (local i32) (i32.mul (i32.add (local.get 0) (i32.const i)) (local.get 1))
+            Bytes body{0x01, 0x01, 0x7F};
+
+            if (exceptions) {
+                // (try (do (throw 0 (local.get 0))) (catch (drop (pop exnref))))
+                body.insert(std::end(body), {0x06, 0x40, 0x20, 0x00, 0x08, 0x00, 0x07, 0x1A, 0x0B});
+            }
+
+            body.insert(std::end(body), {0x20, 0x00, 0x41, static_cast<std::uint8_t>(i), 0x6A, 0x20, 0x01, 0x6C});
+
+            if (i + 1 < num_functions) {
+                // (i32.add ... (call i + 1 (local.get 1) (i32.const i)))
+                body.insert(std::end(body), {0x20, 0x01, 0x41, static_cast<std::uint8_t>(i), 0x10, static_cast<std::uint8_t>(i + 1), 0x6A});
+            }
+
+            body.push_back(0x0B);
+
+            kyut::binary::write_u32(code, static_cast<std::uint32_t>(body.size()));
+            code.insert(std::end(code), std::begin(body), std::end(body));
+        }
+        kyut::binary::write_section(bytes, 10, code);
+
+        if (dwarf) {
+            // Compile unit with a low_pc, and no children
+            Bytes abbrev{};
+            kyut::binary::write_name(abbrev, ".debug_abbrev");
+            abbrev.insert(std::end(abbrev), {0x01, 0x11, 0x00, 0x11, 0x01, 0x00, 0x00, 0x00});
+            kyut::binary::write_section(bytes, 0, abbrev);
+
+            Bytes info{};
+            kyut::binary::write_name(info, ".debug_info");
+            info.insert(std::end(info), {0x0C, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x01, 0x00, 0x00, 0x00, 0x00});
+            kyut::binary::write_section(bytes, 0, info);
+        }
+
+        Bytes function_names{0x01, 0x02};
+        kyut::binary::write_name(function_names, "two");
+
+        Bytes local_names{0x02};
+        for (const std::uint8_t f : {1, 5}) {
+            local_names.insert(std::end(local_names), {f, 0x02, 0x00});
+            kyut::binary::write_name(local_names, "a");
+            local_names.push_back(0x02);
+            kyut::binary::write_name(local_names, "t");
+        }
+
+        Bytes names{};
+        kyut::binary::write_name(names, "name");
+        kyut::binary::write_section(names, 1, function_names);
+        kyut::binary::write_section(names, 2, local_names);
+        kyut::binary::write_section(bytes, 0, names);
+
+        return bytes;
+    }
+
+    std::string write_input(const std::string& name, const Bytes& bytes) {
+        const auto filename = testing::TempDir() + name;
+        kyut::binary::write_file(filename, {{bytes.data(), bytes.size()}});
+
+        return filename;
+    }
+
+    // Embeds a watermark in `module` with `method`, marking the modified functions in `source` if it is not null
+    void embed(const std::string& method, wasm::Module& module, kyut::ModuleSource* source) {
+        kyut::CircularBitStreamReader r{"\xA5\x3C\x96"};
+
+        if (method == "function-reorder") {
+            kyut::methods::function_reordering::embed(r, module, 256, 4);
+        } else {
+            std::vector<wasm::Function*> modified{};
+            kyut::methods::operand_swapping::embed(r, module, 256, 1, modified);
+
+            if (source != nullptr) {
+                for (const auto f : modified) {
+                    source->mark_modified(*f);
+                }
+            }
+        }
+    }
+} // namespace
+
+TEST(kyut, module_source_round_trip) {
+    for (const auto& [dwarf, exceptions] : std::vector<std::pair<bool, bool>>{{false, false}, {true, false}, {false, true}}) {
+        const auto input = write_input("module_source_input.wasm", make_module(dwarf, exceptions));
+
+        for (const std::string method : {"function-reorder", "operand-swap"}) {
+            for (const auto debug_info : {false, true}) {
+                const auto expected_filename = testing::TempDir() + "module_source_expected.wasm";
+                {
+                    wasm::Module module{};
+                    wasm::ModuleReader{}.read(input, module);
+
+                    embed(method, module, nullptr);
+
+                    wasm::ModuleWriter w{};
+                    w.setDebugInfo(debug_info);
+                    w.writeBinary(module, expected_filename);
+                }
+
+                const auto expected = kyut::binary::read_module(expected_filename);
+
+                for (const std::size_t num_threads : {1, 3}) {
+                    const auto filename = testing::TempDir() + "module_source.wasm";
+                    {
+                        kyut::ModuleSource source{};
+
+                        wasm::Module module{};
+                        source.read(input, module, num_threads);
+
+                        embed(method, module, &source);
+
+                        source.write(module, filename, debug_info, num_threads);
+                    }
+
+                    EXPECT_EQ(kyut::binary::read_module(filename).bytes(), expected.bytes())
+                        << method << (dwarf ? " with DWARF" : "") << (exceptions ? " with exceptions" : "") << (debug_info ? " with debug info" : "") << ", " << num_threads << " threads";
+                }
+            }
+        }
+    }
+}
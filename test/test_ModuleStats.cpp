@@ -0,0 +1,58 @@
+#include "kyut/wasm-ext/ModuleStats.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "kyut/binary/Writer.hpp"
+#include <gtest/gtest.h>
+
+namespace {
+    std::string write_input(const std::string& name, const std::string& contents) {
+        const auto filename = testing::TempDir() + name;
+        std::ofstream{filename, std::ios::binary} << contents;
+
+        return filename;
+    }
+} // namespace
+
+TEST(kyut, read_module_stats) {
+    // Imports function 0 and defines function 1, which throws an event and is exported twice
+    std::vector<std::uint8_t> bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+    kyut::binary::write_section(bytes, 1, {0x02, 0x60, 0x00, 0x00, 0x60, 0x01, 0x7F, 0x00});
+
+    std::vector<std::uint8_t> imports{0x01};
+    kyut::binary::write_name(imports, "env");
+    kyut::binary::write_name(imports, "f");
+    imports.insert(std::end(imports), {0x00, 0x00});
+    kyut::binary::write_section(bytes, 2, imports);
+
+    kyut::binary::write_section(bytes, 3, {0x01, 0x00});
+    kyut::binary::write_section(bytes, 13, {0x01, 0x00, 0x01});
+
+    std::vector<std::uint8_t> exports{0x02};
+    for (const auto name : {"a", "b"}) {
+        kyut::binary::write_name(exports, name);
+        exports.insert(std::end(exports), {0x00, 0x01});
+    }
+    kyut::binary::write_section(bytes, 7, exports);
+
+    // (throw 0 (i32.const 0))
+    kyut::binary::write_section(bytes, 10, {0x01, 0x06, 0x00, 0x41, 0x00, 0x08, 0x00, 0x0B});
+
+    const auto binary = kyut::read_module_stats(write_input("read_module_stats.wasm", std::string(std::begin(bytes), std::end(bytes))));
+    EXPECT_EQ(binary.functions, 2u);
+    EXPECT_EQ(binary.exports, 2u);
+    EXPECT_EQ(binary.imports, 1u);
+
+    const auto text = kyut::read_module_stats(write_input(
+        "read_module_stats.wat",
+        R"((module
+             (import "env" "f" (func))
+             (import "env" "g" (func))
+             (func (export "a"))
+             (func (export "b"))
+             (func (export "c"))))"));
+    EXPECT_EQ(text.functions, 5u);
+    EXPECT_EQ(text.exports, 3u);
+    EXPECT_EQ(text.imports, 2u);
+}
@@ -0,0 +1,76 @@
+#include "kyut/MultiwordInteger.hpp"
+
+#include <vector>
+#include <gtest/gtest.h>
+
+TEST(kyut, MultiwordInteger) {
+    kyut::MultiwordInteger<4> x{};
+
+    EXPECT_EQ(x.size(), 0);
+    EXPECT_EQ(x.bit_width(), 0);
+
+    // 30! = 0xd13f6370f96865df5dd54000000
+    x.multiply_add(1, 1);
+    for (std::uint32_t i = 2; i <= 30; i++) {
+        x.multiply_add(i, 0);
+    }
+
+    EXPECT_EQ(x.size(), 4);
+    EXPECT_EQ(x.bit_width(), 108);
+    EXPECT_EQ(x.word(3), 0xd13);
+    EXPECT_EQ(x.word(2), 0xf6370f96);
+    EXPECT_EQ(x.word(1), 0x865df5dd);
+    EXPECT_EQ(x.word(0), 0x54000000);
+    EXPECT_EQ(x.word(4), 0);
+
+    for (std::uint32_t i = 30; i >= 2; i--) {
+        EXPECT_EQ(x.divide(i), 0);
+    }
+
+    EXPECT_EQ(x.size(), 1);
+    EXPECT_EQ(x.word(0), 1);
+}
+
+TEST(kyut, MultiwordInteger_mixed_radix) {
+    const std::vector<std::uint32_t> digits = {7, 0, 123456, 65535, 1, 4000000000};
+    const std::vector<std::uint32_t> radices = {10, 3, 200000, 65536, 2, 4294967295};
+
+    kyut::MultiwordInteger<8> x{};
+    for (std::size_t i = digits.size(); i-- > 0;) {
+        x.multiply_add(radices[i], digits[i]);
+    }
+
+    for (std::size_t i = 0; i < digits.size(); i++) {
+        EXPECT_EQ(x.divide(radices[i]), digits[i]);
+    }
+
+    EXPECT_EQ(x.size(), 0);
+}
+
+TEST(kyut, MultiwordInteger_assign) {
+    const std::uint32_t words[] = {0x89ABCDEF, 0x01234567, 0, 0};
+
+    kyut::MultiwordInteger<4> x{};
+    x.assign(std::begin(words), 4);
+
+    EXPECT_EQ(x.size(), 2);
+    EXPECT_EQ(x.bit_width(), 57);
+    EXPECT_EQ(x.divide(0x10000), 0xCDEF);
+    EXPECT_EQ(x.word(0), 0x456789AB);
+    EXPECT_EQ(x.word(1), 0x0123);
+}
+
+TEST(kyut, MultiwordInteger_clear) {
+    kyut::MultiwordInteger<2> x{};
+    x.multiply_add(1, 0xFFFFFFFF);
+    x.multiply_add(0x10000, 0);
+    x.clear();
+
+    EXPECT_EQ(x.size(), 0);
+    EXPECT_EQ(x.word(1), 0);
+
+    x.multiply_add(3, 7);
+    EXPECT_EQ(x.size(), 1);
+    EXPECT_EQ(x.word(0), 7);
+    EXPECT_EQ(x.word(1), 0);
+}
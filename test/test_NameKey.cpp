@@ -0,0 +1,39 @@
+#include "kyut/NameKey.hpp"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+TEST(kyut, name_key_same_order_as_strcmp) {
+    std::mt19937 engine{42};
+
+    // Short alphabets make long common prefixes likely
+    std::vector<std::string> names{"", "a", "abcdefgh", "abcdefghi", "abcdefgh\xFF", "\xFF"};
+    for (std::size_t i = 0; i < 200; i++) {
+        std::string name(engine() % 20, '\0');
+        for (auto& c : name) {
+            c = "ab\x80_"[engine() % 4];
+        }
+
+        names.emplace_back(std::move(name));
+    }
+
+    for (const auto& a : names) {
+        for (const auto& b : names) {
+            const auto expected = std::strcmp(a.c_str(), b.c_str());
+            const auto actual = kyut::compare3(kyut::name_key(a), kyut::name_key(b));
+
+            EXPECT_EQ(actual, expected < 0 ? -1 : expected > 0 ? 1 : 0) << a << " " << b;
+        }
+    }
+}
+
+TEST(kyut, name_key_ends_at_null) {
+    using namespace std::string_literals;
+
+    EXPECT_EQ(kyut::compare3(kyut::name_key("abc\0d"s), kyut::name_key("abc")), 0);
+    EXPECT_EQ(kyut::compare3(kyut::name_key("abcdefghij\0a"s), kyut::name_key("abcdefghij\0b"s)), 0);
+    EXPECT_EQ(kyut::compare3(kyut::name_key("abcdefghij\0a"s), kyut::name_key("abcdefghijk")), -1);
+}
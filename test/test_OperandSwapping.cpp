@@ -0,0 +1,148 @@
+#include "kyut/methods/OperandSwapping.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "kyut/BitStreamWriter.hpp"
+#include "kyut/CircularBitStreamReader.hpp"
+#include "kyut/wasm-ext/Compare.hpp"
+#include "wasm-builder.h"
+#include <gtest/gtest.h>
+
+namespace {
+    // (i32.add (local.get 0) (i32.const n)), whose operands are in the order of (lo, hi) until they are swapped
+    wasm::Binary* make_site(wasm::Builder& builder, std::int32_t n) {
+        return builder.makeBinary(wasm::AddInt32, builder.makeLocalGet(0, wasm::Type::i32), builder.makeConst(wasm::Literal{n}));
+    }
+
+    wasm::Expression* splat(wasm::Builder& builder, wasm::Expression* value) {
+        return builder.makeUnary(wasm::SplatVecI32x4, value);
+    }
+
+    enum class SideEffect : std::uint32_t {
+        none = 0,
+        read_only = 1,
+        write = 2,
+    };
+
+    // The recursive visitor of the first release, reduced to the expressions of `operand_swapping_bit_order`, recording
+    // the sites it embeds bits in. Like the released binaries, it has to be built with GCC to visit them in their order.
+    struct BaselineVisitor {
+        std::vector<const wasm::Binary*> sites;
+
+        SideEffect visit(wasm::Expression* expr) {
+            if (const auto x = expr->dynCast<wasm::Block>()) {
+                auto effect = SideEffect::none;
+
+                for (const auto& child : x->list) {
+                    effect = (std::max)(visit(child), effect);
+                }
+
+                return effect;
+            }
+            if (const auto x = expr->dynCast<wasm::Drop>()) {
+                return visit(x->value);
+            }
+            if (const auto x = expr->dynCast<wasm::Unary>()) {
+                return visit(x->value);
+            }
+            if (expr->is<wasm::Const>()) {
+                return SideEffect::none;
+            }
+            if (expr->is<wasm::LocalGet>()) {
+                return SideEffect::read_only;
+            }
+            if (const auto x = expr->dynCast<wasm::SIMDReplace>()) {
+                return (std::max)(visit(x->vec), visit(x->value));
+            }
+            if (const auto x = expr->dynCast<wasm::SIMDShuffle>()) {
+                return (std::max)(visit(x->left), visit(x->right));
+            }
+            if (const auto x = expr->dynCast<wasm::SIMDShift>()) {
+                return (std::max)(visit(x->vec), visit(x->shift));
+            }
+            if (const auto x = expr->dynCast<wasm::Binary>()) {
+                if (x->op != wasm::AddInt32) {
+                    return (std::max)(visit(x->left), visit(x->right));
+                }
+
+                if (!(*x->left < *x->right) && !(*x->right < *x->left)) {
+                    return (std::max)(visit(x->left), visit(x->right));
+                }
+
+                auto [lo, hi] = std::minmax(x->left, x->right, [](auto a, auto b) { return *a < *b; });
+
+                const auto effect_lo = visit(lo);
+                const auto effect_hi = visit(hi);
+
+                if (static_cast<std::uint32_t>(effect_lo) + static_cast<std::uint32_t>(effect_hi) < 3) {
+                    sites.emplace_back(x);
+                }
+
+                return (std::max)(effect_lo, effect_hi);
+            }
+
+            throw std::logic_error{"unexpected expression"};
+        }
+    };
+} // namespace
+
+TEST(kyut, operand_swapping_bit_order) {
+    wasm::Module module{};
+    wasm::Builder builder{module};
+
+    // Sites in the order bits have been embedded in since the first release: the right operand of binary, SIMD
+    // replace, shuffle and shift expressions comes before the left one, unless the operands are ordered
+    std::vector<wasm::Binary*> sites{};
+    for (std::int32_t n = 0; n < 10; n++) {
+        sites.emplace_back(make_site(builder, n == 3 ? 2 : n));
+    }
+
+    std::vector<wasm::Expression*> list{};
+
+    // (i32.sub 1 0)
+    list.emplace_back(builder.makeDrop(builder.makeBinary(wasm::SubInt32, sites[1], sites[0])));
+
+    // (i32.add 3 2), with equal operands
+    list.emplace_back(builder.makeDrop(builder.makeBinary(wasm::AddInt32, sites[3], sites[2])));
+
+    // (i8x16.shuffle 5 4)
+    list.emplace_back(builder.makeDrop(builder.makeSIMDShuffle(splat(builder, sites[5]), splat(builder, sites[4]), std::array<std::uint8_t, 16>{})));
+
+    // (i32x4.replace_lane 0 7 6)
+    list.emplace_back(builder.makeDrop(builder.makeSIMDReplace(wasm::ReplaceLaneVecI32x4, splat(builder, sites[7]), 0, sites[6])));
+
+    // (i32x4.shl 9 8)
+    list.emplace_back(builder.makeDrop(builder.makeSIMDShift(wasm::ShlVecI32x4, splat(builder, sites[9]), sites[8])));
+
+    module.addFunction(builder.makeFunction("f", wasm::Signature{wasm::Type::i32, wasm::Type::none}, {}, builder.makeBlock(list)));
+
+#if defined(__GNUC__) && !defined(__clang__)
+    // The sites are in the order of the released binaries
+    BaselineVisitor baseline{};
+    baseline.visit(module.functions[0]->body);
+
+    EXPECT_EQ(baseline.sites, (std::vector<const wasm::Binary*>{std::begin(sites), std::end(sites)}));
+#endif
+
+    // 1010101010 swaps the even sites
+    kyut::CircularBitStreamReader r{"\xAA\xAA"};
+    EXPECT_EQ(kyut::methods::operand_swapping::embed(r, module, 10), std::size_t{10});
+
+    for (std::size_t i = 0; i < sites.size(); i++) {
+        EXPECT_EQ(sites[i]->left->is<wasm::Const>(), i % 2 == 0) << "site " << i;
+    }
+
+    // Equal operands again, or they would be ordered on extraction
+    std::swap(sites[3]->left, sites[3]->right);
+
+    kyut::BitStreamWriter w{};
+    EXPECT_EQ(kyut::methods::operand_swapping::extract(w, module), std::size_t{10});
+
+    // 1011101010
+    ASSERT_EQ(w.data().size(), std::size_t{2});
+    EXPECT_EQ(w.data()[0], 0xBA);
+    EXPECT_EQ(w.data()[1] & 0xC0, 0x80);
+}
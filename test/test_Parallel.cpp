@@ -0,0 +1,63 @@
+#include "kyut/Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <utility>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+
+TEST(kyut, parallel_for) {
+    for (const std::size_t num_threads : {0, 1, 4}) {
+        std::vector<int> x(1000, 0);
+
+        kyut::parallel_for(x.size(), num_threads, [&](std::size_t i) { x[i] += static_cast<int>(i); });
+
+        for (std::size_t i = 0; i < x.size(); i++) {
+            EXPECT_EQ(x[i], static_cast<int>(i));
+        }
+    }
+
+    std::atomic<std::size_t> calls{0};
+    kyut::parallel_for(0, 4, [&](std::size_t) { calls++; });
+
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(kyut, parallel_for_exception) {
+    EXPECT_THROW(
+        kyut::parallel_for(100, 4, [](std::size_t i) {
+            if (i == 42) {
+                throw std::runtime_error{"error"};
+            }
+        }),
+        std::runtime_error);
+}
+
+TEST(kyut, parallel_sort) {
+    std::mt19937 engine{42};
+    std::uniform_int_distribution<int> dist{0, 99};
+
+    for (const std::size_t size : {0, 1, 100, 1000, 12345}) {
+        // (key, original position)
+        std::vector<std::pair<int, std::size_t>> x{};
+        for (std::size_t i = 0; i < size; i++) {
+            x.emplace_back(dist(engine), i);
+        }
+
+        const auto less = [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        };
+
+        auto expected = x;
+        std::stable_sort(std::begin(expected), std::end(expected), less);
+
+        for (const std::size_t num_threads : {1, 2, 3, 8}) {
+            auto actual = x;
+            kyut::parallel_sort(std::begin(actual), std::end(actual), num_threads, less);
+
+            EXPECT_EQ(actual, expected);
+        }
+    }
+}
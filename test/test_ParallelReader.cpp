@@ -0,0 +1,253 @@
+#include "kyut/wasm-ext/ParallelReader.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "kyut/binary/Writer.hpp"
+#include "kyut/wasm-ext/ParallelWriter.hpp"
+#include "pass.h"
+#include "wasm-binary.h"
+#include "wasm-io.h"
+#include <gtest/gtest.h>
+
+namespace {
+    using Bytes = std::vector<std::uint8_t>;
+
+    constexpr std::uint32_t num_functions = 10;
+
+    // Module importing function 0, and defining functions 1 to `num_functions` with a local and a block each.
+    // Function `i` calls function `i % num_functions + 1`, and has a body of about `i` times as many instructions.
+    Bytes make_module() {
+        Bytes bytes{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        kyut::binary::write_section(bytes, 1, {0x01, 0x60, 0x00, 0x00});
+
+        Bytes imports{0x01};
+        kyut::binary::write_name(imports, "env");
+        kyut::binary::write_name(imports, "f");
+        imports.insert(std::end(imports), {0x00, 0x00});
+        kyut::binary::write_section(bytes, 2, imports);
+
+        Bytes functions{};
+        kyut::binary::write_u32(functions, num_functions);
+        functions.insert(std::end(functions), num_functions, 0x00);
+        kyut::binary::write_section(bytes, 3, functions);
+
+        kyut::binary::write_section(bytes, 5, {0x01, 0x00, 0x01});
+
+        Bytes exports{0x01};
+        kyut::binary::write_name(exports, "a");
+        exports.insert(std::end(exports), {0x00, 0x03});
+        kyut::binary::write_section(bytes, 7, exports);
+
+        Bytes code{};
+        kyut::binary::write_u32(code, num_functions);
+        for (std::uint32_t i = 1; i <= num_functions; i++) {
+            // (local i32) (block (local.set 0 (i32.const i)) (br_if 0 (local.get 0)) ...) (call i % n + 1)
+            Bytes body{0x01, 0x01, 0x7F, 0x02, 0x40};
+            for (std::uint32_t k = 0; k < i; k++) {
+                body.insert(std::end(body), {0x41, static_cast<std::uint8_t>(i), 0x21, 0x00, 0x20, 0x00, 0x0D, 0x00});
+            }
+            body.insert(std::end(body), {0x0B, 0x10, static_cast<std::uint8_t>(i % num_functions + 1), 0x0B});
+
+            kyut::binary::write_u32(code, static_cast<std::uint32_t>(body.size()));
+            code.insert(std::end(code), std::begin(body), std::end(body));
+        }
+        kyut::binary::write_section(bytes, 10, code);
+
+        kyut::binary::write_section(bytes, 11, {0x01, 0x00, 0x41, 0x08, 0x0B, 0x03, 'a', 'b', 'c'});
+
+        Bytes function_names{0x02, 0x01};
+        kyut::binary::write_name(function_names, "one");
+        function_names.push_back(0x07);
+        kyut::binary::write_name(function_names, "seven");
+
+        Bytes local_names{0x02};
+        for (const std::uint8_t f : {2, 9}) {
+            local_names.insert(std::end(local_names), {f, 0x01, 0x00});
+            kyut::binary::write_name(local_names, "x");
+        }
+
+        Bytes names{};
+        kyut::binary::write_name(names, "name");
+        kyut::binary::write_section(names, 1, function_names);
+        kyut::binary::write_section(names, 2, local_names);
+        kyut::binary::write_section(bytes, 0, names);
+
+        return bytes;
+    }
+
+    // Appends a compile unit with a low_pc, and no children
+    void add_dwarf_sections(Bytes& bytes) {
+        Bytes abbrev{};
+        kyut::binary::write_name(abbrev, ".debug_abbrev");
+        abbrev.insert(std::end(abbrev), {0x01, 0x11, 0x00, 0x11, 0x01, 0x00, 0x00, 0x00});
+        kyut::binary::write_section(bytes, 0, abbrev);
+
+        Bytes info{};
+        kyut::binary::write_name(info, ".debug_info");
+        info.insert(std::end(info), {0x0C, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x01, 0x00, 0x00, 0x00, 0x00});
+        kyut::binary::write_section(bytes, 0, info);
+    }
+
+    // Checks that `kyut::write_binary` writes `module` as `wasm::ModuleWriter` does
+    void expect_written_as_module_writer(wasm::Module& module) {
+        for (const auto debug_info : {false, true}) {
+            const auto expected_filename = testing::TempDir() + "parallel_writer_expected.wasm";
+
+            wasm::ModuleWriter w{};
+            w.setDebugInfo(debug_info);
+            w.writeBinary(module, expected_filename);
+
+            const auto expected = kyut::binary::read_module(expected_filename);
+
+            for (const std::size_t num_threads : {2, 3, 16}) {
+                const auto filename = testing::TempDir() + "parallel_writer.wasm";
+                kyut::write_binary(module, filename, debug_info, num_threads);
+
+                EXPECT_EQ(kyut::binary::read_module(filename).bytes(), expected.bytes())
+                    << (debug_info ? "with debug info, " : "") << num_threads << " threads";
+            }
+        }
+    }
+
+    Bytes write(wasm::Module& module) {
+        wasm::BufferWithRandomAccess buffer{};
+
+        wasm::WasmBinaryWriter writer{&module, buffer};
+        writer.setNamesSection(true);
+        writer.write();
+
+        return static_cast<Bytes&>(buffer);
+    }
+} // namespace
+
+TEST(kyut, parallel_reader) {
+    const kyut::binary::Module binary{make_module()};
+
+    kyut::ParallelReader reader{};
+
+    wasm::Module expected{};
+    reader.read(binary, expected, 1);
+
+    ASSERT_EQ(expected.functions.size(), num_functions + 1);
+    EXPECT_EQ(expected.functions[7]->name, wasm::Name{"seven"});
+
+    const auto expected_bytes = write(expected);
+
+    for (const std::size_t num_threads : {2, 3, 8, 16}) {
+        wasm::Module module{};
+        reader.read(binary, module, num_threads);
+
+        EXPECT_EQ(write(module), expected_bytes) << num_threads << " threads";
+
+        EXPECT_EQ(module.getFunction("seven"), module.functions[7].get());
+        EXPECT_EQ(module.functions[9]->getLocalNameOrDefault(0), wasm::Name{"x"});
+        ASSERT_EQ(module.memory.segments.size(), std::size_t{1});
+        EXPECT_EQ(module.memory.segments[0].data.size(), std::size_t{3});
+    }
+}
+
+TEST(kyut, parallel_reader_dwarf) {
+    auto bytes = make_module();
+    add_dwarf_sections(bytes);
+
+    const kyut::binary::Module binary{std::move(bytes)};
+
+    kyut::ParallelReader reader{};
+
+    wasm::Module expected{};
+    reader.read(binary, expected, 1);
+
+    wasm::Module module{};
+    reader.read(binary, module, 4);
+
+    EXPECT_EQ(write(module), write(expected));
+
+    std::vector<std::string> names{};
+    for (const auto& section : module.userSections) {
+        names.emplace_back(section.name);
+    }
+
+    EXPECT_EQ(names, (std::vector<std::string>{".debug_abbrev", ".debug_info"}));
+}
+
+TEST(kyut, parallel_writer) {
+    const kyut::binary::Module binary{make_module()};
+
+    kyut::ParallelReader reader{};
+
+    wasm::Module module{};
+    reader.read(binary, module, 1);
+
+    expect_written_as_module_writer(module);
+}
+
+TEST(kyut, parallel_writer_dwarf) {
+    auto bytes = make_module();
+    add_dwarf_sections(bytes);
+
+    const kyut::binary::Module binary{std::move(bytes)};
+
+    kyut::ParallelReader reader{};
+
+    wasm::Module module{};
+    reader.read(binary, module, 1);
+
+    // Written by `wasm::ModuleWriter`
+    expect_written_as_module_writer(module);
+
+    EXPECT_THROW((kyut::ParallelWriter{module, true}), std::runtime_error);
+}
+
+TEST(kyut, parallel_writer_stack_ir) {
+    const kyut::binary::Module binary{make_module()};
+
+    kyut::ParallelReader reader{};
+
+    wasm::Module module{};
+    reader.read(binary, module, 1);
+
+    wasm::PassRunner runner{&module};
+    runner.add("generate-stack-ir");
+    runner.run();
+
+    ASSERT_NE(module.functions[1]->stackIR, nullptr);
+
+    expect_written_as_module_writer(module);
+}
+
+TEST(kyut, parallel_writer_source_map) {
+    auto bytes = make_module();
+
+    Bytes url{};
+    kyut::binary::write_name(url, "sourceMappingURL");
+    kyut::binary::write_name(url, "a.wasm.map");
+    kyut::binary::write_section(bytes, 0, url);
+
+    const kyut::binary::Module binary{std::move(bytes)};
+
+    kyut::ParallelReader reader{};
+
+    wasm::Module module{};
+    reader.read(binary, module, 1);
+
+    // Locations are only written to a source map, which neither writer is given
+    module.debugInfoFileNames.emplace_back("a.c");
+    for (std::size_t i = 1; i < module.functions.size(); i++) {
+        const auto& f = module.functions[i];
+        f->debugLocations[f->body] = wasm::Function::DebugLocation{0, static_cast<std::uint32_t>(i), 1};
+    }
+
+    expect_written_as_module_writer(module);
+
+    // Locations of prologs are recorded in the writer whether it has a source map or not
+    module.functions[1]->prologLocation.emplace(wasm::Function::DebugLocation{0, 1, 0});
+    ASSERT_TRUE(kyut::has_writer_locations(module));
+
+    // Written by `wasm::ModuleWriter`
+    expect_written_as_module_writer(module);
+
+    EXPECT_THROW((kyut::ParallelWriter{module, true}), std::runtime_error);
+}
@@ -1,5 +1,10 @@
 #include "kyut/Reordering.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
 #include <gtest/gtest.h>
 
 namespace {
@@ -76,6 +81,9 @@ TEST(kyut_Reordering, extract_by_reordering) {
 
     check_extract("1232", 20, 2, "\x00"sv);
     check_extract("2132", 20, 2, "\x40"sv);
+
+    // Not produced by embedding: offset 1 holds a duplicate of offset 0
+    check_extract("2213", 20, 2, "\x40"sv);
 }
 
 namespace {
@@ -116,3 +124,189 @@ TEST(kyut_Reordering, embed_then_extract) {
 
     check_embed_then_extract("1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuv", "Test"sv, 15, 40 * 3 + 32, "TestTestTestTestTes"sv);
 }
+
+TEST(kyut_Reordering, three_way_less) {
+    using namespace std::string_view_literals;
+
+    const auto compare3 = kyut::three_way_less([](char a, char b) {
+        return a < b ? -1 : b < a ? 1 : 0;
+    });
+
+    std::string data = "1223";
+
+    kyut::CircularBitStreamReader r{"\x40"sv};
+
+    EXPECT_EQ(kyut::embed_by_reordering(r, std::size_t(-1), 20, std::begin(data), std::end(data), compare3), 2);
+    EXPECT_EQ(data, "2132");
+
+    kyut::BitStreamWriter w{};
+
+    EXPECT_EQ(kyut::extract_by_reordering(w, 20, std::begin(data), std::end(data), compare3), 2);
+    EXPECT_EQ(w.data_as_str(), "\x40"sv);
+}
+
+TEST(kyut_Reordering, projection) {
+    using namespace std::string_view_literals;
+
+    const auto first = [](const std::pair<char, int>& x) {
+        return x.first;
+    };
+
+    // Equivalent elements keep their relative order
+    std::vector<std::pair<char, int>> data = {{'2', 0}, {'1', 1}, {'2', 2}, {'3', 3}};
+
+    kyut::CircularBitStreamReader r{"\x40"sv};
+
+    EXPECT_EQ(kyut::embed_by_reordering(r, std::size_t(-1), 20, std::begin(data), std::end(data), std::less<>{}, first), 2);
+    EXPECT_EQ(data, (std::vector<std::pair<char, int>>{{'2', 0}, {'1', 1}, {'3', 3}, {'2', 2}}));
+
+    kyut::BitStreamWriter w{};
+
+    EXPECT_EQ(kyut::extract_by_reordering(w, 20, std::begin(data), std::end(data), std::less<>{}, first), 2);
+    EXPECT_EQ(w.data_as_str(), "\x40"sv);
+}
+
+TEST(kyut_Reordering, projection_same_as_elements) {
+    const auto identity = [](char c) {
+        return c;
+    };
+
+    for (const std::size_t chunk_size : {2, 7, 15, 20}) {
+        std::string expected = "1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuv";
+        std::string actual = expected;
+
+        kyut::CircularBitStreamReader r1{"Test"};
+        kyut::CircularBitStreamReader r2{"Test"};
+
+        EXPECT_EQ(
+            kyut::embed_by_reordering(r1, 100, chunk_size, std::begin(expected), std::end(expected), std::less<>{}),
+            kyut::embed_by_reordering(r2, 100, chunk_size, std::begin(actual), std::end(actual), std::less<>{}, identity));
+        EXPECT_EQ(actual, expected);
+
+        kyut::BitStreamWriter w1{};
+        kyut::BitStreamWriter w2{};
+
+        EXPECT_EQ(
+            kyut::extract_by_reordering(w1, chunk_size, std::begin(expected), std::end(expected), std::less<>{}),
+            kyut::extract_by_reordering(w2, chunk_size, std::begin(actual), std::end(actual), std::less<>{}, identity));
+        EXPECT_EQ(w2.data_as_str(), w1.data_as_str());
+    }
+}
+
+TEST(kyut_Reordering, factorial_bit_width) {
+    EXPECT_EQ(kyut::detail::factorial_bit_width(20), 61);
+    EXPECT_EQ(kyut::detail::factorial_bit_width(21), 65);
+    EXPECT_EQ(kyut::detail::factorial_bit_width(100), 524);
+    EXPECT_EQ(kyut::detail::factorial_bit_width(1000), 8529);
+    EXPECT_EQ(kyut::detail::factorial_bit_width(kyut::max_chunk_size), 43250);
+}
+
+TEST(kyut_Reordering, large_chunks) {
+    constexpr std::size_t size = 10000;
+
+    for (const std::size_t chunk_size : {std::size_t{21}, std::size_t{100}, std::size_t{1000}, kyut::max_chunk_size}) {
+        std::vector<int> data(size);
+        std::iota(std::begin(data), std::end(data), 0);
+        std::shuffle(std::begin(data), std::end(data), std::mt19937{42});
+
+        std::size_t expected_size_bits = 0;
+        for (std::size_t i = 0; i < size; i += chunk_size) {
+            expected_size_bits += kyut::detail::factorial_bit_width((std::min)(chunk_size, size - i));
+        }
+
+        kyut::CircularBitStreamReader r{"Large chunks"};
+
+        EXPECT_EQ(kyut::embed_by_reordering(r, std::size_t(-1), chunk_size, std::begin(data), std::end(data), std::less<>{}), expected_size_bits);
+
+        // The same watermark, repeated
+        kyut::CircularBitStreamReader expected_r{"Large chunks"};
+        kyut::BitStreamWriter expected{};
+        for (std::size_t i = 0; i < expected_size_bits; i += 64) {
+            const auto n = (std::min)(std::size_t{64}, expected_size_bits - i);
+            expected.write(expected_r.read(n), n);
+        }
+
+        kyut::BitStreamWriter w{};
+
+        EXPECT_EQ(kyut::extract_by_reordering(w, chunk_size, std::begin(data), std::end(data), std::less<>{}), expected_size_bits);
+        EXPECT_EQ(w.data(), expected.data());
+
+        // The projection path gives the same permutation
+        std::vector<int> projected(size);
+        std::iota(std::begin(projected), std::end(projected), 0);
+        std::shuffle(std::begin(projected), std::end(projected), std::mt19937{42});
+
+        kyut::CircularBitStreamReader r2{"Large chunks"};
+
+        kyut::embed_by_reordering(r2, std::size_t(-1), chunk_size, std::begin(projected), std::end(projected), std::less<>{}, [](int x) { return x; });
+        EXPECT_EQ(projected, data);
+    }
+}
+
+TEST(kyut_Reordering, threads) {
+    constexpr std::size_t size = 5000;
+
+    // (key, original position), with many equivalent keys
+    std::vector<std::pair<int, int>> data(size);
+    std::mt19937 engine{42};
+    for (std::size_t i = 0; i < size; i++) {
+        data[i] = {static_cast<int>(engine() % 2000), static_cast<int>(i)};
+    }
+
+    const auto first = [](const std::pair<int, int>& x) {
+        return x.first;
+    };
+
+    for (const std::size_t chunk_size : {std::size_t{2}, std::size_t{20}, std::size_t{300}}) {
+        for (const std::size_t limit : {std::size_t{0}, std::size_t{1000}, std::size_t(-1)}) {
+            auto expected = data;
+
+            kyut::CircularBitStreamReader expected_r{"Threads"};
+            const auto expected_embedded = kyut::embed_by_reordering(expected_r, limit, chunk_size, std::begin(expected), std::end(expected), std::less<>{}, first);
+
+            kyut::BitStreamWriter expected_w{};
+            const auto expected_extracted = kyut::extract_by_reordering(expected_w, chunk_size, std::begin(expected), std::end(expected), std::less<>{}, first);
+
+            for (const std::size_t num_threads : {2, 3, 8}) {
+                auto actual = data;
+
+                kyut::CircularBitStreamReader r{"Threads"};
+                EXPECT_EQ(kyut::embed_by_reordering(r, limit, chunk_size, std::begin(actual), std::end(actual), std::less<>{}, first, num_threads), expected_embedded);
+                EXPECT_EQ(r.position_bits(), expected_r.position_bits());
+                EXPECT_EQ(actual, expected);
+
+                kyut::BitStreamWriter w{};
+                EXPECT_EQ(kyut::extract_by_reordering(w, chunk_size, std::begin(actual), std::end(actual), std::less<>{}, first, num_threads), expected_extracted);
+                EXPECT_EQ(w.data(), expected_w.data());
+            }
+        }
+    }
+}
+
+TEST(kyut_Reordering, capacity_by_reordering) {
+    constexpr std::size_t size = 5000;
+
+    // Many equivalent keys, so chunks embed fewer bits than their sizes allow
+    std::vector<int> data(size);
+    std::mt19937 engine{42};
+    for (auto& x : data) {
+        x = static_cast<int>(engine() % 2000);
+    }
+
+    const auto identity = [](int x) {
+        return x;
+    };
+
+    for (const std::size_t chunk_size : {std::size_t{2}, std::size_t{20}, std::size_t{300}}) {
+        auto embedded = data;
+
+        kyut::CircularBitStreamReader r{"Capacity"};
+        const auto expected = kyut::embed_by_reordering(r, std::size_t(-1), chunk_size, std::begin(embedded), std::end(embedded), std::less<>{}, identity);
+
+        for (const std::size_t num_threads : {1, 3}) {
+            EXPECT_EQ(kyut::capacity_by_reordering(chunk_size, std::begin(data), std::end(data), std::less<>{}, identity, num_threads), expected);
+        }
+    }
+
+    EXPECT_EQ(kyut::capacity_by_reordering(20, std::begin(data), std::begin(data), std::less<>{}, identity), 0u);
+}
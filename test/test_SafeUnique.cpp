@@ -1,6 +1,9 @@
 #include "kyut/SafeUnique.hpp"
 
+#include <forward_list>
+#include <memory>
 #include <string>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST(kyut, safe_unique) {
@@ -11,3 +14,66 @@ TEST(kyut, safe_unique) {
     EXPECT_EQ(result, std::begin(x) + 8);
     EXPECT_EQ(x, "01234589122388");
 }
+
+TEST(kyut, safe_unique_edge_cases) {
+    const auto equal = [](char a, char b) { return a == b; };
+
+    for (const auto& [input, expected, size] : std::vector<std::tuple<std::string, std::string, std::size_t>>{
+             {"", "", 0},
+             {"1", "1", 1},
+             {"1111", "1111", 1},
+             {"1234", "1234", 4},
+             {"1121", "1211", 3},
+             {"1213141", "1213141", 7},
+             {"1122112211", "1212112121", 5},
+         }) {
+        std::string x = input;
+
+        const auto result = kyut::safe_unique(std::begin(x), std::end(x), equal);
+
+        EXPECT_EQ(result, std::begin(x) + size);
+        EXPECT_EQ(x, expected);
+    }
+}
+
+TEST(kyut, safe_unique_compares_with_last_unique) {
+    // "12" and "13" are within 1 of the last unique element "1"; "3" is not within 1 of "13"
+    std::vector<int> x = {10, 11, 12, 13, 14, 20};
+
+    const auto result = kyut::safe_unique(std::begin(x), std::end(x), [](int a, int b) { return b - a <= 1; });
+
+    EXPECT_EQ(result, std::begin(x) + 4);
+    EXPECT_EQ(x, (std::vector<int>{10, 12, 14, 20, 11, 13}));
+}
+
+TEST(kyut, safe_unique_move_only) {
+    std::vector<std::unique_ptr<int>> x{};
+    for (const int v : {1, 1, 2, 3, 3, 3, 4}) {
+        x.emplace_back(std::make_unique<int>(v));
+    }
+
+    const auto first_one = x[0].get();
+    const auto second_one = x[1].get();
+
+    const auto result = kyut::safe_unique(std::begin(x), std::end(x), [](const auto& a, const auto& b) { return *a == *b; });
+
+    ASSERT_EQ(result, std::begin(x) + 4);
+
+    std::vector<int> values{};
+    for (const auto& p : x) {
+        values.emplace_back(*p);
+    }
+
+    EXPECT_EQ(values, (std::vector<int>{1, 2, 3, 4, 1, 3, 3}));
+    EXPECT_EQ(x[0].get(), first_one);
+    EXPECT_EQ(x[4].get(), second_one);
+}
+
+TEST(kyut, safe_unique_forward_iterator) {
+    std::forward_list<int> x = {1, 1, 2, 2, 3};
+
+    const auto result = kyut::safe_unique(std::begin(x), std::end(x), [](int a, int b) { return a == b; });
+
+    EXPECT_EQ(std::distance(std::begin(x), result), 3);
+    EXPECT_EQ(x, (std::forward_list<int>{1, 2, 3, 1, 2}));
+}